@@ -36,6 +36,7 @@
 #endif
 
 #include <zip.h>
+#include <zlib.h>
 
 #include <SDL.h>
 #include <SDL_audio.h>
@@ -62,7 +63,10 @@
 #define WINDOW_HEIGHT 682
 #define DIR_JAR "jar"
 #define DIR_UNCOMP "uncomp"
+#define DIR_EXPORT "export" /*** See --batch=export and import. ***/
+#define DIR_CACHE "cache" /*** Decoded images; see CacheLoad(). ***/
 #define BACKUP DIR_JAR SLASH "backup.bak"
+#define JOURNAL "journal.bin" /*** Unsaved changes; see JournalAdd(). ***/
 #define MAX_PATHFILE 200
 #define MAX_ERROR 200
 #define MAX_WARNING 200
@@ -73,22 +77,117 @@
 #define MAX_HEIGHT 1000
 #define MAX_UNKNOWN 100
 #define MAX_FRONT_TYPE 100
-#define MAX_FRONT 1000
-#define MAX_CHOMPERS 1000
-#define MAX_SPIKES 1000
-#define MAX_GATES 1000
-#define MAX_RAISE 1000
-#define MAX_GUARDS 1000
-#define MAX_POTIONS 1000
-#define MAX_LOOSE 1000
+#define MAX_PER_KIND 1000 /*** Objects of each kind (front, chompers, etc.). ***/
+#define MAX_FIELDS 8 /*** Per object, besides X and Y. ***/
 #define MAX_TEXT 65000
+#define MAX_LVL_BYTES 300000 /*** A .lvl file can never be larger. ***/
+#define LAST_BACK 0x37 /*** Back tile codes are 0x00-0x37; see TileHexToNr(). ***/
+#define MAX_REPORT 2000 /*** Per level; see ValidateAdd(). ***/
+#define MINI_WIDTH 200 /*** Largest minimap, in pixels. ***/
+#define MINI_HEIGHT 150
+#define MAX_MINI_QUEUE 4096 /*** Changed tiles; more redoes the minimap. ***/
+#define THUMB_WIDTH 216 /*** Largest gallery thumbnail. ***/
+#define THUMB_HEIGHT 180
+#define MAX_SHOT_ZOOM 8 /*** See --batch=png. ***/
+#define SHOT_CHUNK 65536 /*** PNG IDAT chunk size. ***/
+#define TILE_EMPTY 0 /*** See TileClass(). ***/
+#define TILE_FLOOR 1
+#define TILE_WALL 2
+#define TILE_CLIMB 3 /*** A floor with a ledge. ***/
+#define REACH_WORDS ((MAX_WIDTH + 2 + 63) / 64)
+#define REACH_JUMP 8 /*** Tiles; a running jump. ***/
+#define KIND_FRONT 1
+#define KIND_CHOMPERS 2
+#define KIND_SPIKES 3
+#define KIND_GATES 4
+#define KIND_RAISE 5
+#define KIND_GUARDS 6
+#define KIND_POTIONS 7
+#define KIND_LOOSE 8
+#define MAX_KINDS 8
+#define FIELD_X -1
+#define FIELD_Y -2
+#define FIELD_FRONT_TYPE 0
+#define FIELD_FRONT_A 1
+#define FIELD_FRONT_B 2
+#define FIELD_FRONT_CODE 3 /*** Not in the file; see FrontResolve(). ***/
+#define FIELD_CHOMPER_A 0
+#define FIELD_SPIKE_RIGHT 0
+#define FIELD_GATE_TIMEOPEN 0
+#define FIELD_RAISE_GATE 0
+#define FIELD_GUARD_DIR 0
+#define FIELD_GUARD_HP 1
+#define FIELD_GUARD_A 2
+#define FIELD_GUARD_B 3
+#define FIELD_GUARD_C 4
+#define FIELD_GUARD_D 5
+#define FIELD_GUARD_E 6
+#define FIELD_GUARD_F 7
+#define FIELD_POTION_TYPE 0
+#define FIELD_LOOSE_RIGHT 0
+#define MAX_INDEXED (MAX_KINDS * MAX_PER_KIND)
+#define MAX_NEAR 10000 /*** Farther objects are never found. ***/
+#define HOVER_NEAR 16 /*** For the name next to the coordinates. ***/
+#define MAX_UNDO 1000 /*** Steps; see --undo=. ***/
+#define DEFAULT_UNDO 100
+#define MAX_DELTAS 65536 /*** For all steps together. ***/
+#define MAX_SAVED (MAX_INDEXED * 2) /*** Objects of DELTA_ENTITY. ***/
+#define MAX_AREAS 64 /*** Of DELTA_AREA. ***/
+#define DELTA_BACK 1 /*** A: row, B: first column, C: run length ***/
+#define DELTA_VALUE 2 /*** A: VALUE_* ***/
+#define DELTA_ENTITY 3 /*** A: kind, B: slot, C: saved[]; 1 = exists ***/
+#define DELTA_FRONT_TYPE 4 /*** A: code; values: ulFrontTypes ***/
+#define DELTA_TEXT 5 /*** A: line, B: char position ***/
+#define DELTA_EXE 6 /*** A: EXE_* ***/
+#define DELTA_AREA 7 /*** A: area[]; values: 0 = old, 1 = new ***/
+#define VALUE_PRINCE_X 0
+#define VALUE_PRINCE_Y 1
+#define VALUE_EXIT_TRIGGER_X 2
+#define VALUE_EXIT_TRIGGER_Y 3
+#define VALUE_SAVE_TRIGGER_X 4
+#define VALUE_SAVE_TRIGGER_Y 5
+#define VALUE_ENTRANCE_IMAGE_X 6
+#define VALUE_ENTRANCE_IMAGE_Y 7
+#define VALUE_EXIT_IMAGE_X 8
+#define VALUE_EXIT_IMAGE_Y 9
+#define EXE_MENU_SELECTION 0
+#define EXE_FONT_EMPHASIS 1
+#define EXE_TEXT_LINES 2
+#define MAX_JOURNAL 4096 /*** Buffered bytes. ***/
+#define JOURNAL_FLUSH 1000 /*** At most one write per this many ms. ***/
+#define JOURNAL_MAGIC "PHJ1"
+#define CACHE_MAGIC "PHC1"
+#define CACHE_HEADER 24
+#define MAX_CACHE_SIDE 4096 /*** Larger cached images are damaged. ***/
+#define SECTION_LEVEL 0 /*** Export and import; see SectionName(). ***/
+#define SECTION_WIDTH 1
+#define SECTION_HEIGHT 2
+#define SECTION_BACK 3
+#define SECTION_UNKNOWN 4
+#define SECTION_FRONT_TYPES 5
+#define SECTION_POINT 6 /*** + 0-4; VALUE_* / 2 ***/
+#define SECTION_KIND 10 /*** + KIND_* ***/
+#define SECTION_TEXT 19
+#define MAX_SECTIONS 20
+#define MAX_IMPORT_FIELDS 300 /*** Per CSV line. ***/
+#define MAX_IMPORT_FIELD 100 /*** Characters per CSV field. ***/
 #define MAX_IMG 200
+#define MAX_PRELOAD 160 /*** Images queued by PreLoad(). ***/
+#define MAX_PRELOAD_THREADS 8
+#define ASSET_MAP 0 /*** See assetgroup[]. ***/
+#define ASSET_POPUP 1
+#define ASSET_EXE 2
+#define ASSET_TEXT 3
+#define ASSET_HELP 4
+#define MAX_ASSET_GROUPS 5
 #define MAX_CON 30
 #define NUM_SOUNDS 20 /*** Sounds that may play at the same time. ***/
 #define BAR_FULL 658
 #define REFRESH_PROG 25 /*** That is 40 fps (1000/25). ***/
-#define REFRESH_GAME 33 /*** That is ~30 fps (1000/33). ***/
 #define FPS_TORCH 33
+#define ANIM_TORCH 0
+#define ANIM_STATUSBAR 1
+#define MAX_ANIM 2
 #define MAX_FILE 100
 #define MAX_ZOOM 7
 #define DEFAULT_ZOOM 4
@@ -101,6 +200,8 @@
 #define MAX_LINES 12
 #define MAX_STATUS 100
 #define MAX_FONT_SIZE 70
+#define MAX_CACHED 200 /*** Rendered texts that are kept as textures. ***/
+#define MAX_CACHED_TEXT 100
 
 #define PNG_VARIOUS "various"
 #define PNG_BACK "back"
@@ -125,62 +226,251 @@ unsigned long ulFrontTypes;
 unsigned long ulFrontTypeA[MAX_FRONT_TYPE + 2];
 unsigned long ulFrontTypeB[MAX_FRONT_TYPE + 2];
 unsigned long ulFrontTypeNr[MAX_FRONT_TYPE + 2];
-unsigned long ulNrFront;
-unsigned long ulFrontX[MAX_FRONT + 2];
-unsigned long ulFrontY[MAX_FRONT + 2];
-unsigned long ulFrontType[MAX_FRONT + 2];
-unsigned long ulFrontA[MAX_FRONT + 2];
-unsigned long ulFrontB[MAX_FRONT + 2];
+int iFrontTypeOf[256]; /*** ulFrontTypeNr[] code to type (0-based); -1 = none ***/
 unsigned long ulPrinceX, ulPrinceY;
 unsigned long ulExitTriggerX, ulExitTriggerY;
 unsigned long ulSaveTriggerX, ulSaveTriggerY;
 unsigned long ulEntranceImageX, ulEntranceImageY;
 unsigned long ulExitImageX, ulExitImageY;
-unsigned long ulNrChompers;
-unsigned long ulChomperX[MAX_CHOMPERS + 2];
-unsigned long ulChomperY[MAX_CHOMPERS + 2];
-unsigned long ulChomperA[MAX_CHOMPERS + 2];
-unsigned long ulNrSpikes;
-unsigned long ulSpikeX[MAX_SPIKES + 2];
-unsigned long ulSpikeY[MAX_SPIKES + 2];
-unsigned long ulSpikeRight[MAX_SPIKES + 2];
-unsigned long ulNrGates;
-unsigned long ulGateX[MAX_GATES + 2];
-unsigned long ulGateY[MAX_GATES + 2];
-unsigned long ulGateTimeOpen[MAX_GATES + 2];
-unsigned long ulNrRaise;
-unsigned long ulRaiseGate[MAX_RAISE + 2];
-unsigned long ulRaiseX[MAX_RAISE + 2];
-unsigned long ulRaiseY[MAX_RAISE + 2];
-unsigned long ulNrGuards;
-unsigned long ulGuardX[MAX_GUARDS + 2];
-unsigned long ulGuardY[MAX_GUARDS + 2];
-unsigned long ulGuardDir[MAX_GUARDS + 2];
-unsigned long ulGuardHP[MAX_GUARDS + 2];
-unsigned long ulGuardA[MAX_GUARDS + 2];
-unsigned long ulGuardB[MAX_GUARDS + 2];
-unsigned long ulGuardC[MAX_GUARDS + 2];
-unsigned long ulGuardD[MAX_GUARDS + 2];
-unsigned long ulGuardE[MAX_GUARDS + 2];
-unsigned long ulGuardF[MAX_GUARDS + 2];
-unsigned long ulNrPotions;
-unsigned long ulPotionType[MAX_POTIONS + 2];
-unsigned long ulPotionX[MAX_POTIONS + 2];
-unsigned long ulPotionY[MAX_POTIONS + 2];
-unsigned long ulNrLoose;
-unsigned long ulLooseX[MAX_LOOSE + 2];
-unsigned long ulLooseY[MAX_LOOSE + 2];
-unsigned long ulLooseRight[MAX_LOOSE + 2];
+/* The objects of each kind, indexed by KIND_*. The records of a kind are
+ * in one array; iFirst and the iPrev/iNext links keep them in file order.
+ * A slot never moves while its object exists, so slots are used as handles.
+ */
+struct entity {
+	int iPrev, iNext; /*** -1 = none ***/
+	unsigned long ulOrder; /*** Increases in file order. ***/
+	unsigned long ulX, ulY;
+	unsigned long ulField[MAX_FIELDS]; /*** FIELD_* ***/
+};
+struct entities {
+	unsigned long ulNr;
+	int iFirst, iLast;
+	int iFree; /*** Unused slots, linked through iNext. ***/
+	unsigned long ulNextOrder;
+	struct entity arEnt[MAX_PER_KIND];
+} ent[MAX_KINDS + 2];
 unsigned long ulNrText;
 unsigned char sText[MAX_TEXT + 2];
+unsigned char sLvl[MAX_LVL_BYTES + 2]; /*** See LevelBytes(). ***/
+
+/* A level file that is being checked; see Validate(). Each is used by one
+ * thread only, so Validate() can check all levels at the same time.
+ */
+struct validation {
+	int iLevel;
+	unsigned char *sData;
+	long lSize, lPos;
+	int iShort; /*** 1 = tried to read past the end ***/
+	int iProblems;
+	char sReport[MAX_REPORT + 2];
+} validation[MAX_LEVEL + 2];
 
 int iNrLines;
 char arTextLine[MAX_LINES + 2][MAX_LINECHARS + 2];
 
+/*** Spatial index of the objects above, bucketed by (16x24) tile. ***/
+struct indexed {
+	int iKind; /*** KIND_* ***/
+	int iSlot; /*** In ent[iKind]. ***/
+	int iCell;
+	int iPrev, iNext; /*** In the cell, or the free list. -1 = none ***/
+} indexed[MAX_INDEXED];
+int iIndexHead[(MAX_HEIGHT + 2) * (MAX_WIDTH + 2)]; /*** -1 = empty ***/
+int iIndexOf[MAX_KINDS + 2][MAX_PER_KIND];
+int iIndexFree;
+int iVisible[MAX_KINDS + 2][MAX_PER_KIND];
+int iVisibleStamp;
+
+/* Which gate each raise plate opens, by slot; see LinkAdd(). Plates that
+ * point past the last gate are kept on iLinkLoose until it exists.
+ */
+int iGateNr[MAX_PER_KIND]; /*** Gate slot to FIELD_RAISE_GATE. ***/
+int iGateSlot[MAX_PER_KIND]; /*** FIELD_RAISE_GATE to gate slot. ***/
+int iLinkFirst[MAX_PER_KIND]; /*** Gate slot to its first plate. ***/
+int iLinkGate[MAX_PER_KIND]; /*** Plate slot to its gate slot. -1 = loose ***/
+int iLinkPrev[MAX_PER_KIND], iLinkNext[MAX_PER_KIND]; /*** -1 = none ***/
+int iLinkLoose;
+
+/* Undo and redo. Each step is a range of deltas, which are kept in a ring
+ * of MAX_DELTAS; when it is full, the oldest steps are dropped. Counters
+ * (ulFirst, ulDeltaUsed, ulDeltaNext) only increase; use % MAX_DELTAS.
+ * The objects of DELTA_ENTITY and the tiles of DELTA_AREA are kept in
+ * rings of their own, saved[] and area[], in the same way.
+ */
+struct delta {
+	int iType; /*** DELTA_* ***/
+	int iA, iB, iC;
+	unsigned long ulOld, ulNew;
+} delta[MAX_DELTAS];
+struct entity saved[MAX_SAVED];
+struct area {
+	int iRow, iColumn; /*** Top left. ***/
+	int iRows, iColumns;
+	unsigned char *sOld, *sNew; /*** Row by row; NULL = unused ***/
+} area[MAX_AREAS];
+struct step {
+	unsigned long ulFirst;
+	unsigned long ulCount;
+	unsigned long ulSavedEnd, ulAreaEnd; /*** Counters after the step. ***/
+} step[MAX_UNDO];
+int iUndoMax; /*** Steps to keep; 0 = no undo. ***/
+int iStepFirst; /*** Oldest step in step[]. ***/
+int iSteps; /*** Kept steps. ***/
+int iStepsDone; /*** Steps that can be undone; the rest can be redone. ***/
+unsigned long ulDeltaUsed, ulDeltaNext;
+unsigned long ulSavedUsed, ulSavedNext;
+unsigned long ulAreaUsed, ulAreaNext;
+int iAreaOpen; /*** See UndoAreaBegin(). ***/
+int iAreaTop, iAreaLeft, iAreaBottom, iAreaRight; /*** What changed. ***/
+unsigned char *sAreaRow[MAX_HEIGHT + 2]; /*** Old tiles; NULL = as is ***/
+unsigned long ulStepStart; /*** Of the step being recorded. ***/
+int iRecording; /*** UndoBegin() depth. ***/
+int iStepOverflow;
+int iReplaying;
+
+/*** Journal of unsaved changes, for crash recovery; see JournalAdd(). ***/
+unsigned char sJournal[MAX_JOURNAL + 2];
+int iJournalLen;
+int iJournalFd; /*** -1 = not open ***/
+Uint32 ulJournalFlushed;
+int iJournalBack; /*** Offset of the last back tile run; -1 = none ***/
+int iJournalBackRow, iJournalBackColumn, iJournalBackLength;
+unsigned long ulJournalBackTile;
+
+/*** What the objects of each kind look like in the level files. ***/
+struct kind {
+	char *sName; /*** For the coordinates. ***/
+	char *sPlural; /*** For warnings. ***/
+	char *sHeader; /*** For the debug output. ***/
+	char *sItem; /*** For the debug output. ***/
+	int iMin; /*** Each level must have at least this many. ***/
+	int iFields; /*** Including X and Y. ***/
+	int iField[MAX_FIELDS + 2]; /*** In file order; FIELD_* ***/
+	int iBytes[MAX_FIELDS + 2];
+	char *sField[MAX_FIELDS + 2];
+} kind[MAX_KINDS + 2] = {
+	{ "", "", "", "", 0, 0, { 0 }, { 0 }, { "" } },
+	{ "front", "front", "Front", "Front", 1, 5,
+		{ FIELD_X, FIELD_Y, FIELD_FRONT_TYPE, FIELD_FRONT_A, FIELD_FRONT_B },
+		{ 2, 2, 1, 1, 1 }, { "X", "Y", "type", "A", "B" } },
+	{ "chomper", "chompers", "Chompers", "Chomper", 0, 3,
+		{ FIELD_X, FIELD_Y, FIELD_CHOMPER_A },
+		{ 2, 2, 1 }, { "X", "Y", "A" } },
+	{ "spikes", "spikes", "Spikes", "Spikes", 1, 3,
+		{ FIELD_X, FIELD_Y, FIELD_SPIKE_RIGHT },
+		{ 2, 2, 1 }, { "X", "Y", "right" } },
+	{ "gate", "gates", "Gates", "Gate", 1, 3,
+		{ FIELD_X, FIELD_Y, FIELD_GATE_TIMEOPEN },
+		{ 2, 2, 2 }, { "X", "Y", "time open" } },
+	{ "raise", "raise", "Raise", "Raise", 0, 3,
+		{ FIELD_RAISE_GATE, FIELD_X, FIELD_Y },
+		{ 2, 2, 2 }, { "Gate", "X", "Y" } },
+	{ "guard", "guards", "Guards", "Guard", 0, 10,
+		{ FIELD_X, FIELD_Y, FIELD_GUARD_DIR, FIELD_GUARD_HP,
+		FIELD_GUARD_A, FIELD_GUARD_B, FIELD_GUARD_C, FIELD_GUARD_D,
+		FIELD_GUARD_E, FIELD_GUARD_F },
+		{ 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 },
+		{ "X", "Y", "dir", "HP", "A", "B", "C", "D", "E", "F" } },
+	{ "potion", "potions", "Potions (inc. save lamp anim.)", "Potion", 1, 3,
+		{ FIELD_POTION_TYPE, FIELD_X, FIELD_Y },
+		{ 1, 2, 2 }, { "Type", "X", "Y" } },
+	{ "loose", "loose", "Loose", "Loose", 0, 3,
+		{ FIELD_X, FIELD_Y, FIELD_LOOSE_RIGHT },
+		{ 2, 2, 1 }, { "X", "Y", "right" } }
+};
+/*** The map shows the kinds in this order. ***/
+int iDrawOrder[MAX_KINDS] = { KIND_CHOMPERS, KIND_SPIKES, KIND_GATES,
+	KIND_RAISE, KIND_GUARDS, KIND_POTIONS, KIND_LOOSE, KIND_FRONT };
+
 int iDebug;
 int iJAR;
 char sPathFile[MAX_PATHFILE + 2];
 int iStartLevel;
+int iBatch; /*** 1 = --batch; no SDL ***/
+char sBatch[MAX_OPTION + 2];
+int iBatchLevel; /*** -1 = all levels ***/
+int iCSV; /*** 1 = export and import CSV instead of JSON ***/
+int iShotZoom; /*** For --batch=png. ***/
+
+/* Pictures of whole levels; see ShotLevels(). The images are loaded as
+ * RGBA surfaces once, and after that only read, by all threads at once.
+ */
+struct shotimage {
+	char *sInfo; /*** As in EntityImage(). ***/
+	char *sPath;
+	char *sPNG;
+	SDL_Surface *surface;
+} shotimage[] = {
+	{ "imgentrance", PNG_VARIOUS, "entrance.png", NULL },
+	{ "imgexit", PNG_VARIOUS, "exit.png", NULL },
+	{ "imgprincer", PNG_VARIOUS, "prince_r.png", NULL },
+	{ "imgexittrigger", PNG_VARIOUS, "exit_trigger.png", NULL },
+	{ "imgsavetrigger", PNG_VARIOUS, "save_trigger.png", NULL },
+	{ "imgchomper", PNG_VARIOUS, "chomper.png", NULL },
+	{ "imgspikes0", PNG_VARIOUS, "spikes_0.png", NULL },
+	{ "imgspikes1", PNG_VARIOUS, "spikes_1.png", NULL },
+	{ "imggate", PNG_VARIOUS, "gate.png", NULL },
+	{ "imgraise", PNG_VARIOUS, "raise.png", NULL },
+	{ "imgguardr", PNG_VARIOUS, "guard_r.png", NULL },
+	{ "imgguardl", PNG_VARIOUS, "guard_l.png", NULL },
+	{ "imgpotion0", PNG_VARIOUS, "potion_0.png", NULL },
+	{ "imgpotion1", PNG_VARIOUS, "potion_1.png", NULL },
+	{ "imgpotion2", PNG_VARIOUS, "potion_2.png", NULL },
+	{ "imgpotion3", PNG_VARIOUS, "potion_3.png", NULL },
+	{ "imgloose0", PNG_VARIOUS, "loose_0.png", NULL },
+	{ "imgloose1", PNG_VARIOUS, "loose_1.png", NULL },
+	{ "imgtorchsprite", PNG_FRONT, "torch_sprite.png", NULL },
+	{ "imgpillarfront", PNG_FRONT, "pillar_front.png", NULL },
+	{ "imgskeleton", PNG_FRONT, "skeleton.png", NULL },
+	{ "imgwalltopleftslash", PNG_FRONT, "wall_top_left_slash.png", NULL },
+	{ "imgwalltopleftdot", PNG_FRONT, "wall_top_left_dot.png", NULL },
+	{ "imgwallbottomleft", PNG_FRONT, "wall_bottom_left.png", NULL },
+	{ "imgfloorclimbable", PNG_FRONT, "floor_climbable.png", NULL },
+	{ NULL, NULL, NULL, NULL }
+};
+SDL_Surface *shotback[55 + 2];
+struct shotop {
+	int iImage; /*** In shotimage[]. ***/
+	int iX, iY; /*** Top left, in level pixels. ***/
+	int iWidth; /*** Of the first frame, for sprites. ***/
+};
+struct shot {
+	int iLevel;
+	int iWidth, iHeight; /*** In tiles. ***/
+	unsigned char *sBack; /*** Row by row. ***/
+	struct shotop *op; /*** In drawing order. ***/
+	int iOps;
+	int *iRowFirst; /*** Where each tile row starts in iRowOp. ***/
+	int *iRowOp; /*** The ops that cover each tile row. ***/
+	char sFile[MAX_PATHFILE + 2];
+	char sError[MAX_ERROR + 2]; /*** "" = fine ***/
+} shot[MAX_LEVEL + 2];
+
+/* The gallery; see Gallery(). The thumbnails are made by threads, from
+ * the level files, or from the loaded level; only a changed level is
+ * made again.
+ */
+struct thumb {
+	struct shot stShot; /*** Only the back tiles. ***/
+	Uint32 *ulPixels; /*** ARGB; by the thread. ***/
+	int iWidth, iHeight;
+	SDL_atomic_t iDone; /*** 1 = ulPixels is ready ***/
+	SDL_Thread *thread;
+	int iBusy; /*** 1 = not yet collected ***/
+	int iFresh; /*** 0 = make it (again) ***/
+	SDL_Texture *img;
+	int iImgWidth, iImgHeight;
+} thumb[MAX_LEVEL + 2];
+int iGalleryOK;
+int iGalleryHover; /*** -1 = none ***/
+
+/*** The file that is being imported; see ImportFail(). ***/
+char *sImport;
+long lImportSize, lImportPos;
+int iImportLine;
+char sImportFile[MAX_PATHFILE + 2];
+char arImportField[MAX_IMPORT_FIELDS + 2][MAX_IMPORT_FIELD + 2];
+int iImportSeen[MAX_SECTIONS]; /*** Records per SECTION_* ***/
 char sError[MAX_ERROR + 2];
 char sWarning[MAX_WARNING + 2];
 SDL_Window *window;
@@ -193,10 +483,45 @@ SDL_Cursor *curHand;
 SDL_Cursor *curText;
 int iNoAudio;
 int iNoController;
-TTF_Font *font[MAX_FONT_SIZE + 2];
+int iNoCache;
+TTF_Font *font[MAX_FONT_SIZE + 2]; /*** NULL until first used. ***/
+unsigned char *sFontData;
+long lFontDataSize;
+
+#ifdef EMBED
+/* The png/, wav/ and ttf/ files, compiled in by "make embed"; see
+ * AssetOpen(). The generated table ends with a NULL sFile.
+ */
+struct embedded {
+	char *sFile; /*** With '/', as in the tree. ***/
+	const unsigned char *sData;
+	int iSize;
+};
+#include "embedded.h"
+#endif
 int iPreLoaded;
 int iCurrentBarHeight;
 int iNrToPreLoad;
+Uint32 ulPreLoadStart;
+
+/* The images that PreLoad() queued. Threads decode them to surfaces;
+ * PreLoadRun() makes the textures.
+ */
+struct preload {
+	char sImage[MAX_IMG + 2];
+	SDL_Texture **imgImage;
+	SDL_Surface *surface; /*** By the thread; NULL = failed. ***/
+	char sError[MAX_ERROR + 2];
+	unsigned char *sPixels; /*** Of a cached surface. ***/
+	SDL_atomic_t iDone; /*** 1 = surface is ready, 2 = texture made ***/
+} preload[MAX_PRELOAD];
+int iPreLoads;
+SDL_atomic_t iPreLoadNext; /*** The next image a thread will take. ***/
+SDL_sem *semPreLoaded; /*** Posted for each decoded image. ***/
+SDL_Thread *threadpreload[MAX_PRELOAD_THREADS];
+int iPreLoadThreads;
+int iPreLoadMade;
+int iPreLoadFirst; /*** The images before it have textures. ***/
 unsigned int gamespeed;
 Uint32 looptime;
 int iCurLevel;
@@ -208,13 +533,17 @@ int iXPosDragStart, iYPosDragStart;
 int iDraggingMoved;
 int iXPosDragOffset, iYPosDragOffset;
 int iNoAnim;
-int iFlameFrame;
-Uint32 newticks, oldticks;
-Uint32 oldticksf;
+struct anim {
+	int iFrames;
+	Uint32 ulRate; /*** ms per frame ***/
+	int iFrame; /*** 1 to iFrames ***/
+	Uint32 ulNext; /*** When the next frame is due. ***/
+} anim[MAX_ANIM];
 char arText[9 + 2][MAX_TEXT + 2];
 int iTextOK;
 int iHelpOK;
 int iHoverRow, iHoverColumn;
+int iMapStartX, iMapStartY; /*** Set once per ShowScreen(). ***/
 int iCloseOn;
 int iYesOn;
 int iNoOn;
@@ -224,7 +553,7 @@ int iChanged;
 struct zip *zip;
 int iEmulator;
 int iLastBack;
-int iDelWhat, iDelX, iDelY;
+int iDelWhat, iDelX, iDelY, iDelSlot;
 int iDelXPos, iDelYPos;
 int iLine;
 int iXYNear;
@@ -233,6 +562,48 @@ int iChangeFront;
 int iCFX, iCFY;
 int iOKOn;
 int iHideFront;
+int iSelection; /*** 1 = back tiles are selected ***/
+int iSelecting; /*** 1 = Ctrl + dragging ***/
+int iSelRow1, iSelColumn1, iSelRow2, iSelColumn2;
+unsigned long *ulClip; /*** Copied back tiles, row by row. ***/
+int iClipWidth, iClipHeight;
+
+/*** Back tiles by code, for find and replace; see FindMove(). ***/
+int iFindHead[256]; /*** -1 = none ***/
+int iFindPrev[(MAX_HEIGHT + 2) * (MAX_WIDTH + 2)];
+int iFindNext[(MAX_HEIGHT + 2) * (MAX_WIDTH + 2)];
+unsigned long ulFindCount[MAX_LEVEL + 2][256]; /*** Tiles per level. ***/
+int iFindCounted[MAX_LEVEL + 2]; /*** 1 = ulFindCount[] is up-to-date ***/
+int iFindLevel; /*** Whose tiles are in the lists; -1 = none ***/
+int iFindCode; /*** Highlighted; -1 = none ***/
+
+/* Which tiles the prince can reach; see ReachUpdate(). Each row is a
+ * bitset: column iColumn is bit (iColumn % 64) of word (iColumn / 64).
+ */
+Uint64 ulReachStand[MAX_HEIGHT + 2][REACH_WORDS];
+Uint64 ulReachClimb[MAX_HEIGHT + 2][REACH_WORDS];
+Uint64 ulReachWall[MAX_HEIGHT + 2][REACH_WORDS];
+Uint64 ulReached[MAX_HEIGHT + 2][REACH_WORDS];
+Uint64 ulReachTouched[MAX_HEIGHT + 2][REACH_WORDS]; /*** Looked at. ***/
+int iReachQueue[MAX_HEIGHT + 2];
+int iReachQueued[MAX_HEIGHT + 2];
+int iReachHead, iReachTail;
+int iReachDirty;
+int iReachShow; /*** 1 = overlay ***/
+
+/* The minimap; see ShowMini(). The texture has one pixel per tile, and
+ * only the tiles that changed are written to it.
+ */
+SDL_Texture *imgmini;
+int iMiniWidth, iMiniHeight; /*** Of imgmini. ***/
+int iMiniQueue[MAX_MINI_QUEUE]; /*** Cells, as in IndexCell(). ***/
+int iMiniQueued;
+int iMiniFull; /*** 1 = write all tiles ***/
+int iMiniShow; /*** 1 = shown ***/
+int iMiniScale; /*** Pixels per tile. ***/
+int iMiniLeft, iMiniTop; /*** First tile shown, from 0. ***/
+int iMiniDragging;
+SDL_Rect minibox;
 
 /*** front ***/
 int iFront0101;
@@ -268,7 +639,6 @@ int iFront1901;
 int iEXEMenuInitialSelection;
 int iEXECutscenesFontEmphasis;
 int iEXECutscenesTextLines;
-int iStatusBarFrame;
 char sStatus[MAX_STATUS + 2], sStatusOld[MAX_STATUS + 2];
 
 /*** for text ***/
@@ -281,6 +651,20 @@ SDL_Surface *message;
 SDL_Texture *messaget;
 SDL_Rect offset;
 
+/*** text cache ***/
+struct cached {
+	char sText[MAX_CACHED_TEXT + 2];
+	int iFontSize; /*** -1 = never matches ***/
+	int iBlended;
+	SDL_Color fore;
+	SDL_Color back;
+	SDL_Texture *text;
+	int iWidth, iHeight;
+	unsigned long ulLastUsed;
+} cached[MAX_CACHED];
+unsigned long ulCacheTick;
+unsigned long ulCacheHits, ulCacheMisses;
+
 /*** controller ***/
 int iController;
 SDL_GameController *controller;
@@ -355,6 +739,122 @@ SDL_Texture *imgstatusbarsprite;
 SDL_Texture *imgpopup;
 SDL_Texture *imgchkb;
 
+/* All images, by the screen that needs them; see AssetUse(). With sPath
+ * NULL, the image is in PNG_BUTTONS, or PNG_GAMEPAD with a controller.
+ * With iCount above 1, img is an array, and sFile has its number.
+ */
+struct asset {
+	int iGroup;
+	char *sPath;
+	char *sFile;
+	SDL_Texture **img;
+	int iCount;
+} asset[] = {
+	/*** map ***/
+	{ ASSET_MAP, PNG_BACK, "%02X.png", imgback, 56 },
+	{ ASSET_MAP, PNG_VARIOUS, "back_tiles.png", &imgbacktiles, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "hover_back_l.png", &imghoverbackl, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "hover_back_l_live.png", &imghoverbackllive, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "front.png", &imgfront, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "hover_front.png", &imghoverfront, 1 },
+	{ ASSET_MAP, NULL, "previous_off.png", &imgprevoff, 1 },
+	{ ASSET_MAP, NULL, "previous_on_0.png", &imgprevon_0, 1 },
+	{ ASSET_MAP, NULL, "previous_on_1.png", &imgprevon_1, 1 },
+	{ ASSET_MAP, NULL, "next_off.png", &imgnextoff, 1 },
+	{ ASSET_MAP, NULL, "next_on_0.png", &imgnexton_0, 1 },
+	{ ASSET_MAP, NULL, "next_on_1.png", &imgnexton_1, 1 },
+	{ ASSET_MAP, NULL, "exe_off.png", &imgexeoff, 1 },
+	{ ASSET_MAP, NULL, "exe_on_0.png", &imgexeon_0, 1 },
+	{ ASSET_MAP, NULL, "exe_on_1.png", &imgexeon_1, 1 },
+	{ ASSET_MAP, NULL, "OK.png", &imgok[1], 1 },
+	{ ASSET_MAP, NULL, "sel_OK.png", &imgok[2], 1 },
+	{ ASSET_MAP, NULL, "close_0.png", &imgclose[1], 1 },
+	{ ASSET_MAP, NULL, "close_1.png", &imgclose[2], 1 },
+	{ ASSET_MAP, NULL, "save_off.png", &imgsaveoff, 1 },
+	{ ASSET_MAP, NULL, "save_on_0.png", &imgsaveon_0, 1 },
+	{ ASSET_MAP, NULL, "save_on_1.png", &imgsaveon_1, 1 },
+	{ ASSET_MAP, NULL, "quit_0.png", &imgquit_0, 1 },
+	{ ASSET_MAP, NULL, "quit_1.png", &imgquit_1, 1 },
+	{ ASSET_MAP, NULL, "text_off.png", &imgtextoff, 1 },
+	{ ASSET_MAP, NULL, "text_on_0.png", &imgtexton_0, 1 },
+	{ ASSET_MAP, NULL, "text_on_1.png", &imgtexton_1, 1 },
+	{ ASSET_MAP, NULL, "playtest_off.png", &imgplayoff, 1 },
+	{ ASSET_MAP, NULL, "playtest_on_0.png", &imgplayon_0, 1 },
+	{ ASSET_MAP, NULL, "playtest_on_1.png", &imgplayon_1, 1 },
+	{ ASSET_MAP, NULL, "help_off.png", &imghelpoff, 1 },
+	{ ASSET_MAP, NULL, "help_on_0.png", &imghelpon_0, 1 },
+	{ ASSET_MAP, NULL, "help_on_1.png", &imghelpon_1, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "black.png", &imgblack, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "interface.png", &imginterface, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "hover_back_s.png", &imghoverbacks, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "entrance.png", &imgentrance, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "exit.png", &imgexit, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "prince_r.png", &imgprincer, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "exit_trigger.png", &imgexittrigger, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "save_trigger.png", &imgsavetrigger, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "chomper.png", &imgchomper, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "spikes_0.png", &imgspikes0, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "spikes_1.png", &imgspikes1, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "gate.png", &imggate, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "raise.png", &imgraise, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "guard_r.png", &imgguardr, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "guard_l.png", &imgguardl, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "potion_0.png", &imgpotion0, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "potion_1.png", &imgpotion1, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "potion_2.png", &imgpotion2, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "potion_3.png", &imgpotion3, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "loose_0.png", &imgloose0, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "loose_1.png", &imgloose1, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "emulator.png", &imgemulator, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "delete.png", &imgdelete, 1 },
+	{ ASSET_MAP, PNG_VARIOUS, "chk_black.png", &imgchkb, 1 },
+	{ ASSET_MAP, PNG_FRONT, "torch_sprite.png", &imgtorchsprite, 1 },
+	{ ASSET_MAP, PNG_FRONT, "pillar_front.png", &imgpillarfront, 1 },
+	{ ASSET_MAP, PNG_FRONT, "skeleton.png", &imgskeleton, 1 },
+	{ ASSET_MAP, PNG_FRONT, "wall_top_left_slash.png", &imgwalltopleftslash, 1 },
+	{ ASSET_MAP, PNG_FRONT, "wall_top_left_dot.png", &imgwalltopleftdot, 1 },
+	{ ASSET_MAP, PNG_FRONT, "floor_climbable.png", &imgfloorclimbable, 1 },
+	{ ASSET_MAP, PNG_FRONT, "wall_bottom_left.png", &imgwallbottomleft, 1 },
+	/*** popup ***/
+	{ ASSET_POPUP, PNG_VARIOUS, "faded.png", &imgfaded, 1 },
+	{ ASSET_POPUP, PNG_VARIOUS, "popup.png", &imgpopup, 1 },
+	{ ASSET_POPUP, PNG_VARIOUS, "popup_yn.png", &imgpopup_yn, 1 },
+	{ ASSET_POPUP, NULL, "Yes.png", &imgyes[1], 1 },
+	{ ASSET_POPUP, NULL, "sel_Yes.png", &imgyes[2], 1 },
+	{ ASSET_POPUP, NULL, "No.png", &imgno[1], 1 },
+	{ ASSET_POPUP, NULL, "sel_No.png", &imgno[2], 1 },
+	/*** exe ***/
+	{ ASSET_EXE, PNG_VARIOUS, "exe.png", &imgexe, 1 },
+	{ ASSET_EXE, PNG_VARIOUS, "statusbar_sprite.png", &imgstatusbarsprite, 1 },
+	{ ASSET_EXE, NULL, "Save.png", &imgsave[1], 1 },
+	{ ASSET_EXE, NULL, "sel_Save.png", &imgsave[2], 1 },
+	/*** text ***/
+	{ ASSET_TEXT, PNG_VARIOUS, "text.png", &imgtext, 1 },
+	{ ASSET_TEXT, PNG_VARIOUS, "hover_text.png", &imghovertext, 1 },
+	/*** help ***/
+	{ ASSET_HELP, PNG_VARIOUS, "help.png", &imghelp, 1 },
+	{ 0, NULL, NULL, NULL, 0 }
+};
+
+/* The screens. Their images load on first use (AssetUse()), or earlier,
+ * in the background, if iPrefetch is 1. With iUnload 1, they are
+ * unloaded again when the screen closes (AssetDrop()).
+ */
+struct assetgroup {
+	char *sName;
+	int iPrefetch;
+	int iUnload;
+	int iRefs;
+	int iLoaded;
+} assetgroup[MAX_ASSET_GROUPS] = {
+	{ "map", 0, 0, 0, 0 },
+	{ "popup", 1, 0, 0, 0 },
+	{ "exe", 1, 0, 0, 0 },
+	{ "text", 1, 0, 0, 0 },
+	{ "help", 0, 1, 0, 0 }
+};
+int iPrefetching; /*** The group being prefetched; -1 = none ***/
+
 struct sample {
 	Uint8 *data;
 	Uint32 dpos;
@@ -376,20 +876,35 @@ unsigned long ReadFromFile (int iFd, char *sWhat,
 	int iSize, unsigned char *sRetString);
 unsigned long BytesAsLU (unsigned char *sData, int iBytes);
 void LevelLoad (int iLevel);
+void LevelDump (void);
 void InitScreenAction (char *sAction);
 void InitScreen (void);
 void ShowFrontTiles (void);
 void ShowScreen (void);
 void Quit (void);
 void LoadFonts (void);
+TTF_Font *Font (int iSize);
+void CloseFonts (void);
 void MixAudio (void *unused, Uint8 *stream, int iLen);
 void PlaySound (char *sFile);
 void PreLoad (char *sPath, char *sPNG, SDL_Texture **imgImage);
+void PreLoadRun (int iShowBar);
+void PreLoadStart (int iThreads);
+int PreLoadMake (int iWait, int iShowBar);
+int PreLoadThread (void *unused);
+int PreLoadOne (void);
+SDL_Surface *CacheLoad (char *sImage, unsigned char **sPixels);
+void CacheSave (char *sImage, SDL_Surface *surface);
+void CacheName (char *sImage, char *sCache);
+unsigned long CacheHash (char *sImage);
+void LUAsBytes (unsigned long ulValue, unsigned char *sData);
+SDL_RWops *AssetOpen (char *sFile);
 void ShowImage (SDL_Texture *img, int iX, int iY, char *sImageInfo,
 	SDL_Renderer *screen, float fMultiply, int iXYScale);
 void LoadingBar (int iBarHeight);
 void PrevLevel (void);
 void NextLevel (void);
+void OpenLevel (int iToLoad);
 void SetZoom (int iZoomTo);
 int InArea (int iUpperLeftX, int iUpperLeftY,
 	int iLowerRightX, int iLowerRightY);
@@ -406,6 +921,7 @@ void ChangeBackAction (char *sAction);
 void ChangeBack (void);
 void ShowChangeBack (void);
 int TileHexToNr (int iHex);
+int TileClass (int iHex);
 int TileNrToHex (int iNr);
 void ChangeFrontAction (char *sAction);
 void ChangeFront (void);
@@ -415,18 +931,23 @@ void CenterNumber (int iNumber, int iX, int iY,
 int PlusMinus (int *iWhat, int iX, int iY,
 	int iMin, int iMax, int iChange, int iAddChanged);
 void LevelSave (void);
+void LevelWrite (char *sLocation);
+long LevelBytes (unsigned char *sBytes);
+void PutByte (unsigned char *sBytes, long *lLength, unsigned long ulValue);
+void PutWord (unsigned char *sBytes, long *lLength, unsigned long ulValue);
 void CreateBAK (void);
 void WriteByte (int iFd, int iValue);
 void WriteWord (int iFd, int iValue);
 void PopUpSave (void);
-void ShowPopUpSave (void);
+int PopUpYN (char *sLine1, char *sLine2);
+void ShowPopUpYN (char *sLine1, char *sLine2);
 void Zoom (int iToggleFull);
 void Compress (void);
 int ZIPDir (char *sDir);
 int ZIPFile (char *sFrom, char *sTo);
 void Playtest (void);
 int StartGame (void *unused);
-void AddFront (int iX, int iY, int iFrontTypeNr);
+int AddFront (int iX, int iY, int iFrontTypeNr);
 void ClearLevel (void);
 void Text (void);
 void ShowText (void);
@@ -438,19 +959,175 @@ void EXESave (void);
 void UpdateStatusBar (void);
 int AlignX (int iX, int iOverSixteen);
 int AlignY (int iY, int iOverTwentyFour);
-void DelWhat (int iType, int iX, int iY);
 void Del (void);
 void CreateMeta (char *sFile);
 void VerifyVersion (void);
 void InitPopUp (void);
 void ShowPopUp (void);
 void UpdateHover (void);
+SDL_Texture *CachedText (char *sString, int iFontSize, int iBlended,
+	SDL_Color fore, SDL_Color back, int *iWidth, int *iHeight);
+void FlushCachedText (void);
+void InitAnim (int iAnim, int iFrames, Uint32 ulRate);
+int AnimTick (int iAnim);
+void AnimSleep (int iAnim);
+void EntClear (int iKind);
+int EntAdd (int iKind);
+void EntDel (int iKind, int iSlot);
+unsigned long *EntField (struct entity *stEnt, int iField);
+void LoadKind (int iFd, int iKind, unsigned char *sData);
+void SaveKind (unsigned char *sBytes, long *lLength, int iKind);
+void DumpKind (int iKind);
+void FrontResolve (struct entity *stEnt);
+void ShowEntity (int iKind, int iSlot);
+SDL_Texture *EntityImage (int iKind, struct entity *stEnt, char *sImageInfo,
+	int *iOffsetX, int *iOffsetY);
+int IndexCell (int iX, int iY);
+void IndexRebuild (void);
+void IndexAdd (int iKind, int iSlot);
+void IndexDel (int iKind, int iSlot);
+int NearestObject (int iX, int iY, int iMax, int *iKind, int *iSlot);
+void NearestInCell (int iCell, int iX, int iY, int iMax,
+	int *iBest, int *iKind, int *iSlot);
+void IndexStampVisible (void);
+void LatestMotion (SDL_Event *event);
+void UndoClear (void);
+void UndoBegin (void);
+void UndoEnd (void);
+void UndoDropOldest (void);
+void UndoFreeAreas (unsigned long ulFrom, unsigned long ulTo);
+int UndoRoom (int iType);
+struct delta *UndoRecord (int iType, int iA, int iB, int iC,
+	unsigned long ulOld, unsigned long ulNew);
+void UndoEntity (int iKind, int iSlot, int iAdded);
+void UndoAreaBegin (void);
+void UndoAreaTile (int iRow, int iColumn, unsigned long ulOld);
+void UndoAreaEnd (void);
+void UndoApply (int iStep, int iRedo);
+void Undo (void);
+void Redo (void);
+void SetBack (int iRow, int iColumn, unsigned long ulTile);
+unsigned long *LevelValue (int iValue);
+void SetValue (int iValue, unsigned long ulValue);
+void SetTextChar (int iTextLine, int iPos, char cChar);
+int *EXEValue (int iValue);
+void EntRestore (int iKind, int iSlot, struct entity *stFrom);
+void DeltaApply (struct delta *stDelta, unsigned long ulValue,
+	struct entity *stEnt);
+void AreaApply (struct area *stArea, unsigned long ulValue);
+int DeltaValid (struct delta *stDelta, unsigned long ulValue);
+void JournalAdd (int iType, int iA, int iB, int iC,
+	unsigned long ulValue, struct entity *stEnt);
+void JournalLU (unsigned long ulValue);
+void JournalFlush (int iForce);
+void JournalClear (void);
+void JournalOffer (void);
+int JournalReplay (unsigned char *sData, long lSize);
+unsigned long LevelHash (int iLevel);
+void SelectionBounds (int *iTop, int *iLeft, int *iBottom, int *iRight);
+void SelectionCopy (void);
+void SelectionFill (unsigned long ulTile);
+void SelectionPaste (void);
+void FloodFill (int iRow, int iColumn, unsigned long ulTile);
+int FloodPush (int **iSeeds, int *iMax, int iNr, int iRow, int iColumn);
+void FindRebuild (int iLevel);
+void FindMove (int iRow, int iColumn, unsigned long ulOld, unsigned long ulNew);
+void FindCount (int iLevel);
+unsigned long FindTotal (int iCode);
+void FindToggle (void);
+void FindReplaceAll (void);
+int FindReplaceFile (int iLevel, unsigned long ulFrom, unsigned long ulTo);
+int CompareInt (const void *a, const void *b);
+void Batch (void);
+#ifdef BENCH
+void HoverBench (void);
+void HoverScan (void);
+#endif
+int LevelCheck (int iLevel);
+int ValidateLevels (int iFirst, int iLast);
+int ShotLevels (int iFirst, int iLast);
+void ShotLoad (void);
+SDL_Surface *ShotSurface (char *sPath, char *sPNG);
+void ShotPlan (struct shot *stShot);
+void ShotAdd (struct shot *stShot, char *sInfo, int iX, int iY);
+int ShotThread (void *data);
+int ShotWrite (struct shot *stShot, FILE *fOut);
+void ShotRow (struct shot *stShot, int iRow, unsigned char *sRGB);
+void ShotDraw (unsigned char *sRGB, int iBandY, int iBandWidth,
+	SDL_Surface *surface, int iX, int iY, int iWidth);
+int ShotChunk (FILE *fOut, char *sType, unsigned char *sData, int iLength);
+void ReachMasks (int iRow);
+void ReachRebuild (void);
+void ReachRows (int iFirst, int iLast);
+void ReachTile (int iRow, int iColumn, unsigned long ulOld,
+	unsigned long ulNew);
+void ReachUpdate (void);
+void ReachRow (int iRow);
+void ReachAdd (int iRow, Uint64 *ulAdd);
+void ReachShift (Uint64 *ulFrom, Uint64 *ulTo, int iDirection);
+int ReachAt (unsigned long ulX, unsigned long ulY);
+int ReachIsolated (void);
+void ReachMark (unsigned long ulX, unsigned long ulY);
+void LinkRebuild (void);
+void LinkAdd (int iKind, int iSlot);
+void LinkDel (int iKind, int iSlot);
+void LinkPlate (int iPlate);
+void LinkUnplate (int iPlate);
+void LinkRenumber (int iGate, int iNr);
+void LinkLoose (int iGates);
+int LinkCount (int iGate);
+void ShowLinks (void);
+void MiniTile (int iRow, int iColumn, unsigned long ulOld,
+	unsigned long ulNew);
+void MiniUpdate (void);
+Uint32 MiniColor (unsigned long ulTile);
+void ShowMini (void);
+int MiniAt (void);
+void MiniJump (void);
+void Gallery (void);
+void ShowGallery (void);
+void GalleryCell (int iLevel, int *iX, int *iY);
+int GalleryAt (void);
+void ThumbStart (void);
+int ThumbCollect (int iWait);
+int ThumbThread (void *data);
+void AssetLoad (int iGroup, int iShowBar);
+void AssetUse (int iGroup);
+void AssetDrop (int iGroup);
+void AssetQueue (int iGroup);
+void AssetPrefetch (void);
+void AssetPrefetchEnd (void);
+int ValidateThread (void *data);
+int Validate (struct validation *stVal);
+unsigned long ValidateRead (struct validation *stVal, int iBytes);
+void ValidateAdd (struct validation *stVal, char *sLine);
+const char *SectionName (int iSection);
+int SectionNr (char *sName);
+void LevelExport (int iLevel);
+void ExportJSON (FILE *fOut, int iLevel);
+void ExportCSV (FILE *fOut, int iLevel);
+void ExportString (FILE *fOut, char *sString);
+void LevelImport (int iLevel, int iWrite);
+void ImportFail (char *sWhat);
+unsigned long ImportValue (int iField, unsigned long ulMax);
+void ImportRecord (int iLevel, int iSection, int iFields);
+int ImportPeek (void);
+void ImportExpect (char cChar);
+void ImportString (char *sString, int iMax);
+void ImportToken (char *sToken);
+int ImportJSONArray (void);
+void ImportJSONObject (int iKind);
+void ImportJSON (int iLevel);
+int ImportCSVLine (void);
+void ImportCSV (int iLevel);
 
 /*****************************************************************************/
 int main (int argc, char *argv[])
 /*****************************************************************************/
 {
 	char sStartLevel[MAX_OPTION];
+	char sUndo[MAX_OPTION];
+	char sShotZoom[MAX_OPTION];
 
 	/*** Used for looping. ***/
 	int iArgLoop;
@@ -461,6 +1138,12 @@ int main (int argc, char *argv[])
 	iFullscreen = 0;
 	iNoAudio = 0;
 	iNoController = 0;
+#ifdef EMBED
+	iNoCache = 1; /*** The images are read from the executable. ***/
+#else
+	iNoCache = 0;
+#endif
+	iPrefetching = -1;
 	iZoom = DEFAULT_ZOOM;
 	iNoAnim = 0;
 	iEmulator = 0;
@@ -469,6 +1152,20 @@ int main (int argc, char *argv[])
 	iDelX = -1;
 	iDelY = -1;
 	iHideFront = 0;
+	iUndoMax = DEFAULT_UNDO;
+	iJournalFd = -1;
+	iJournalBack = -1;
+	iSelection = 0;
+	iSelecting = 0;
+	ulClip = NULL;
+	iClipWidth = 0;
+	iClipHeight = 0;
+	iFindLevel = -1;
+	iFindCode = -1;
+	iBatch = 0;
+	iBatchLevel = -1;
+	iCSV = 0;
+	iShotZoom = 1;
 
 	if (argc > 1)
 	{
@@ -513,6 +1210,7 @@ int main (int argc, char *argv[])
 				iStartLevel = atoi (sStartLevel);
 				if ((iStartLevel < 0) || (iStartLevel > MAX_LEVEL))
 					{ iStartLevel = 0; }
+				iBatchLevel = iStartLevel;
 			}
 			else if ((strcmp (argv[iArgLoop], "-s") == 0) ||
 				(strcmp (argv[iArgLoop], "--static") == 0))
@@ -524,6 +1222,38 @@ int main (int argc, char *argv[])
 			{
 				iNoController = 1;
 			}
+			else if ((strncmp (argv[iArgLoop], "-u=", 3) == 0) ||
+				(strncmp (argv[iArgLoop], "--undo=", 7) == 0))
+			{
+				GetOptionValue (argv[iArgLoop], sUndo);
+				iUndoMax = atoi (sUndo);
+				if ((iUndoMax < 0) || (iUndoMax > MAX_UNDO))
+					{ iUndoMax = DEFAULT_UNDO; }
+			}
+			else if ((strcmp (argv[iArgLoop], "-c") == 0) ||
+				(strcmp (argv[iArgLoop], "--csv") == 0))
+			{
+				iCSV = 1;
+			}
+			else if ((strncmp (argv[iArgLoop], "-p=", 3) == 0) ||
+				(strncmp (argv[iArgLoop], "--pngzoom=", 10) == 0))
+			{
+				GetOptionValue (argv[iArgLoop], sShotZoom);
+				iShotZoom = atoi (sShotZoom);
+				if ((iShotZoom < 1) || (iShotZoom > MAX_SHOT_ZOOM))
+					{ iShotZoom = 1; }
+			}
+			else if ((strcmp (argv[iArgLoop], "-x") == 0) ||
+				(strcmp (argv[iArgLoop], "--nocache") == 0))
+			{
+				iNoCache = 1;
+			}
+			else if ((strncmp (argv[iArgLoop], "-b=", 3) == 0) ||
+				(strncmp (argv[iArgLoop], "--batch=", 8) == 0))
+			{
+				GetOptionValue (argv[iArgLoop], sBatch);
+				iBatch = 1;
+			}
 			else
 			{
 				ShowUsage();
@@ -532,6 +1262,7 @@ int main (int argc, char *argv[])
 	}
 
 	SetPathFile();
+	if (iBatch == 1) { Batch(); }
 	Decompress();
 	VerifyVersion();
 	LevelLoad (iStartLevel);
@@ -558,6 +1289,18 @@ void ShowUsage (void)
 	printf ("  -l=NR,     --level=NR       start in level NR\n");
 	printf ("  -s,        --static         do not display animations\n");
 	printf ("  -k,        --keyboard       do not use a game controller\n");
+	printf ("  -u=NR,     --undo=NR        keep NR undo steps (0-%i; %i)\n",
+		MAX_UNDO, DEFAULT_UNDO);
+	printf ("  -b=CMD,    --batch=CMD      run CMD without a window; CMD is dump,"
+		" export,\n");
+	printf ("                              import, validate, png or pack; only"
+		" for level\n");
+	printf ("                              NR if -l=NR is used\n");
+	printf ("  -c,        --csv            export and import CSV, not JSON\n");
+	printf ("  -p=NR,     --pngzoom=NR     zoom of --batch=png (1-%i; 1)\n",
+		MAX_SHOT_ZOOM);
+	printf ("  -x,        --nocache        do not keep decoded images in %s%s\n",
+		DIR_CACHE, SLASH);
 	printf ("\n");
 	exit (EXIT_NORMAL);
 }
@@ -602,9 +1345,13 @@ void GetOptionValue (char *sArgv, char *sValue)
 void ErrorAndExit (void)
 /*****************************************************************************/
 {
+	JournalFlush (1);
 	printf ("[FAILED] %s\n", sError);
-	SDL_ShowSimpleMessageBox (SDL_MESSAGEBOX_ERROR,
-		"Error", sError, NULL);
+	if (iBatch == 0)
+	{
+		SDL_ShowSimpleMessageBox (SDL_MESSAGEBOX_ERROR,
+			"Error", sError, NULL);
+	}
 	exit (EXIT_ERROR);
 }
 /*****************************************************************************/
@@ -612,8 +1359,11 @@ void Warning (void)
 /*****************************************************************************/
 {
 	printf ("[ WARN ] %s\n", sWarning);
-	SDL_ShowSimpleMessageBox (SDL_MESSAGEBOX_ERROR,
-		"Warning", sWarning, NULL);
+	if (iBatch == 0)
+	{
+		SDL_ShowSimpleMessageBox (SDL_MESSAGEBOX_ERROR,
+			"Warning", sWarning, NULL);
+	}
 }
 /*****************************************************************************/
 void SetPathFile (void)
@@ -742,28 +1492,25 @@ unsigned long ReadFromFile (int iFd, char *sWhat,
 {
 	int iLength;
 	int iRead;
-	char sRead[1 + 2];
 	int iEOF;
 
 	if ((iDebug == 1) && (strcmp (sWhat, "") != 0))
 	{
 		printf ("[  OK  ] Loading: %s\n", sWhat);
 	}
+	/*** All iSize bytes at once, not byte by byte; at least one. ***/
 	iLength = 0;
 	iEOF = 0;
 	do {
-		iRead = read (iFd, sRead, 1);
+		iRead = read (iFd, sRetString + iLength, iSize > 0 ? iSize - iLength : 1);
 		switch (iRead)
 		{
-		case -1:
+			case -1:
 				printf ("[FAILED] Could not read (1): %s!\n", strerror (errno));
 				exit (EXIT_ERROR);
 				break;
 			case 0: PrIfDe ("[ INFO ] End of file\n"); iEOF = 1; break;
-			default:
-				sRetString[iLength] = sRead[0];
-				iLength++;
-				break;
+			default: iLength+=iRead; break;
 		}
 	} while ((iLength < iSize) && (iEOF == 0));
 	sRetString[iLength] = '\0';
@@ -850,17 +1597,15 @@ void LevelLoad (int iLevel)
 		ulFrontTypeB[iLoop] = ReadFromFile (iFd, "", 1, sData);
 		ulFrontTypeNr[iLoop] = ReadFromFile (iFd, "", 1, sData);
 	}
+	for (iLoop = 0; iLoop < 256; iLoop++) { iFrontTypeOf[iLoop] = -1; }
+	for (iLoop = 1; iLoop <= (int)ulFrontTypes; iLoop++)
+		{ iFrontTypeOf[ulFrontTypeNr[iLoop]] = iLoop - 1; }
 
 	/*** front ***/
-	ulNrFront = ReadFromFile (iFd, "", 2, sData);
-	for (iLoop = 1; iLoop <= (int)ulNrFront; iLoop++)
-	{
-		ulFrontX[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulFrontY[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulFrontType[iLoop] = ReadFromFile (iFd, "", 1, sData);
-		ulFrontA[iLoop] = ReadFromFile (iFd, "", 1, sData);
-		ulFrontB[iLoop] = ReadFromFile (iFd, "", 1, sData);
-	}
+	LoadKind (iFd, KIND_FRONT, sData);
+	for (iLoop = ent[KIND_FRONT].iFirst; iLoop != -1;
+		iLoop = ent[KIND_FRONT].arEnt[iLoop].iNext)
+		{ FrontResolve (&ent[KIND_FRONT].arEnt[iLoop]); }
 
 	/*** prince ***/
 	ulPrinceX = ReadFromFile (iFd, "", 2, sData);
@@ -890,75 +1635,9 @@ void LevelLoad (int iLevel)
 	ulExitImageX = ReadFromFile (iFd, "", 2, sData);
 	ulExitImageY = ReadFromFile (iFd, "", 2, sData);
 
-	/*** chompers ***/
-	ulNrChompers = ReadFromFile (iFd, "", 2, sData);
-	for (iLoop = 1; iLoop <= (int)ulNrChompers; iLoop++)
-	{
-		ulChomperX[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulChomperY[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulChomperA[iLoop] = ReadFromFile (iFd, "", 1, sData);
-	}
-
-	/*** spikes ***/
-	ulNrSpikes = ReadFromFile (iFd, "", 2, sData);
-	for (iLoop = 1; iLoop <= (int)ulNrSpikes; iLoop++)
-	{
-		ulSpikeX[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulSpikeY[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulSpikeRight[iLoop] = ReadFromFile (iFd, "", 1, sData);
-	}
-
-	/*** gates ***/
-	ulNrGates = ReadFromFile (iFd, "", 2, sData);
-	for (iLoop = 1; iLoop <= (int)ulNrGates; iLoop++)
-	{
-		ulGateX[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulGateY[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulGateTimeOpen[iLoop] = ReadFromFile (iFd, "", 2, sData);
-	}
-
-	/*** raise ***/
-	ulNrRaise = ReadFromFile (iFd, "", 2, sData);
-	for (iLoop = 1; iLoop <= (int)ulNrRaise; iLoop++)
-	{
-		ulRaiseGate[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulRaiseX[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulRaiseY[iLoop] = ReadFromFile (iFd, "", 2, sData);
-	}
-
-	/*** guards ***/
-	ulNrGuards = ReadFromFile (iFd, "", 2, sData);
-	for (iLoop = 1; iLoop <= (int)ulNrGuards; iLoop++)
-	{
-		ulGuardX[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulGuardY[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulGuardDir[iLoop] = ReadFromFile (iFd, "", 1, sData);
-		ulGuardHP[iLoop] = ReadFromFile (iFd, "", 1, sData);
-		ulGuardA[iLoop] = ReadFromFile (iFd, "", 1, sData);
-		ulGuardB[iLoop] = ReadFromFile (iFd, "", 1, sData);
-		ulGuardC[iLoop] = ReadFromFile (iFd, "", 1, sData);
-		ulGuardD[iLoop] = ReadFromFile (iFd, "", 1, sData);
-		ulGuardE[iLoop] = ReadFromFile (iFd, "", 1, sData);
-		ulGuardF[iLoop] = ReadFromFile (iFd, "", 1, sData);
-	}
-
-	/*** potions ***/
-	ulNrPotions = ReadFromFile (iFd, "", 2, sData);
-	for (iLoop = 1; iLoop <= (int)ulNrPotions; iLoop++)
-	{
-		ulPotionType[iLoop] = ReadFromFile (iFd, "", 1, sData);
-		ulPotionX[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulPotionY[iLoop] = ReadFromFile (iFd, "", 2, sData);
-	}
-
-	/*** loose ***/
-	ulNrLoose = ReadFromFile (iFd, "", 2, sData);
-	for (iLoop = 1; iLoop <= (int)ulNrLoose; iLoop++)
-	{
-		ulLooseX[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulLooseY[iLoop] = ReadFromFile (iFd, "", 2, sData);
-		ulLooseRight[iLoop] = ReadFromFile (iFd, "", 1, sData);
-	}
+	/*** chompers, spikes, gates, raise, guards, potions, loose ***/
+	for (iLoop = KIND_CHOMPERS; iLoop <= KIND_LOOSE; iLoop++)
+		{ LoadKind (iFd, iLoop, sData); }
 
 	/*** 0x00 0x00 ***/
 	ReadFromFile (iFd, "", 2, sData);
@@ -987,123 +1666,77 @@ void LevelLoad (int iLevel)
 	}
 	iNrLines--;
 
-	if (iDebug == 1)
-	{
-		printf ("[ INFO ] # Back: %lux%lu\n", ulWidth, ulHeight);
-		for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
-		{
-			for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
-				{ printf ("%02X ", (int)ulBack[iRowLoop][iColumnLoop]); }
-			printf ("\n");
-		}
-		printf ("[ INFO ] # Unknown: %lu\n", ulNrUnknown);
-		for (iLoop = 1; iLoop <= (int)ulNrUnknown; iLoop++)
-		{
-			printf ("(Unknown) A: %lu, B: %lu, C: %lu, D: %lu\n",
-				ulUnknownA[iLoop], ulUnknownB[iLoop],
-				ulUnknownC[iLoop], ulUnknownD[iLoop]);
-		}
-		printf ("[ INFO ] Front types: %lu\n", ulFrontTypes);
-		for (iLoop = 1; iLoop <= (int)ulFrontTypes; iLoop++)
-		{
-			printf ("(Front type) A: %lu, B: %lu, Nr: %lu\n",
-				ulFrontTypeA[iLoop], ulFrontTypeB[iLoop], ulFrontTypeNr[iLoop]);
-		}
-		printf ("[ INFO ] # Front: %lu\n", ulNrFront);
-		for (iLoop = 1; iLoop <= (int)ulNrFront; iLoop++)
-		{
-			printf ("(");
-			switch (ulFrontTypeNr[ulFrontType[iLoop] + 1])
-			{
-				case 0x30: printf ("Torch"); break;
-				case 0x31: printf ("Pillar Front"); break;
-				case 0x32: printf ("Skeleton"); break;
-				case 0x33: printf ("Wall Top Left Slash"); break;
-				case 0x34: printf ("Wall Top Left Dot"); break;
-				case 0x35: printf ("Wall Bottom Left"); break;
-				case 0x36: printf ("Floor Climbable"); break;
-				default:
-					printf ("%lu (0x%02X)", /*** No WARN or \n. ***/
-						ulFrontTypeNr[ulFrontType[iLoop] + 1],
-						(int)ulFrontTypeNr[ulFrontType[iLoop] + 1]);
-					break;
-			}
-			printf (") X: %lu, Y: %lu, type: %lu, A: %lu, B: %lu\n",
-				ulFrontX[iLoop], ulFrontY[iLoop], ulFrontType[iLoop],
-				ulFrontA[iLoop], ulFrontB[iLoop]);
-		}
-		printf ("[ INFO ] Prince X: %lu, Y: %lu\n", ulPrinceX, ulPrinceY);
-		printf ("[ INFO ] Exit trigger X: %lu, Y: %lu\n",
-			ulExitTriggerX, ulExitTriggerY);
-		printf ("[ INFO ] Save trigger X: %lu, Y: %lu\n",
-			ulSaveTriggerX, ulSaveTriggerY);
-		printf ("[ INFO ] Entrance image X: %lu, Y: %lu\n",
-			ulEntranceImageX, ulEntranceImageY);
-		printf ("[ INFO ] Exit image X: %lu, Y: %lu\n",
-			ulExitImageX, ulExitImageY);
-		printf ("[ INFO ] # Chompers: %lu\n", ulNrChompers);
-		for (iLoop = 1; iLoop <= (int)ulNrChompers; iLoop++)
-		{
-			printf ("(Chomper) X: %lu, Y: %lu, A: %lu\n",
-				ulChomperX[iLoop], ulChomperY[iLoop], ulChomperA[iLoop]);
-		}
-		printf ("[ INFO ] # Spikes: %lu\n", ulNrSpikes);
-		for (iLoop = 1; iLoop <= (int)ulNrSpikes; iLoop++)
-		{
-			printf ("(Spikes) X: %lu, Y: %lu, right: %lu\n",
-				ulSpikeX[iLoop], ulSpikeY[iLoop], ulSpikeRight[iLoop]);
-		}
-		printf ("[ INFO ] # Gates: %lu\n", ulNrGates);
-		for (iLoop = 1; iLoop <= (int)ulNrGates; iLoop++)
-		{
-			printf ("(Gate) X: %lu, Y: %lu, time open: %lu\n",
-				ulGateX[iLoop], ulGateY[iLoop], ulGateTimeOpen[iLoop]);
-		}
-		printf ("[ INFO ] # Raise: %lu\n", ulNrRaise);
-		for (iLoop = 1; iLoop <= (int)ulNrRaise; iLoop++)
-		{
-			printf ("(Raise) Gate: %lu, X: %lu, Y: %lu\n",
-				ulRaiseGate[iLoop], ulRaiseX[iLoop], ulRaiseY[iLoop]);
-		}
-		printf ("[ INFO ] # Guards: %lu\n", ulNrGuards);
-		for (iLoop = 1; iLoop <= (int)ulNrGuards; iLoop++)
-		{
-			printf ("(Guard) X: %lu, Y: %lu, dir: %lu, HP: %lu,"
-				" A: %lu, B: %lu, C: %lu, D: %lu, E: %lu, F: %lu\n",
-				ulGuardX[iLoop], ulGuardY[iLoop], ulGuardDir[iLoop], ulGuardHP[iLoop],
-				ulGuardA[iLoop], ulGuardB[iLoop], ulGuardC[iLoop],
-				ulGuardD[iLoop], ulGuardE[iLoop], ulGuardF[iLoop]);
-		}
-		printf ("[ INFO ] # Potions (inc. save lamp anim.): %lu\n", ulNrPotions);
-		for (iLoop = 1; iLoop <= (int)ulNrPotions; iLoop++)
-		{
-			printf ("(Potion) Type: %lu, X: %lu, Y: %lu\n",
-				ulPotionType[iLoop], ulPotionX[iLoop], ulPotionY[iLoop]);
-		}
-		printf ("[ INFO ] # Loose: %lu\n", ulNrLoose);
-		for (iLoop = 1; iLoop <= (int)ulNrLoose; iLoop++)
-		{
-			printf ("(Loose) X: %lu, Y: %lu, right: %lu\n",
-				ulLooseX[iLoop], ulLooseY[iLoop], ulLooseRight[iLoop]);
-		}
-		printf ("[ INFO ] Text: %lu chars; %i lines\n", ulNrText, iNrLines);
-		for (iLoop = 1; iLoop <= iNrLines; iLoop++)
-		{
-			printf ("(Text) >%s<\n", arTextLine[iLoop]);
-		}
-	}
+	if (iDebug == 1) { LevelDump(); }
+
+	IndexRebuild();
+	FindRebuild (iLevel);
+	ReachRebuild();
+	iMiniFull = 1;
+	thumb[iLevel].iFresh = 0;
+	UndoClear();
+	iSelection = 0;
+	iSelecting = 0;
 
 	/*** Defaults. ***/
 	iXPosDragOffset = 0;
 	iYPosDragOffset = 0;
 }
 /*****************************************************************************/
+void LevelDump (void)
+/*****************************************************************************/
+{
+	/*** Shows the loaded level on the console; see -d and --batch=dump. ***/
+
+	/*** Used for looping. ***/
+	int iRowLoop, iColumnLoop;
+	int iLoop;
+
+	printf ("[ INFO ] # Back: %lux%lu\n", ulWidth, ulHeight);
+	for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
+	{
+		for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
+			{ printf ("%02X ", (int)ulBack[iRowLoop][iColumnLoop]); }
+		printf ("\n");
+	}
+	printf ("[ INFO ] # Unknown: %lu\n", ulNrUnknown);
+	for (iLoop = 1; iLoop <= (int)ulNrUnknown; iLoop++)
+	{
+		printf ("(Unknown) A: %lu, B: %lu, C: %lu, D: %lu\n",
+			ulUnknownA[iLoop], ulUnknownB[iLoop],
+			ulUnknownC[iLoop], ulUnknownD[iLoop]);
+	}
+	printf ("[ INFO ] Front types: %lu\n", ulFrontTypes);
+	for (iLoop = 1; iLoop <= (int)ulFrontTypes; iLoop++)
+	{
+		printf ("(Front type) A: %lu, B: %lu, Nr: %lu\n",
+			ulFrontTypeA[iLoop], ulFrontTypeB[iLoop], ulFrontTypeNr[iLoop]);
+	}
+	DumpKind (KIND_FRONT);
+	printf ("[ INFO ] Prince X: %lu, Y: %lu\n", ulPrinceX, ulPrinceY);
+	printf ("[ INFO ] Exit trigger X: %lu, Y: %lu\n",
+		ulExitTriggerX, ulExitTriggerY);
+	printf ("[ INFO ] Save trigger X: %lu, Y: %lu\n",
+		ulSaveTriggerX, ulSaveTriggerY);
+	printf ("[ INFO ] Entrance image X: %lu, Y: %lu\n",
+		ulEntranceImageX, ulEntranceImageY);
+	printf ("[ INFO ] Exit image X: %lu, Y: %lu\n",
+		ulExitImageX, ulExitImageY);
+	for (iLoop = KIND_CHOMPERS; iLoop <= KIND_LOOSE; iLoop++)
+		{ DumpKind (iLoop); }
+	printf ("[ INFO ] Text: %lu chars; %i lines\n", ulNrText, iNrLines);
+	for (iLoop = 1; iLoop <= iNrLines; iLoop++)
+	{
+		printf ("(Text) >%s<\n", arTextLine[iLoop]);
+	}
+}
+/*****************************************************************************/
 void InitScreenAction (char *sAction)
 /*****************************************************************************/
 {
 	int iDelXPosOld, iDelYPosOld;
 	int iDelXOld, iDelYOld;
 	int iX, iY;
+	int iKind, iSlot;
 
 	if (strcmp (sAction, "in") == 0)
 	{
@@ -1125,7 +1758,7 @@ void InitScreenAction (char *sAction)
 
 	if (strcmp (sAction, "del") == 0)
 	{
-		iXYNear = 10000;
+		iXYNear = MAX_NEAR;
 		iDelXOld = iDelX;
 		iDelYOld = iDelY;
 		iDelXPosOld = iDelXPos;
@@ -1134,57 +1767,32 @@ void InitScreenAction (char *sAction)
 		iX = (iXPos - MapStartX()) / iZoom;
 		iY = (iYPos - MapStartY()) / iZoom;
 
-		DelWhat (1, iX, iY); /*** front ***/
-		DelWhat (2, iX, iY); /*** chompers ***/
-		DelWhat (3, iX, iY); /*** spikes ***/
-		DelWhat (4, iX, iY); /*** gates ***/
-		DelWhat (5, iX, iY); /*** raise ***/
-		DelWhat (6, iX, iY); /*** guards ***/
-		DelWhat (7, iX, iY); /*** potions ***/
-		DelWhat (8, iX, iY); /*** loose ***/
+		if (NearestObject (iX, iY, iXYNear, &iKind, &iSlot) != -1)
+		{
+			iDelWhat = iKind;
+			iDelSlot = iSlot;
+			iDelX = ent[iKind].arEnt[iSlot].ulX;
+			iDelY = ent[iKind].arEnt[iSlot].ulY;
+			iDelXPos = iXPos;
+			iDelYPos = iYPos;
+		}
 
 		if ((iDelXPosOld == iDelXPos) && (iDelYPosOld == iDelYPos) &&
 			(iDelXOld == iDelX) && (iDelYOld == iDelY))
 		{
-			switch (iDelWhat)
+			if ((int)ent[iDelWhat].ulNr <= kind[iDelWhat].iMin)
 			{
-				case 1: /*** front ***/
-					if (ulNrFront == 1)
-					{
-						snprintf (sWarning, MAX_WARNING, "%s",
-							"Cannot remove: each level must have 1+ front.");
-						Warning();
-					} else { Del(); }
-					break;
-				case 2: Del(); break; /*** chompers ***/
-				case 3: /*** spikes ***/
-					if (ulNrSpikes == 1)
-					{
-						snprintf (sWarning, MAX_WARNING, "%s",
-							"Cannot remove: each level must have 1+ spikes.");
-						Warning();
-					} else { Del(); }
-					break;
-				case 4: /*** gates ***/
-					if (ulNrGates == 1)
-					{
-						snprintf (sWarning, MAX_WARNING, "%s",
-							"Cannot remove: each level must have 1+ gates.");
-						Warning();
-					} else { Del(); }
-					break;
-				case 5: Del(); break; /*** raise ***/
-				case 6: Del(); break; /*** guards ***/
-				case 7: /*** potions ***/
-					if (ulNrPotions == 1)
-					{
-						snprintf (sWarning, MAX_WARNING, "%s",
-							"Cannot remove: each level must have 1+ potions.");
-						Warning();
-					} else { Del(); }
-					break;
-				case 8: Del(); break; /*** loose ***/
-			}
+				snprintf (sWarning, MAX_WARNING,
+					"Cannot remove: each level must have %i+ %s.",
+					kind[iDelWhat].iMin, kind[iDelWhat].sPlural);
+				Warning();
+			} else if ((iDelWhat == KIND_GATES) &&
+				(iLinkFirst[iDelSlot] != -1)) {
+				snprintf (sWarning, MAX_WARNING,
+					"Cannot remove: %i raise plate(s) open this gate.",
+					LinkCount (iDelSlot));
+				Warning();
+			} else { Del(); }
 
 			iDelX = -1;
 			iDelY = -1;
@@ -1201,13 +1809,10 @@ void InitScreen (void)
 	int iJoyNr;
 	SDL_Rect barbox;
 	SDL_Event event;
-	char sBack[MAX_FILE + 2];
 	int iOldXPos, iOldYPos;
 	const Uint8 *keystate;
 	int iXJoy1, iYJoy1, iXJoy2, iYJoy2;
-
-	/*** Used for looping. ***/
-	int iBackLoop;
+	int iRedraw;
 
 	if (SDL_Init (SDL_INIT_AUDIO|SDL_INIT_VIDEO|
 		SDL_INIT_GAMECONTROLLER|SDL_INIT_HAPTIC) < 0)
@@ -1275,10 +1880,10 @@ void InitScreen (void)
 	/*** icon ***/
 	snprintf (sImage, MAX_IMG, "png%svarious%spophale_icon.png",
 		SLASH, SLASH);
-	imgicon = IMG_Load (sImage);
+	imgicon = IMG_Load_RW (AssetOpen (sImage), 1);
 	if (imgicon == NULL)
 	{
-		printf ("[ WARN ] Could not load \"%s\": %s!\n", sImage, strerror (errno));
+		printf ("[ WARN ] Could not load \"%s\": %s!\n", sImage, IMG_GetError());
 	} else {
 		SDL_SetWindowIcon (window, imgicon);
 	}
@@ -1334,7 +1939,10 @@ void InitScreen (void)
 	/*******************/
 
 	/*** Loading... ***/
+	if (iNoCache == 0) { CreateDir (DIR_CACHE); }
+	ulPreLoadStart = SDL_GetTicks();
 	PreLoad (PNG_VARIOUS, "loading.png", &imgloading);
+	PreLoadRun (0);
 	ShowImage (imgloading, 0, 0, "imgloading", ascreen, iScale, 1);
 	SDL_SetRenderDrawColor (ascreen, 0x22, 0x22, 0x22, SDL_ALPHA_OPAQUE);
 	barbox.x = 10 * iScale;
@@ -1346,164 +1954,35 @@ void InitScreen (void)
 
 	iPreLoaded = 0;
 	iCurrentBarHeight = 0;
-	iNrToPreLoad = 133; /*** Value can be obtained via debug mode. ***/
 	SDL_SetCursor (curWait);
 
-	/*** back ***/
-	for (iBackLoop = 0; iBackLoop <= 55; iBackLoop++)
-	{
-		snprintf (sBack, MAX_FILE, "%02X.png", iBackLoop);
-		PreLoad (PNG_BACK, sBack, &imgback[iBackLoop]);
-	}
-	PreLoad (PNG_VARIOUS, "back_tiles.png", &imgbacktiles);
-	PreLoad (PNG_VARIOUS, "hover_back_l.png", &imghoverbackl);
-	PreLoad (PNG_VARIOUS, "hover_back_l_live.png", &imghoverbackllive);
-
-	/*** front ***/
-	PreLoad (PNG_VARIOUS, "front.png", &imgfront);
-	PreLoad (PNG_VARIOUS, "hover_front.png", &imghoverfront);
-
-	/*** buttons ***/
-	if (iController != 1)
-	{
-		PreLoad (PNG_BUTTONS, "previous_off.png", &imgprevoff);
-		PreLoad (PNG_BUTTONS, "previous_on_0.png", &imgprevon_0);
-		PreLoad (PNG_BUTTONS, "previous_on_1.png", &imgprevon_1);
-		PreLoad (PNG_BUTTONS, "next_off.png", &imgnextoff);
-		PreLoad (PNG_BUTTONS, "next_on_0.png", &imgnexton_0);
-		PreLoad (PNG_BUTTONS, "next_on_1.png", &imgnexton_1);
-		PreLoad (PNG_BUTTONS, "exe_off.png", &imgexeoff);
-		PreLoad (PNG_BUTTONS, "exe_on_0.png", &imgexeon_0);
-		PreLoad (PNG_BUTTONS, "exe_on_1.png", &imgexeon_1);
-		PreLoad (PNG_BUTTONS, "OK.png", &imgok[1]);
-		PreLoad (PNG_BUTTONS, "sel_OK.png", &imgok[2]);
-		PreLoad (PNG_BUTTONS, "close_0.png", &imgclose[1]);
-		PreLoad (PNG_BUTTONS, "close_1.png", &imgclose[2]);
-		PreLoad (PNG_BUTTONS, "save_off.png", &imgsaveoff);
-		PreLoad (PNG_BUTTONS, "save_on_0.png", &imgsaveon_0);
-		PreLoad (PNG_BUTTONS, "save_on_1.png", &imgsaveon_1);
-		PreLoad (PNG_BUTTONS, "Yes.png", &imgyes[1]);
-		PreLoad (PNG_BUTTONS, "sel_Yes.png", &imgyes[2]);
-		PreLoad (PNG_BUTTONS, "No.png", &imgno[1]);
-		PreLoad (PNG_BUTTONS, "sel_No.png", &imgno[2]);
-		PreLoad (PNG_BUTTONS, "quit_0.png", &imgquit_0);
-		PreLoad (PNG_BUTTONS, "quit_1.png", &imgquit_1);
-		PreLoad (PNG_BUTTONS, "Save.png", &imgsave[1]);
-		PreLoad (PNG_BUTTONS, "sel_Save.png", &imgsave[2]);
-		PreLoad (PNG_BUTTONS, "text_off.png", &imgtextoff);
-		PreLoad (PNG_BUTTONS, "text_on_0.png", &imgtexton_0);
-		PreLoad (PNG_BUTTONS, "text_on_1.png", &imgtexton_1);
-		PreLoad (PNG_BUTTONS, "playtest_off.png", &imgplayoff);
-		PreLoad (PNG_BUTTONS, "playtest_on_0.png", &imgplayon_0);
-		PreLoad (PNG_BUTTONS, "playtest_on_1.png", &imgplayon_1);
-		PreLoad (PNG_BUTTONS, "help_off.png", &imghelpoff);
-		PreLoad (PNG_BUTTONS, "help_on_0.png", &imghelpon_0);
-		PreLoad (PNG_BUTTONS, "help_on_1.png", &imghelpon_1);
-	} else {
-		PreLoad (PNG_GAMEPAD, "previous_off.png", &imgprevoff);
-		PreLoad (PNG_GAMEPAD, "previous_on_0.png", &imgprevon_0);
-		PreLoad (PNG_GAMEPAD, "previous_on_1.png", &imgprevon_1);
-		PreLoad (PNG_GAMEPAD, "next_off.png", &imgnextoff);
-		PreLoad (PNG_GAMEPAD, "next_on_0.png", &imgnexton_0);
-		PreLoad (PNG_GAMEPAD, "next_on_1.png", &imgnexton_1);
-		PreLoad (PNG_GAMEPAD, "exe_off.png", &imgexeoff);
-		PreLoad (PNG_GAMEPAD, "exe_on_0.png", &imgexeon_0);
-		PreLoad (PNG_GAMEPAD, "exe_on_1.png", &imgexeon_1);
-		PreLoad (PNG_GAMEPAD, "OK.png", &imgok[1]);
-		PreLoad (PNG_GAMEPAD, "sel_OK.png", &imgok[2]);
-		PreLoad (PNG_GAMEPAD, "close_0.png", &imgclose[1]);
-		PreLoad (PNG_GAMEPAD, "close_1.png", &imgclose[2]);
-		PreLoad (PNG_GAMEPAD, "save_off.png", &imgsaveoff);
-		PreLoad (PNG_GAMEPAD, "save_on_0.png", &imgsaveon_0);
-		PreLoad (PNG_GAMEPAD, "save_on_1.png", &imgsaveon_1);
-		PreLoad (PNG_GAMEPAD, "Yes.png", &imgyes[1]);
-		PreLoad (PNG_GAMEPAD, "sel_Yes.png", &imgyes[2]);
-		PreLoad (PNG_GAMEPAD, "No.png", &imgno[1]);
-		PreLoad (PNG_GAMEPAD, "sel_No.png", &imgno[2]);
-		PreLoad (PNG_GAMEPAD, "quit_0.png", &imgquit_0);
-		PreLoad (PNG_GAMEPAD, "quit_1.png", &imgquit_1);
-		PreLoad (PNG_GAMEPAD, "Save.png", &imgsave[1]);
-		PreLoad (PNG_GAMEPAD, "sel_Save.png", &imgsave[2]);
-		PreLoad (PNG_GAMEPAD, "text_off.png", &imgtextoff);
-		PreLoad (PNG_GAMEPAD, "text_on_0.png", &imgtexton_0);
-		PreLoad (PNG_GAMEPAD, "text_on_1.png", &imgtexton_1);
-		PreLoad (PNG_GAMEPAD, "playtest_off.png", &imgplayoff);
-		PreLoad (PNG_GAMEPAD, "playtest_on_0.png", &imgplayon_0);
-		PreLoad (PNG_GAMEPAD, "playtest_on_1.png", &imgplayon_1);
-		PreLoad (PNG_GAMEPAD, "help_off.png", &imghelpoff);
-		PreLoad (PNG_GAMEPAD, "help_on_0.png", &imghelpon_0);
-		PreLoad (PNG_GAMEPAD, "help_on_1.png", &imghelpon_1);
-	}
-
-	/*** various ***/
-	PreLoad (PNG_VARIOUS, "black.png", &imgblack);
-	PreLoad (PNG_VARIOUS, "interface.png", &imginterface);
-	PreLoad (PNG_VARIOUS, "exe.png", &imgexe);
-	PreLoad (PNG_VARIOUS, "text.png", &imgtext);
-	PreLoad (PNG_VARIOUS, "hover_text.png", &imghovertext);
-	PreLoad (PNG_VARIOUS, "help.png", &imghelp);
-	PreLoad (PNG_VARIOUS, "hover_back_s.png", &imghoverbacks);
-	PreLoad (PNG_VARIOUS, "entrance.png", &imgentrance);
-	PreLoad (PNG_VARIOUS, "exit.png", &imgexit);
-	PreLoad (PNG_VARIOUS, "prince_r.png", &imgprincer);
-	PreLoad (PNG_VARIOUS, "exit_trigger.png", &imgexittrigger);
-	PreLoad (PNG_VARIOUS, "save_trigger.png", &imgsavetrigger);
-	PreLoad (PNG_VARIOUS, "chomper.png", &imgchomper);
-	PreLoad (PNG_VARIOUS, "spikes_0.png", &imgspikes0);
-	PreLoad (PNG_VARIOUS, "spikes_1.png", &imgspikes1);
-	PreLoad (PNG_VARIOUS, "gate.png", &imggate);
-	PreLoad (PNG_VARIOUS, "raise.png", &imgraise);
-	PreLoad (PNG_VARIOUS, "guard_r.png", &imgguardr);
-	PreLoad (PNG_VARIOUS, "guard_l.png", &imgguardl);
-	PreLoad (PNG_VARIOUS, "potion_0.png", &imgpotion0);
-	PreLoad (PNG_VARIOUS, "potion_1.png", &imgpotion1);
-	PreLoad (PNG_VARIOUS, "potion_2.png", &imgpotion2);
-	PreLoad (PNG_VARIOUS, "potion_3.png", &imgpotion3);
-	PreLoad (PNG_VARIOUS, "loose_0.png", &imgloose0);
-	PreLoad (PNG_VARIOUS, "loose_1.png", &imgloose1);
-	PreLoad (PNG_VARIOUS, "faded.png", &imgfaded);
-	PreLoad (PNG_VARIOUS, "popup_yn.png", &imgpopup_yn);
-	PreLoad (PNG_VARIOUS, "emulator.png", &imgemulator);
-	PreLoad (PNG_VARIOUS, "delete.png", &imgdelete);
-	PreLoad (PNG_VARIOUS, "statusbar_sprite.png", &imgstatusbarsprite);
-	PreLoad (PNG_VARIOUS, "popup.png", &imgpopup);
-	PreLoad (PNG_VARIOUS, "chk_black.png", &imgchkb);
-
-	/*** front ***/
-	PreLoad (PNG_FRONT, "torch_sprite.png", &imgtorchsprite);
-	PreLoad (PNG_FRONT, "pillar_front.png", &imgpillarfront);
-	PreLoad (PNG_FRONT, "skeleton.png", &imgskeleton);
-	PreLoad (PNG_FRONT, "wall_top_left_slash.png", &imgwalltopleftslash);
-	PreLoad (PNG_FRONT, "wall_top_left_dot.png", &imgwalltopleftdot);
-	PreLoad (PNG_FRONT, "floor_climbable.png", &imgfloorclimbable);
-	PreLoad (PNG_FRONT, "wall_bottom_left.png", &imgwallbottomleft);
+	iPrefetching = -1;
+	AssetLoad (ASSET_MAP, 1);
 
 	if (iDebug == 1)
-		{ printf ("[ INFO ] Preloaded images: %i\n", iPreLoaded); }
+	{
+		printf ("[ INFO ] Preloaded images: %i (%lu ms)\n", iPreLoaded,
+			(unsigned long)(SDL_GetTicks() - ulPreLoadStart));
+	}
 	SDL_SetCursor (curArrow);
 
 	/*** Defaults. ***/
 	iCurLevel = iStartLevel;
 	iDownAt = 0;
 	iDraggingMap = 0;
-	iFlameFrame = 1;
-	oldticks = 0;
-	oldticksf = 0;
+	InitAnim (ANIM_TORCH, 5, FPS_TORCH);
 
 	ShowScreen();
 	InitPopUp();
+	JournalOffer();
 	while (1)
 	{
-		if (iNoAnim == 0)
-		{
-			/*** This is for the animation; ~30 fps (1000/33). ***/
-			newticks = SDL_GetTicks();
-			if (newticks > oldticks + REFRESH_GAME)
-			{
-				ShowScreen();
-				oldticks = newticks;
-			}
-		}
+		/*** Only redraw if the torches changed. ***/
+		iRedraw = 0;
+		if (AnimTick (ANIM_TORCH) == 1) { iRedraw = 1; }
+
+		/*** Meanwhile, load the images of other screens. ***/
+		AssetPrefetch();
 
 		while (SDL_PollEvent (&event))
 		{
@@ -1543,7 +2022,7 @@ void InitScreen (void)
 							if (iHoverRow < (int)ulHeight) { iHoverRow++; }
 							break;
 					}
-					ShowScreen();
+					iRedraw = 1;
 					break;
 				case SDL_CONTROLLERAXISMOTION: /*** triggers and analog sticks ***/
 					iXJoy1 = SDL_JoystickGetAxis (joystick, 0);
@@ -1602,7 +2081,7 @@ void InitScreen (void)
 							trigright = SDL_GetTicks();
 						}
 					}
-					ShowScreen();
+					iRedraw = 1;
 					break;
 				case SDL_KEYDOWN: /*** https://wiki.libsdl.org/SDL2/SDL_Keycode ***/
 					switch (event.key.keysym.sym)
@@ -1635,13 +2114,66 @@ void InitScreen (void)
 								if (iDraggingMap == 0) { ChangeBack(); }
 							}
 							break;
-						case SDLK_f: Zoom (1); break;
-						case SDLK_z: Zoom (0); break;
-						case SDLK_d: Playtest(); break;
+						case SDLK_f:
+							if ((event.key.keysym.mod & KMOD_LCTRL) ||
+								(event.key.keysym.mod & KMOD_RCTRL))
+							{
+								FindToggle();
+							} else {
+								Zoom (1);
+							}
+							break;
+						case SDLK_r:
+							if ((event.key.keysym.mod & KMOD_LCTRL) ||
+								(event.key.keysym.mod & KMOD_RCTRL))
+							{
+								FindReplaceAll();
+							} else {
+								iReachShow = 1 - iReachShow;
+								PlaySound ("wav/check_box.wav");
+							}
+							break;
+						case SDLK_m:
+							iMiniShow = 1 - iMiniShow;
+							PlaySound ("wav/check_box.wav");
+							break;
+						case SDLK_g:
+							Gallery();
+							break;
+						case SDLK_z:
+							if ((event.key.keysym.mod & KMOD_LCTRL) ||
+								(event.key.keysym.mod & KMOD_RCTRL))
+							{
+								Undo();
+							} else {
+								Zoom (0);
+							}
+							break;
+						case SDLK_y:
+							if ((event.key.keysym.mod & KMOD_LCTRL) ||
+								(event.key.keysym.mod & KMOD_RCTRL))
+								{ Redo(); }
+							break;
+						case SDLK_d:
+							if ((event.key.keysym.mod & KMOD_LCTRL) ||
+								(event.key.keysym.mod & KMOD_RCTRL))
+							{
+								iSelection = 0;
+							} else {
+								Playtest();
+							}
+							break;
 						case SDLK_QUOTE:
-							ulBack[iHoverRow][iHoverColumn] = iLastBack;
-							PlaySound ("wav/ok_close.wav");
-							iChanged++;
+							if (((event.key.keysym.mod & KMOD_LCTRL) ||
+								(event.key.keysym.mod & KMOD_RCTRL)) &&
+								(iSelection == 1))
+							{
+								SelectionFill (iLastBack);
+							} else {
+								SetBack (iHoverRow, iHoverColumn, iLastBack);
+								PlaySound ("wav/ok_close.wav");
+								iChanged++;
+							}
 							break;
 						case SDLK_ESCAPE:
 						case SDLK_q:
@@ -1709,15 +2241,49 @@ void InitScreen (void)
 								if (iHoverRow < (int)ulHeight) { iHoverRow++; }
 							}
 							break;
+						case SDLK_a:
+							if ((event.key.keysym.mod & KMOD_LCTRL) ||
+								(event.key.keysym.mod & KMOD_RCTRL))
+							{
+								iSelRow1 = 1;
+								iSelColumn1 = 1;
+								iSelRow2 = ulHeight;
+								iSelColumn2 = ulWidth;
+								iSelection = 1;
+							}
+							break;
+						case SDLK_c:
+							if (((event.key.keysym.mod & KMOD_LCTRL) ||
+								(event.key.keysym.mod & KMOD_RCTRL)) &&
+								(iSelection == 1)) { SelectionCopy(); }
+							break;
+						case SDLK_x:
+							if (((event.key.keysym.mod & KMOD_LCTRL) ||
+								(event.key.keysym.mod & KMOD_RCTRL)) &&
+								(iSelection == 1))
+							{
+								SelectionCopy();
+								SelectionFill (0x04);
+							}
+							break;
+						case SDLK_v:
+							if ((event.key.keysym.mod & KMOD_LCTRL) ||
+								(event.key.keysym.mod & KMOD_RCTRL))
+								{ SelectionPaste(); }
+							break;
+						case SDLK_b:
+							FloodFill (iHoverRow, iHoverColumn, iLastBack);
+							break;
 						case SDLK_h:
 							if (iHideFront == 0)
 								{ iHideFront = 1; } else { iHideFront = 0; }
 							PlaySound ("wav/check_box.wav");
 							break;
 					}
-					ShowScreen();
+					iRedraw = 1;
 					break;
 				case SDL_MOUSEMOTION:
+					LatestMotion (&event);
 					iOldXPos = iXPos;
 					iOldYPos = iYPos;
 					iXPos = event.motion.x;
@@ -1737,6 +2303,14 @@ void InitScreen (void)
 						SDL_SetCursor (curArrow);
 					}
 
+					if (iSelecting == 1)
+					{
+						iSelRow2 = iHoverRow;
+						iSelColumn2 = iHoverColumn;
+					}
+
+					if ((iMiniDragging == 1) && (MiniAt() == 1)) { MiniJump(); }
+
 					if (iDraggingMap == 1)
 					{
 						iXPosDragOffset += (iXPos - iXPosDragStart);
@@ -1748,7 +2322,7 @@ void InitScreen (void)
 						SDL_SetCursor (curHand);
 					}
 
-					ShowScreen();
+					iRedraw = 1;
 					break;
 				case SDL_MOUSEBUTTONDOWN:
 					if (InArea (2, 2, 2 + 25, 2 + 25) == 1) /*** prev level ***/
@@ -1767,12 +2341,26 @@ void InitScreen (void)
 						{ iDownAt = 7; }
 					if (InArea (685, 655, 685 + 25, 655 + 25) == 1) /*** quit ***/
 						{ iDownAt = 8; }
-					if (InArea (MAP_LEFT, MAP_TOP, MAP_LEFT + MAP_WIDTH,
+					if (MiniAt() == 1) /*** minimap ***/
+					{
+						MiniJump();
+						iMiniDragging = 1;
+					} else if (InArea (MAP_LEFT, MAP_TOP, MAP_LEFT + MAP_WIDTH,
 						MAP_TOP + MAP_HEIGHT) == 1) /*** map ***/
 					{
-						/*** Start map dragging. ***/
-						if (iDraggingMap == 0)
+						keystate = SDL_GetKeyboardState (NULL);
+						if ((keystate[SDL_SCANCODE_LCTRL]) ||
+							(keystate[SDL_SCANCODE_RCTRL]))
 						{
+							/*** Start selecting. ***/
+							iSelRow1 = iHoverRow;
+							iSelColumn1 = iHoverColumn;
+							iSelRow2 = iHoverRow;
+							iSelColumn2 = iHoverColumn;
+							iSelection = 1;
+							iSelecting = 1;
+						} else if (iDraggingMap == 0) {
+							/*** Start map dragging. ***/
 							iXPosDragStart = iXPos;
 							iYPosDragStart = iYPos;
 							iDraggingMap = 1;
@@ -1780,11 +2368,25 @@ void InitScreen (void)
 							iDraggingMoved = 0;
 						}
 					}
-					ShowScreen();
+					iRedraw = 1;
 					break;
 				case SDL_MOUSEBUTTONUP:
 					iDownAt = 0;
 
+					if (iMiniDragging == 1)
+					{
+						iMiniDragging = 0;
+						iRedraw = 1;
+						break; /*** Exit case SDL_MOUSEBUTTONUP. ***/
+					}
+
+					if (iSelecting == 1)
+					{
+						iSelecting = 0;
+						iRedraw = 1;
+						break; /*** Exit case SDL_MOUSEBUTTONUP. ***/
+					}
+
 					/*** Stop map dragging. ***/
 					if (iDraggingMap == 1)
 					{
@@ -1834,7 +2436,7 @@ void InitScreen (void)
 								if ((keystate[SDL_SCANCODE_LSHIFT]) ||
 									(keystate[SDL_SCANCODE_RSHIFT]))
 								{
-									ulBack[iHoverRow][iHoverColumn] = iLastBack;
+									SetBack (iHoverRow, iHoverColumn, iLastBack);
 									PlaySound ("wav/ok_close.wav");
 									iChanged++;
 								} else {
@@ -1866,283 +2468,115 @@ void InitScreen (void)
 						}
 					}
 
-					ShowScreen();
+					iRedraw = 1;
 					break;
 				case SDL_MOUSEWHEEL:
 					if (event.wheel.y > 0) /*** scroll wheel up ***/
 						{ InitScreenAction ("in"); }
 					if (event.wheel.y < 0) /*** scroll wheel down ***/
 						{ InitScreenAction ("out"); }
-					ShowScreen();
+					iRedraw = 1;
 					break;
 				case SDL_WINDOWEVENT:
 					if (event.window.event == SDL_WINDOWEVENT_EXPOSED)
-						{ ShowScreen(); } break;
+						{ iRedraw = 1; } break;
 				case SDL_QUIT:
 					Quit(); break;
 				default: break;
 			}
 		}
 
+		/*** Draw (and present) at most once per loop. ***/
+		if (iRedraw == 1) { ShowScreen(); }
+
+		JournalFlush (0);
+
 		/*** prevent CPU eating ***/
-		gamespeed = REFRESH_PROG;
-		while ((SDL_GetTicks() - looptime) < gamespeed)
-		{
-			SDL_Delay (10);
-		}
-		looptime = SDL_GetTicks();
+		AnimSleep (ANIM_TORCH);
 	}
 }
 /*****************************************************************************/
 void ShowFrontTiles (void)
 /*****************************************************************************/
 {
+	int iKind;
+	int iSlot;
+	struct entity *stEnt;
+
 	/*** Used for looping. ***/
 	int iLoop;
 
 	/*** entrance image ***/
 	ShowImage (imgentrance,
-		MapStartX() + (ulEntranceImageX * iZoom) - (19 * iZoom),
-		MapStartY() + (ulEntranceImageY * iZoom) - (33 * iZoom),
+		iMapStartX + (ulEntranceImageX * iZoom) - (19 * iZoom),
+		iMapStartY + (ulEntranceImageY * iZoom) - (33 * iZoom),
 		"imgentrance", ascreen, iZoom, 0);
 
 	/*** exit image ***/
 	ShowImage (imgexit,
-		MapStartX() + (ulExitImageX * iZoom) - (19 * iZoom),
-		MapStartY() + (ulExitImageY * iZoom) - (33 * iZoom),
+		iMapStartX + (ulExitImageX * iZoom) - (19 * iZoom),
+		iMapStartY + (ulExitImageY * iZoom) - (33 * iZoom),
 		"imgexit", ascreen, iZoom, 0);
 
 	/*** prince ***/
 	ShowImage (imgprincer,
-		MapStartX() + (ulPrinceX * iZoom) - (3 * iZoom),
-		MapStartY() + (ulPrinceY * iZoom) - (26 * iZoom),
+		iMapStartX + (ulPrinceX * iZoom) - (3 * iZoom),
+		iMapStartY + (ulPrinceY * iZoom) - (26 * iZoom),
 		"imgprincer", ascreen, iZoom, 0);
 
 	/*** exit trigger ***/
 	ShowImage (imgexittrigger,
-		MapStartX() + (ulExitTriggerX * iZoom) - (9 * iZoom),
-		MapStartY() + (ulExitTriggerY * iZoom) - (9 * iZoom),
+		iMapStartX + (ulExitTriggerX * iZoom) - (9 * iZoom),
+		iMapStartY + (ulExitTriggerY * iZoom) - (9 * iZoom),
 		"imgexittrigger", ascreen, iZoom, 0);
 
 	/*** save trigger ***/
 	ShowImage (imgsavetrigger,
-		MapStartX() + (ulSaveTriggerX * iZoom) - (9 * iZoom),
-		MapStartY() + (ulSaveTriggerY * iZoom) - (9 * iZoom),
+		iMapStartX + (ulSaveTriggerX * iZoom) - (9 * iZoom),
+		iMapStartY + (ulSaveTriggerY * iZoom) - (9 * iZoom),
 		"imgsavetrigger", ascreen, iZoom, 0);
 
-	/*** chompers ***/
-	for (iLoop = 1; iLoop <= (int)ulNrChompers; iLoop++)
-	{
-		ShowImage (imgchomper,
-			MapStartX() + (ulChomperX[iLoop] * iZoom) - (8 * iZoom),
-			MapStartY() + (ulChomperY[iLoop] * iZoom) - (46 * iZoom),
-			"imgchomper", ascreen, iZoom, 0);
-	}
-
-	/*** spikes ***/
-	for (iLoop = 1; iLoop <= (int)ulNrSpikes; iLoop++)
+	/*** chompers, spikes, gates, raise, guards, potions, loose, (blue) front ***/
+	for (iLoop = 0; iLoop < MAX_KINDS; iLoop++)
 	{
-		switch (ulSpikeRight[iLoop])
+		iKind = iDrawOrder[iLoop];
+		for (iSlot = ent[iKind].iFirst; iSlot != -1; iSlot = stEnt->iNext)
 		{
-			case 0:
-				ShowImage (imgspikes0,
-					MapStartX() + (ulSpikeX[iLoop] * iZoom) - (10 * iZoom),
-					MapStartY() + (ulSpikeY[iLoop] * iZoom) - (24 * iZoom),
-					"imgspikes0", ascreen, iZoom, 0);
-				break;
-			case 1:
-				ShowImage (imgspikes1,
-					MapStartX() + (ulSpikeX[iLoop] * iZoom) - (10 * iZoom),
-					MapStartY() + (ulSpikeY[iLoop] * iZoom) - (24 * iZoom),
-					"imgspikes1", ascreen, iZoom, 0);
-				break;
-			default:
-				printf ("[ WARN ] Unknown spikes right: %lu!\n", ulSpikeRight[iLoop]);
-				break;
+			stEnt = &ent[iKind].arEnt[iSlot];
+			if (iVisible[iKind][iSlot] == iVisibleStamp)
+				{ ShowEntity (iKind, iSlot); }
 		}
 	}
+}
+/*****************************************************************************/
+void ShowScreen (void)
+/*****************************************************************************/
+{
+	int iX, iY;
+	int iXFull, iYFull;
+	int iKind, iSlot;
+	int iTop, iLeft, iBottom, iRight;
+	int iCell;
+	SDL_Rect selbox;
 
-	/*** gates ***/
-	for (iLoop = 1; iLoop <= (int)ulNrGates; iLoop++)
-	{
-		ShowImage (imggate,
-			MapStartX() + (ulGateX[iLoop] * iZoom) - (6 * iZoom),
-			MapStartY() + (ulGateY[iLoop] * iZoom) - (46 * iZoom),
-			"imggate", ascreen, iZoom, 0);
-		snprintf (arText[0], MAX_TEXT, "%i", iLoop - 1);
-		DisplayText (MapStartX() + (ulGateX[iLoop] * iZoom) - (1 * iZoom),
-			MapStartY() + (ulGateY[iLoop] * iZoom) - (42 * iZoom),
-			(10 * iZoom) / iScale, 1, color_wh, 0);
-	}
+	/*** Used for looping. ***/
+	int iRowLoop, iColumnLoop;
 
-	/*** raise ***/
-	for (iLoop = 1; iLoop <= (int)ulNrRaise; iLoop++)
-	{
-		ShowImage (imgraise,
-			MapStartX() + (ulRaiseX[iLoop] * iZoom) - (14 * iZoom),
-			MapStartY() + (ulRaiseY[iLoop] * iZoom) - (15 * iZoom),
-			"imgraise", ascreen, iZoom, 0);
-		snprintf (arText[0], MAX_TEXT, "%lu", ulRaiseGate[iLoop]);
-		DisplayText (MapStartX() + (ulRaiseX[iLoop] * iZoom) - (4 * iZoom),
-			MapStartY() + (ulRaiseY[iLoop] * iZoom) - (15 * iZoom),
-			(10 * iZoom) / iScale, 1, color_wh, 0);
-	}
+	iMapStartX = MapStartX();
+	iMapStartY = MapStartY();
 
-	/*** guards ***/
-	for (iLoop = 1; iLoop <= (int)ulNrGuards; iLoop++)
-	{
-		switch (ulGuardDir[iLoop])
-		{
-			case 0: /*** left ***/
-				ShowImage (imgguardl,
-					MapStartX() + (ulGuardX[iLoop] * iZoom) - (13 * iZoom),
-					MapStartY() + (ulGuardY[iLoop] * iZoom) - (27 * iZoom),
-					"imgguardl", ascreen, iZoom, 0);
-				break;
-			case 1: /*** right ***/
-				ShowImage (imgguardr,
-					MapStartX() + (ulGuardX[iLoop] * iZoom) - (13 * iZoom),
-					MapStartY() + (ulGuardY[iLoop] * iZoom) - (27 * iZoom),
-					"imgguardr", ascreen, iZoom, 0);
-				break;
-		}
-	}
+	/*** black ***/
+	ShowImage (imgblack, 0, 0, "imgblack", ascreen, iScale, 1);
 
-	/*** potions ***/
-	for (iLoop = 1; iLoop <= (int)ulNrPotions; iLoop++)
+	/*** back ***/
+	iY = 0;
+	for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
 	{
-		switch (ulPotionType[iLoop])
+		iX = 0;
+		for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
 		{
-			case 0: /*** life potion ***/
-				ShowImage (imgpotion0,
-					MapStartX() + (ulPotionX[iLoop] * iZoom) - (4 * iZoom),
-					MapStartY() + (ulPotionY[iLoop] * iZoom) - (7 * iZoom),
-					"imgpotion0", ascreen, iZoom, 0);
-				break;
-			case 1: /*** hurt potion ***/
-				ShowImage (imgpotion1,
-					MapStartX() + (ulPotionX[iLoop] * iZoom) - (3 * iZoom),
-					MapStartY() + (ulPotionY[iLoop] * iZoom) - (7 * iZoom),
-					"imgpotion1", ascreen, iZoom, 0);
-				break;
-			case 2: /*** health potion ***/
-				ShowImage (imgpotion2,
-					MapStartX() + (ulPotionX[iLoop] * iZoom) - (3 * iZoom),
-					MapStartY() + (ulPotionY[iLoop] * iZoom) - (6 * iZoom),
-					"imgpotion2", ascreen, iZoom, 0);
-				break;
-			case 3: /*** save lamp animation ***/
-				ShowImage (imgpotion3,
-					MapStartX() + (ulPotionX[iLoop] * iZoom) - (11 * iZoom),
-					MapStartY() + (ulPotionY[iLoop] * iZoom) - (12 * iZoom),
-					"imgpotion3", ascreen, iZoom, 0);
-				break;
-			default:
-				printf ("[ WARN ] Unknown potion: %lu\n", ulPotionType[iLoop]);
-				break;
-		}
-	}
-
-	/*** loose ***/
-	for (iLoop = 1; iLoop <= (int)ulNrLoose; iLoop++)
-	{
-		switch (ulLooseRight[iLoop])
-		{
-			case 0:
-				ShowImage (imgloose0,
-					MapStartX() + (ulLooseX[iLoop] * iZoom) - (13 * iZoom),
-					MapStartY() + (ulLooseY[iLoop] * iZoom) - (20 * iZoom),
-					"imgloose0", ascreen, iZoom, 0);
-				break;
-			case 1:
-				ShowImage (imgloose1,
-					MapStartX() + (ulLooseX[iLoop] * iZoom) - (15 * iZoom),
-					MapStartY() + (ulLooseY[iLoop] * iZoom) - (20 * iZoom),
-					"imgloose1", ascreen, iZoom, 0);
-				break;
-			default:
-				printf ("[ WARN ] Unknown loose: %lu\n", ulLooseRight[iLoop]);
-				break;
-		}
-	}
-
-	/*** (blue) front ***/
-	for (iLoop = 1; iLoop <= (int)ulNrFront; iLoop++)
-	{
-		switch (ulFrontTypeNr[ulFrontType[iLoop] + 1])
-		{
-			case 0x30: /*** torch ***/
-				ShowImage (imgtorchsprite,
-					MapStartX() + (ulFrontX[iLoop] * iZoom) - (17 * iZoom),
-					MapStartY() + (ulFrontY[iLoop] * iZoom) - (28 * iZoom),
-					"imgtorchsprite", ascreen, iZoom, 0);
-				break;
-			case 0x31: /*** pillar front ***/
-				ShowImage (imgpillarfront,
-					MapStartX() + (ulFrontX[iLoop] * iZoom) - (1 * iZoom),
-					MapStartY() + (ulFrontY[iLoop] * iZoom) - (45 * iZoom),
-					"imgpillarfront", ascreen, iZoom, 0);
-				break;
-			case 0x32: /*** skeleton ***/
-				ShowImage (imgskeleton,
-					MapStartX() + (ulFrontX[iLoop] * iZoom) - (9 * iZoom),
-					MapStartY() + (ulFrontY[iLoop] * iZoom) - (8 * iZoom),
-					"imgskeleton", ascreen, iZoom, 0);
-				break;
-			case 0x33: /*** wall top left slash ***/
-				ShowImage (imgwalltopleftslash,
-					MapStartX() + (ulFrontX[iLoop] * iZoom) - (9 * iZoom),
-					MapStartY() + (ulFrontY[iLoop] * iZoom) - (24 * iZoom),
-					"imgwalltopleftslash", ascreen, iZoom, 0);
-				break;
-			case 0x34: /*** wall top left dot ***/
-				ShowImage (imgwalltopleftdot,
-					MapStartX() + (ulFrontX[iLoop] * iZoom) - (9 * iZoom),
-					MapStartY() + (ulFrontY[iLoop] * iZoom) - (24 * iZoom),
-					"imgwalltopleftdot", ascreen, iZoom, 0);
-				break;
-			case 0x35: /*** wall bottom left ***/
-				ShowImage (imgwallbottomleft,
-					MapStartX() + (ulFrontX[iLoop] * iZoom) - (9 * iZoom),
-					MapStartY() + (ulFrontY[iLoop] * iZoom) - (24 * iZoom),
-					"imgwallbottomleft", ascreen, iZoom, 0);
-				break;
-			case 0x36: /*** floor climbable ***/
-				ShowImage (imgfloorclimbable,
-					MapStartX() + (ulFrontX[iLoop] * iZoom) - (3 * iZoom),
-					MapStartY() + (ulFrontY[iLoop] * iZoom) - (12 * iZoom),
-					"imgfloorclimbable", ascreen, iZoom, 0);
-				break;
-			default:
-				printf ("[ WARN ] Unknown front: %lu (0x%02X)\n",
-					ulFrontTypeNr[ulFrontType[iLoop] + 1],
-					(int)ulFrontTypeNr[ulFrontType[iLoop] + 1]);
-				break;
-		}
-	}
-}
-/*****************************************************************************/
-void ShowScreen (void)
-/*****************************************************************************/
-{
-	int iX, iY;
-	int iXFull, iYFull;
-
-	/*** Used for looping. ***/
-	int iRowLoop, iColumnLoop;
-
-	/*** black ***/
-	ShowImage (imgblack, 0, 0, "imgblack", ascreen, iScale, 1);
-
-	/*** back ***/
-	iY = 0;
-	for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
-	{
-		iX = 0;
-		for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
-		{
-			iXFull = MapStartX() + (iX * iZoom);
-			iYFull = MapStartY() + (iY * iZoom);
+			iXFull = iMapStartX + (iX * iZoom);
+			iYFull = iMapStartY + (iY * iZoom);
 			ShowImage (imgback[ulBack[iRowLoop][iColumnLoop]],
 				iXFull,
 				iYFull,
@@ -2157,16 +2591,85 @@ void ShowScreen (void)
 		iY+=24;
 	}
 
-	if (iHideFront == 0) { ShowFrontTiles(); }
+	if (iHideFront == 0)
+	{
+		IndexStampVisible();
+		ShowFrontTiles();
+		ShowLinks();
+	}
 
 	/*** delete ***/
 	if ((iDelX != -1) && (iDelY != -1))
 	{
-		ShowImage (imgdelete, MapStartX() + ((iDelX - 3) * iZoom),
-			MapStartY() + ((iDelY - 3) * iZoom),
+		ShowImage (imgdelete, iMapStartX + ((iDelX - 3) * iZoom),
+			iMapStartY + ((iDelY - 3) * iZoom),
 			"imgdelete", ascreen, iZoom, 0);
 	}
 
+	/*** find ***/
+	if (iFindCode != -1)
+	{
+		SDL_SetRenderDrawColor (ascreen, 0x00, 0xff, 0xff, SDL_ALPHA_OPAQUE);
+		for (iCell = iFindHead[iFindCode]; iCell != -1; iCell = iFindNext[iCell])
+		{
+			selbox.x = iMapStartX +
+				(((iCell % (MAX_WIDTH + 2)) - 1) * 16 * iZoom);
+			selbox.y = iMapStartY +
+				(((iCell / (MAX_WIDTH + 2)) - 1) * 24 * iZoom);
+			selbox.w = 16 * iZoom;
+			selbox.h = 24 * iZoom;
+			SDL_RenderDrawRect (ascreen, &selbox);
+		}
+	}
+
+	/*** reachability ***/
+	if (iReachShow == 1)
+	{
+		ReachUpdate();
+		/*** Floors that cannot be reached. ***/
+		SDL_SetRenderDrawColor (ascreen, 0xff, 0x00, 0x00, SDL_ALPHA_OPAQUE);
+		for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
+		{
+			for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
+			{
+				if (((ulReachStand[iRowLoop][iColumnLoop / 64] &
+					~ulReached[iRowLoop][iColumnLoop / 64]) >>
+					(iColumnLoop % 64)) & 1)
+				{
+					selbox.x = iMapStartX + ((iColumnLoop - 1) * 16 * iZoom);
+					selbox.y = iMapStartY + ((iRowLoop - 1) * 24 * iZoom);
+					selbox.w = 16 * iZoom;
+					selbox.h = 24 * iZoom;
+					SDL_RenderDrawRect (ascreen, &selbox);
+				}
+			}
+		}
+		/*** The exit trigger and guards, if they cannot be reached. ***/
+		SDL_SetRenderDrawColor (ascreen, 0xff, 0x00, 0xff, SDL_ALPHA_OPAQUE);
+		ReachMark (ulExitTriggerX, ulExitTriggerY);
+		for (iSlot = ent[KIND_GUARDS].iFirst; iSlot != -1;
+			iSlot = ent[KIND_GUARDS].arEnt[iSlot].iNext)
+		{
+			ReachMark (ent[KIND_GUARDS].arEnt[iSlot].ulX,
+				ent[KIND_GUARDS].arEnt[iSlot].ulY);
+		}
+	}
+
+	/*** selection ***/
+	if (iSelection == 1)
+	{
+		SelectionBounds (&iTop, &iLeft, &iBottom, &iRight);
+		selbox.x = iMapStartX + ((iLeft - 1) * 16 * iZoom);
+		selbox.y = iMapStartY + ((iTop - 1) * 24 * iZoom);
+		selbox.w = (iRight - iLeft + 1) * 16 * iZoom;
+		selbox.h = (iBottom - iTop + 1) * 24 * iZoom;
+		SDL_SetRenderDrawColor (ascreen, 0xff, 0xff, 0x00, SDL_ALPHA_OPAQUE);
+		SDL_RenderDrawRect (ascreen, &selbox);
+	}
+
+	/*** minimap ***/
+	if (iMiniShow == 1) { ShowMini(); }
+
 	/*** interface ***/
 	ShowImage (imginterface, 0, 0, "imginterface", ascreen, iScale, 1);
 	if (iHideFront == 1)
@@ -2281,12 +2784,34 @@ void ShowScreen (void)
 	if (InArea (MAP_LEFT, MAP_TOP, MAP_LEFT + MAP_WIDTH,
 		MAP_TOP + MAP_HEIGHT) == 1) /*** map ***/
 	{
-		snprintf (arText[0], MAX_TEXT, "%.1f, %.1f",
-			(float)(iXPos - MapStartX()) / iZoom,
-			(float)(iYPos - MapStartY()) / iZoom);
+		if (NearestObject ((iXPos - iMapStartX) / iZoom,
+			(iYPos - iMapStartY) / iZoom, HOVER_NEAR, &iKind, &iSlot) != -1)
+		{
+			snprintf (arText[0], MAX_TEXT, "%.1f, %.1f (%s)",
+				(float)(iXPos - iMapStartX) / iZoom,
+				(float)(iYPos - iMapStartY) / iZoom, kind[iKind].sName);
+		} else {
+			snprintf (arText[0], MAX_TEXT, "%.1f, %.1f",
+				(float)(iXPos - iMapStartX) / iZoom,
+				(float)(iYPos - iMapStartY) / iZoom);
+		}
 		DisplayText (35, 660, 11, 1, color_wh, 1);
 	}
 
+	/*** find ***/
+	if (iFindCode != -1)
+	{
+		snprintf (arText[0], MAX_TEXT, "0x%02X: %lu here, %lu in all levels",
+			iFindCode, ulFindCount[iFindLevel][iFindCode],
+			FindTotal (iFindCode));
+		DisplayText (400, 660, 11, 1, color_wh, 1);
+	} else if (iReachShow == 1) {
+		snprintf (arText[0], MAX_TEXT, "Exit: %s, guards: %i out of reach",
+			ReachAt (ulExitTriggerX, ulExitTriggerY) == 1 ? "OK" :
+			"out of reach", ReachIsolated());
+		DisplayText (400, 660, 11, 1, color_wh, 1);
+	}
+
 	/*** Emulator information. ***/
 	if (iEmulator == 1)
 		{ ShowImage (imgemulator, 4, 29, "imgemulator", ascreen, iScale, 1); }
@@ -2298,12 +2823,19 @@ void ShowScreen (void)
 void Quit (void)
 /*****************************************************************************/
 {
-	/*** Used for looping. ***/
-	int iLoopFont;
-
+	/*** The threads may still be decoding into asset[]. ***/
+	if (iPrefetching != -1) { AssetPrefetchEnd(); }
 	if (iChanged != 0) { PopUpSave(); }
-	for (iLoopFont = 1; iLoopFont <= MAX_FONT_SIZE; iLoopFont++)
-		{ TTF_CloseFont (font[iLoopFont]); }
+	JournalClear();
+	if (iDebug == 1)
+	{
+		printf ("[ INFO ] Text cache: %lu hits, %lu misses\n",
+			ulCacheHits, ulCacheMisses);
+	}
+	FlushCachedText();
+	CloseFonts();
+	free (sFontData);
+	free (ulClip);
 	TTF_Quit();
 	SDL_Quit();
 	exit (EXIT_NORMAL);
@@ -2312,18 +2844,30 @@ void Quit (void)
 void LoadFonts (void)
 /*****************************************************************************/
 {
-	/*** Used for looping. ***/
-	int iLoopFont;
+	/* Only reads the font file into memory. The sizes are opened from there
+	 * when they are first needed; see Font().
+	 */
 
-	for (iLoopFont = 1; iLoopFont <= MAX_FONT_SIZE; iLoopFont++)
+	SDL_RWops *rwFont;
+	int iOK;
+
+	iOK = 0;
+	rwFont = AssetOpen ("ttf/Bitstream-Vera-Sans-Bold.ttf");
+	if (rwFont != NULL)
 	{
-		font[iLoopFont] = TTF_OpenFont ("ttf/Bitstream-Vera-Sans-Bold.ttf",
-			iLoopFont * iScale);
-		if (font[iLoopFont] == NULL)
+		lFontDataSize = (long)SDL_RWsize (rwFont);
+		if (lFontDataSize > 0)
 		{
-			snprintf (sError, MAX_ERROR, "%s", "Could not load font!");
-			ErrorAndExit();
+			sFontData = (unsigned char *)malloc (lFontDataSize);
+			if ((sFontData != NULL) && (SDL_RWread (rwFont, sFontData, 1,
+				lFontDataSize) == (size_t)lFontDataSize)) { iOK = 1; }
 		}
+		SDL_RWclose (rwFont);
+	}
+	if (iOK == 0)
+	{
+		snprintf (sError, MAX_ERROR, "%s", "Could not load font!");
+		ErrorAndExit();
 	}
 }
 /*****************************************************************************/
@@ -2368,7 +2912,7 @@ void PlaySound (char *sFile)
 	}
 	if (iIndex == NUM_SOUNDS) { return; }
 
-	if (SDL_LoadWAV (sFile, &wave, &data, &dlen) == NULL)
+	if (SDL_LoadWAV_RW (AssetOpen (sFile), 1, &wave, &data, &dlen) == NULL)
 	{
 		printf ("[FAILED] Could not load %s: %s!\n", sFile, SDL_GetError());
 		exit (EXIT_ERROR);
@@ -2396,20 +2940,169 @@ void PlaySound (char *sFile)
 void PreLoad (char *sPath, char *sPNG, SDL_Texture **imgImage)
 /*****************************************************************************/
 {
-	char sImage[MAX_IMG + 2];
-	int iBarHeight;
+	/*** Only queues the image; PreLoadRun() loads it. ***/
 
-	snprintf (sImage, MAX_IMG, "png%s%s%s%s", SLASH, sPath, SLASH, sPNG);
-	*imgImage = IMG_LoadTexture (ascreen, sImage);
-	if (!*imgImage)
+	if (iPreLoads == MAX_PRELOAD)
 	{
-		printf ("[FAILED] IMG_LoadTexture: %s!\n", IMG_GetError());
+		printf ("[FAILED] Too many images to preload!\n");
 		exit (EXIT_ERROR);
 	}
+	snprintf (preload[iPreLoads].sImage, MAX_IMG, "png%s%s%s%s",
+		SLASH, sPath, SLASH, sPNG);
+	preload[iPreLoads].imgImage = imgImage;
+	preload[iPreLoads].surface = NULL;
+	preload[iPreLoads].sPixels = NULL;
+	SDL_AtomicSet (&preload[iPreLoads].iDone, 0);
+	iPreLoads++;
+}
+/*****************************************************************************/
+void PreLoadRun (int iShowBar)
+/*****************************************************************************/
+{
+	/* Loads the queued images, with a thread for each other core. With
+	 * iShowBar 1, this moves the loading bar.
+	 */
+
+	PreLoadStart (SDL_GetCPUCount() - 1);
+	while (PreLoadMake (1, iShowBar) != 1) { }
+}
+/*****************************************************************************/
+void PreLoadStart (int iThreads)
+/*****************************************************************************/
+{
+	/*** Starts iThreads threads that decode the queued images. ***/
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	iNrToPreLoad = iPreLoaded + iPreLoads;
+	if (semPreLoaded == NULL)
+	{
+		semPreLoaded = SDL_CreateSemaphore (0);
+		if (semPreLoaded == NULL)
+		{
+			printf ("[FAILED] SDL_CreateSemaphore: %s!\n", SDL_GetError());
+			exit (EXIT_ERROR);
+		}
+	}
+	SDL_AtomicSet (&iPreLoadNext, 0);
+	iPreLoadMade = 0;
+	iPreLoadFirst = 0;
+	if (iThreads > MAX_PRELOAD_THREADS) { iThreads = MAX_PRELOAD_THREADS; }
+	if (iThreads > iPreLoads) { iThreads = iPreLoads; }
+	if (iThreads < 0) { iThreads = 0; }
+	iPreLoadThreads = 0;
+	for (iLoop = 0; iLoop < iThreads; iLoop++)
+	{
+		threadpreload[iPreLoadThreads] = SDL_CreateThread (PreLoadThread,
+			"PreLoad", NULL);
+		if (threadpreload[iPreLoadThreads] != NULL) { iPreLoadThreads++; }
+	}
+}
+/*****************************************************************************/
+int PreLoadMake (int iWait, int iShowBar)
+/*****************************************************************************/
+{
+	/* Makes the texture of one decoded image. Only this thread may use the
+	 * renderer. If none is ready, this decodes one itself, or waits for
+	 * the threads; with iWait 0 and threads running, it returns -1 instead.
+	 * Returns 1 when all images are done, and 0 if more remain.
+	 */
+
+	int iImage;
+	int iBarHeight;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	if (iPreLoadMade < iPreLoads)
+	{
+		while (SDL_SemTryWait (semPreLoaded) != 0)
+		{
+			if ((iWait == 0) && (iPreLoadThreads != 0)) { return (-1); }
+			/*** Nothing is ready; decode one here, or wait. ***/
+			if (PreLoadOne() == 0) { SDL_SemWait (semPreLoaded); break; }
+		}
+		while (SDL_AtomicGet (&preload[iPreLoadFirst].iDone) == 2)
+			{ iPreLoadFirst++; }
+		iImage = iPreLoadFirst;
+		while (SDL_AtomicGet (&preload[iImage].iDone) != 1) { iImage++; }
+
+		if (preload[iImage].surface == NULL)
+		{
+			printf ("[FAILED] IMG_Load: %s!\n", preload[iImage].sError);
+			exit (EXIT_ERROR);
+		}
+		*preload[iImage].imgImage = SDL_CreateTextureFromSurface (ascreen,
+			preload[iImage].surface);
+		if (!*preload[iImage].imgImage)
+		{
+			printf ("[FAILED] SDL_CreateTextureFromSurface: %s!\n",
+				SDL_GetError());
+			exit (EXIT_ERROR);
+		}
+		SDL_FreeSurface (preload[iImage].surface);
+		preload[iImage].surface = NULL;
+		free (preload[iImage].sPixels);
+		preload[iImage].sPixels = NULL;
+		SDL_AtomicSet (&preload[iImage].iDone, 2);
+		iPreLoadMade++;
+
+		iPreLoaded++;
+		if (iShowBar == 1)
+		{
+			iBarHeight = (int)(((float)iPreLoaded/(float)iNrToPreLoad) * BAR_FULL);
+			if (iBarHeight >= iCurrentBarHeight + 10) { LoadingBar (iBarHeight); }
+		}
+		if (iPreLoadMade < iPreLoads) { return (0); }
+	}
+
+	for (iLoop = 0; iLoop < iPreLoadThreads; iLoop++)
+		{ SDL_WaitThread (threadpreload[iLoop], NULL); }
+	iPreLoadThreads = 0;
+	iPreLoads = 0;
+
+	return (1);
+}
+/*****************************************************************************/
+int PreLoadThread (void *unused)
+/*****************************************************************************/
+{
+	if (unused != NULL) { } /*** To prevent warnings. ***/
+
+	while (PreLoadOne() == 1) { }
+
+	return (0);
+}
+/*****************************************************************************/
+int PreLoadOne (void)
+/*****************************************************************************/
+{
+	/* Decodes the next queued image; returns 0 if none are left. This runs
+	 * next to other threads, so it only touches its own preload[] entry.
+	 */
+
+	int iImage;
+
+	iImage = SDL_AtomicAdd (&iPreLoadNext, 1);
+	if (iImage >= iPreLoads) { return (0); }
+	preload[iImage].surface = CacheLoad (preload[iImage].sImage,
+		&preload[iImage].sPixels);
+	if (preload[iImage].surface == NULL)
+	{
+		preload[iImage].surface = IMG_Load_RW
+			(AssetOpen (preload[iImage].sImage), 1);
+		if (preload[iImage].surface == NULL)
+		{
+			snprintf (preload[iImage].sError, MAX_ERROR, "%s", IMG_GetError());
+		} else {
+			CacheSave (preload[iImage].sImage, preload[iImage].surface);
+		}
+	}
+	SDL_AtomicSet (&preload[iImage].iDone, 1);
+	SDL_SemPost (semPreLoaded);
 
-	iPreLoaded++;
-	iBarHeight = (int)(((float)iPreLoaded/(float)iNrToPreLoad) * BAR_FULL);
-	if (iBarHeight >= iCurrentBarHeight + 10) { LoadingBar (iBarHeight); }
+	return (1);
 }
 /*****************************************************************************/
 void ShowImage (SDL_Texture *img, int iX, int iY, char *sImageInfo,
@@ -2441,26 +3134,16 @@ void ShowImage (SDL_Texture *img, int iX, int iY, char *sImageInfo,
 	dest.w = iWidth * fMultiply;
 	dest.h = iHeight * fMultiply;
 
-	/*** This is for the game animation. ***/
-	if (iNoAnim == 0)
-	{
-		newticks = SDL_GetTicks();
-		if (newticks > oldticksf + FPS_TORCH)
-		{
-			iFlameFrame++;
-			if (iFlameFrame >= 6) { iFlameFrame = 1; }
-			oldticksf = newticks;
-		}
-	}
+	/*** The frames are advanced by AnimTick(). ***/
 	if (strcmp (sImageInfo, "imgtorchsprite") == 0)
 	{
-		loc.x = (iFlameFrame - 1) * 34;
+		loc.x = (anim[ANIM_TORCH].iFrame - 1) * 34;
 		loc.w = loc.w / 5;
 		dest.w = dest.w / 5;
 	}
 	if (strcmp (sImageInfo, "imgstatusbarsprite") == 0)
 	{
-		loc.x = (iStatusBarFrame - 1) * 20;
+		loc.x = (anim[ANIM_STATUSBAR].iFrame - 1) * 20;
 		loc.w = loc.w / 18;
 		dest.w = dest.w / 18;
 	}
@@ -2491,36 +3174,25 @@ void LoadingBar (int iBarHeight)
 void PrevLevel (void)
 /*****************************************************************************/
 {
-	int iToLoad;
-
-	iToLoad = iCurLevel - 1;
-
-	if (iChanged != 0) { PopUpSave(); }
-
-	if (iToLoad >= 0)
-	{
-		iCurLevel = iToLoad;
-		LevelLoad (iToLoad);
-		iChanged = 0;
-		iDelX = -1;
-		iDelY = -1;
-		PlaySound ("wav/level_change.wav");
-	}
+	OpenLevel (iCurLevel - 1);
 }
 /*****************************************************************************/
 void NextLevel (void)
 /*****************************************************************************/
 {
-	int iToLoad;
-
-	iToLoad = iCurLevel + 1;
-
+	OpenLevel (iCurLevel + 1);
+}
+/*****************************************************************************/
+void OpenLevel (int iToLoad)
+/*****************************************************************************/
+{
 	if (iChanged != 0) { PopUpSave(); }
 
-	if (iToLoad <= MAX_LEVEL)
+	if ((iToLoad >= 0) && (iToLoad <= MAX_LEVEL))
 	{
 		iCurLevel = iToLoad;
 		LevelLoad (iToLoad);
+		JournalClear();
 		iChanged = 0;
 		iDelX = -1;
 		iDelY = -1;
@@ -2593,14 +3265,11 @@ void DisplayText (int iStartX, int iStartY, int iFontSize,
 	{
 		if (strcmp (arText[iTemp], "") != 0)
 		{
-			message = TTF_RenderText_Shaded (font[iFontSize],
-				arText[iTemp], color_bl, back);
-			messaget = SDL_CreateTextureFromSurface (ascreen, message);
+			messaget = CachedText (arText[iTemp], iFontSize, 0,
+				color_bl, back, &offset.w, &offset.h);
 			offset.x = iStartX;
 			offset.y = iStartY + (iTemp * (iFontSize + 4));
-			offset.w = message->w; offset.h = message->h;
 			CustomRenderCopy (messaget, NULL, &offset, "message", iXYScale);
-			SDL_DestroyTexture (messaget); SDL_FreeSurface (message);
 		}
 	}
 }
@@ -2642,6 +3311,7 @@ void Help (void)
 
 	iHelp = 1;
 
+	AssetUse (ASSET_HELP);
 	PlaySound ("wav/popup.wav");
 	ShowHelp();
 	while (iHelp == 1)
@@ -2717,6 +3387,7 @@ void Help (void)
 		looptime = SDL_GetTicks();
 	}
 	PlaySound ("wav/popup_close.wav");
+	AssetDrop (ASSET_HELP);
 	SDL_SetCursor (curArrow);
 	ShowScreen();
 }
@@ -2761,7 +3432,7 @@ void ChangeBackAction (char *sAction)
 {
 	if (strcmp (sAction, "select") == 0)
 	{
-		ulBack[iHoverRow][iHoverColumn] = TileNrToHex (iOnTile);
+		SetBack (iHoverRow, iHoverColumn, TileNrToHex (iOnTile));
 		iLastBack = TileNrToHex (iOnTile);
 		iChanged++;
 		iChangeBack = 0;
@@ -2877,6 +3548,7 @@ void ChangeBack (void)
 					ShowChangeBack();
 					break;
 				case SDL_MOUSEMOTION:
+					LatestMotion (&event);
 					iOldXPos = iXPos;
 					iOldYPos = iYPos;
 					iXPos = event.motion.x;
@@ -3057,6 +3729,31 @@ int TileHexToNr (int iHex)
 	return (iReturn);
 }
 /*****************************************************************************/
+int TileClass (int iHex)
+/*****************************************************************************/
+{
+	/* What a back tile is to the prince; TILE_*. Floors are in every other
+	 * row; the ledges are their left and right ends. Unknown codes, and
+	 * the decorations, are empty.
+	 */
+
+	switch (iHex)
+	{
+		case 0x0F: case 0x11: case 0x13: case 0x14: case 0x15: case 0x16:
+		case 0x1A: case 0x23: case 0x25: case 0x28: case 0x29: case 0x2A:
+		case 0x2C: case 0x2D: case 0x2E: case 0x2F: case 0x30: case 0x31:
+		case 0x35: case 0x36:
+			return (TILE_FLOOR);
+		case 0x0B: case 0x0E: case 0x10: case 0x12: case 0x17: case 0x27:
+		case 0x2B: case 0x34:
+			return (TILE_CLIMB);
+		case 0x06: case 0x20:
+			return (TILE_WALL);
+		default:
+			return (TILE_EMPTY);
+	}
+}
+/*****************************************************************************/
 int TileNrToHex (int iNr)
 /*****************************************************************************/
 {
@@ -3135,167 +3832,216 @@ int TileNrToHex (int iNr)
 void ChangeFrontAction (char *sAction)
 /*****************************************************************************/
 {
+	int iSlot;
+	struct entity *stEnt;
+
 	if (strcmp (sAction, "select") == 0)
 	{
+		UndoBegin();
 		switch (iOnTile)
 		{
 			case 1: /*** torch ***/
-				AddFront (iCFX, iCFY, 0x30);
-				iChanged++;
+				if (AddFront (iCFX, iCFY, 0x30) == 1)
+					{ iChanged++; }
 				iChangeFront = 0;
 				break;
 			case 2: /*** pillar front ***/
-				AddFront (AlignX (iCFX, 4), AlignY (iCFY, 21), 0x31);
-				iChanged++;
+				if (AddFront (AlignX (iCFX, 4), AlignY (iCFY, 21), 0x31) == 1)
+					{ iChanged++; }
 				iChangeFront = 0;
 				break;
 			case 3: /*** skeleton ***/
-				AddFront (iCFX, AlignY (iCFY, 13), 0x32);
-				iChanged++;
+				if (AddFront (iCFX, AlignY (iCFY, 13), 0x32) == 1)
+					{ iChanged++; }
 				iChangeFront = 0;
 				break;
 			case 4: /*** wall top left slash ***/
-				AddFront (AlignX (iCFX, 9), AlignY (iCFY, 0), 0x33);
-				iChanged++;
+				if (AddFront (AlignX (iCFX, 9), AlignY (iCFY, 0), 0x33) == 1)
+					{ iChanged++; }
 				iChangeFront = 0;
 				break;
 			case 5: /*** wall top left dot ***/
-				AddFront (AlignX (iCFX, 9), AlignY (iCFY, 0), 0x34);
-				iChanged++;
+				if (AddFront (AlignX (iCFX, 9), AlignY (iCFY, 0), 0x34) == 1)
+					{ iChanged++; }
 				iChangeFront = 0;
 				break;
 			case 6: /*** wall bottom left ***/
-				AddFront (AlignX (iCFX, 11), AlignY (iCFY, 22), 0x35);
-				iChanged++;
+				if (AddFront (AlignX (iCFX, 11), AlignY (iCFY, 22), 0x35) == 1)
+					{ iChanged++; }
 				iChangeFront = 0;
 				break;
 			case 7: /*** floor climbable ***/
-				AddFront (AlignX (iCFX, 3), AlignY (iCFY, 3), 0x36);
-				iChanged++;
+				if (AddFront (AlignX (iCFX, 3), AlignY (iCFY, 3), 0x36) == 1)
+					{ iChanged++; }
 				iChangeFront = 0;
 				break;
 			case 8: /*** prince ***/
-				ulPrinceX = iCFX;
-				ulPrinceY = AlignY (iCFY, 19);
+				SetValue (VALUE_PRINCE_X, iCFX);
+				SetValue (VALUE_PRINCE_Y, AlignY (iCFY, 19));
 				iChanged++;
 				iChangeFront = 0;
 				break;
 			case 9: /*** exit trigger ***/
-				ulExitTriggerX = iCFX;
-				ulExitTriggerY = AlignY (iCFY, 18);
+				SetValue (VALUE_EXIT_TRIGGER_X, iCFX);
+				SetValue (VALUE_EXIT_TRIGGER_Y, AlignY (iCFY, 18));
 				iChanged++;
 				iChangeFront = 0;
 				break;
 			case 10: /*** save trigger ***/
-				ulSaveTriggerX = AlignX (iCFX, 7);
-				ulSaveTriggerY = AlignY (iCFY, 19);
+				SetValue (VALUE_SAVE_TRIGGER_X, AlignX (iCFX, 7));
+				SetValue (VALUE_SAVE_TRIGGER_Y, AlignY (iCFY, 19));
 				iChanged++;
 				iChangeFront = 0;
 				break;
 			case 11: /*** entrance image ***/
-				ulEntranceImageX = iCFX;
-				ulEntranceImageY = AlignY (iCFY, 9);
+				SetValue (VALUE_ENTRANCE_IMAGE_X, iCFX);
+				SetValue (VALUE_ENTRANCE_IMAGE_Y, AlignY (iCFY, 9));
 				iChanged++;
 				iChangeFront = 0;
 				break;
 			case 12: /*** exit image ***/
-				ulExitImageX = iCFX;
-				ulExitImageY = AlignY (iCFY, 9);
+				SetValue (VALUE_EXIT_IMAGE_X, iCFX);
+				SetValue (VALUE_EXIT_IMAGE_Y, AlignY (iCFY, 9));
 				iChanged++;
 				iChangeFront = 0;
 				break;
 			case 13: /*** chomper ***/
-				ulNrChompers++;
-				ulChomperX[ulNrChompers] = iCFX;
-				ulChomperY[ulNrChompers] = AlignY (iCFY, 22);
-				ulChomperA[ulNrChompers] = iFront1301;
-				iChanged++;
+				iSlot = EntAdd (KIND_CHOMPERS);
+				if (iSlot != -1)
+				{
+					stEnt = &ent[KIND_CHOMPERS].arEnt[iSlot];
+					stEnt->ulX = iCFX;
+					stEnt->ulY = AlignY (iCFY, 22);
+					stEnt->ulField[FIELD_CHOMPER_A] = iFront1301;
+					IndexAdd (KIND_CHOMPERS, iSlot);
+					UndoEntity (KIND_CHOMPERS, iSlot, 1);
+					iChanged++;
+				}
 				iChangeFront = 0;
 				break;
 			case 14: /*** spikes ***/
-				ulNrSpikes++;
-				ulSpikeX[ulNrSpikes] = AlignX (iCFX, 9);
-				ulSpikeY[ulNrSpikes] = AlignY (iCFY, 0);
-				ulSpikeRight[ulNrSpikes] = iFront1401;
-				iChanged++;
+				iSlot = EntAdd (KIND_SPIKES);
+				if (iSlot != -1)
+				{
+					stEnt = &ent[KIND_SPIKES].arEnt[iSlot];
+					stEnt->ulX = AlignX (iCFX, 9);
+					stEnt->ulY = AlignY (iCFY, 0);
+					stEnt->ulField[FIELD_SPIKE_RIGHT] = iFront1401;
+					IndexAdd (KIND_SPIKES, iSlot);
+					UndoEntity (KIND_SPIKES, iSlot, 1);
+					iChanged++;
+				}
 				iChangeFront = 0;
 				break;
 			case 15: /*** gate ***/
-				ulNrGates++;
-				/* The AlignX() here is for the gate to line up with the
-				 * corresponding back tile.
-				 */
-				ulGateX[ulNrGates] = AlignX (iCFX, 6);
-				ulGateY[ulNrGates] = AlignY (iCFY, 22);
-				ulGateTimeOpen[ulNrGates] = (iFront1501 * 12);
-				iChanged++;
+				iSlot = EntAdd (KIND_GATES);
+				if (iSlot != -1)
+				{
+					stEnt = &ent[KIND_GATES].arEnt[iSlot];
+					/* The AlignX() here is for the gate to line up with the
+					 * corresponding back tile.
+					 */
+					stEnt->ulX = AlignX (iCFX, 6);
+					stEnt->ulY = AlignY (iCFY, 22);
+					stEnt->ulField[FIELD_GATE_TIMEOPEN] = (iFront1501 * 12);
+					IndexAdd (KIND_GATES, iSlot);
+					LinkAdd (KIND_GATES, iSlot);
+					UndoEntity (KIND_GATES, iSlot, 1);
+					iChanged++;
+				}
 				iChangeFront = 0;
 				break;
 			case 16: /*** raise ***/
-				ulNrRaise++;
-				ulRaiseGate[ulNrRaise] = iFront1601;
-				ulRaiseX[ulNrRaise] = AlignX (iCFX, 15);
-				ulRaiseY[ulNrRaise] = AlignY (iCFY, 0);
-				iChanged++;
+				iSlot = EntAdd (KIND_RAISE);
+				if (iSlot != -1)
+				{
+					stEnt = &ent[KIND_RAISE].arEnt[iSlot];
+					stEnt->ulField[FIELD_RAISE_GATE] = iFront1601;
+					stEnt->ulX = AlignX (iCFX, 15);
+					stEnt->ulY = AlignY (iCFY, 0);
+					IndexAdd (KIND_RAISE, iSlot);
+					LinkAdd (KIND_RAISE, iSlot);
+					UndoEntity (KIND_RAISE, iSlot, 1);
+					iChanged++;
+				}
 				iChangeFront = 0;
 				break;
 			case 17: /*** guard ***/
-				ulNrGuards++;
-				ulGuardX[ulNrGuards] = iCFX;
-				ulGuardY[ulNrGuards] = AlignY (iCFY, 18);
-				ulGuardDir[ulNrGuards] = iFront1701;
-				ulGuardHP[ulNrGuards] = iFront1702;
-				ulGuardA[ulNrGuards] = iFront1703;
-				ulGuardB[ulNrGuards] = iFront1704;
-				ulGuardC[ulNrGuards] = iFront1705;
-				ulGuardD[ulNrGuards] = iFront1706;
-				ulGuardE[ulNrGuards] = iFront1707;
-				ulGuardF[ulNrGuards] = iFront1708;
-				iChanged++;
+				iSlot = EntAdd (KIND_GUARDS);
+				if (iSlot != -1)
+				{
+					stEnt = &ent[KIND_GUARDS].arEnt[iSlot];
+					stEnt->ulX = iCFX;
+					stEnt->ulY = AlignY (iCFY, 18);
+					stEnt->ulField[FIELD_GUARD_DIR] = iFront1701;
+					stEnt->ulField[FIELD_GUARD_HP] = iFront1702;
+					stEnt->ulField[FIELD_GUARD_A] = iFront1703;
+					stEnt->ulField[FIELD_GUARD_B] = iFront1704;
+					stEnt->ulField[FIELD_GUARD_C] = iFront1705;
+					stEnt->ulField[FIELD_GUARD_D] = iFront1706;
+					stEnt->ulField[FIELD_GUARD_E] = iFront1707;
+					stEnt->ulField[FIELD_GUARD_F] = iFront1708;
+					IndexAdd (KIND_GUARDS, iSlot);
+					UndoEntity (KIND_GUARDS, iSlot, 1);
+					iChanged++;
+				}
 				iChangeFront = 0;
 				break;
 			case 18: /*** potion ***/
-				ulNrPotions++;
-				ulPotionType[ulNrPotions] = iFront1801;
-				switch (iFront1801)
+				iSlot = EntAdd (KIND_POTIONS);
+				if (iSlot != -1)
 				{
-					case 0:
-						ulPotionX[ulNrPotions] = AlignX (iCFX, 13);
-						ulPotionY[ulNrPotions] = AlignY (iCFY, 18);
-						break;
-					case 1:
-						ulPotionX[ulNrPotions] = AlignX (iCFX, 12);
-						ulPotionY[ulNrPotions] = AlignY (iCFY, 18);
-						break;
-					case 2:
-						ulPotionX[ulNrPotions] = AlignX (iCFX, 12);
-						ulPotionY[ulNrPotions] = AlignY (iCFY, 18);
-						break;
-					case 3:
-						ulPotionX[ulNrPotions] = AlignX (iCFX, 8);
-						ulPotionY[ulNrPotions] = AlignY (iCFY, 22);
-						break;
+					stEnt = &ent[KIND_POTIONS].arEnt[iSlot];
+					stEnt->ulField[FIELD_POTION_TYPE] = iFront1801;
+					switch (iFront1801)
+					{
+						case 0:
+							stEnt->ulX = AlignX (iCFX, 13);
+							stEnt->ulY = AlignY (iCFY, 18);
+							break;
+						case 1:
+							stEnt->ulX = AlignX (iCFX, 12);
+							stEnt->ulY = AlignY (iCFY, 18);
+							break;
+						case 2:
+							stEnt->ulX = AlignX (iCFX, 12);
+							stEnt->ulY = AlignY (iCFY, 18);
+							break;
+						case 3:
+							stEnt->ulX = AlignX (iCFX, 8);
+							stEnt->ulY = AlignY (iCFY, 22);
+							break;
+					}
+					IndexAdd (KIND_POTIONS, iSlot);
+					UndoEntity (KIND_POTIONS, iSlot, 1);
+					iChanged++;
 				}
-				iChanged++;
 				iChangeFront = 0;
 				break;
 			case 19: /*** loose ***/
-				ulNrLoose++;
-				switch (iFront1901)
+				iSlot = EntAdd (KIND_LOOSE);
+				if (iSlot != -1)
 				{
-					case 0:
-						ulLooseX[ulNrLoose] = AlignX (iCFX, 12);
-						break;
-					case 1:
-						ulLooseX[ulNrLoose] = AlignX (iCFX, 14);
-						break;
+					stEnt = &ent[KIND_LOOSE].arEnt[iSlot];
+					switch (iFront1901)
+					{
+						case 0:
+							stEnt->ulX = AlignX (iCFX, 12);
+							break;
+						case 1:
+							stEnt->ulX = AlignX (iCFX, 14);
+							break;
+					}
+					stEnt->ulY = AlignY (iCFY, 1);
+					stEnt->ulField[FIELD_LOOSE_RIGHT] = iFront1901;
+					IndexAdd (KIND_LOOSE, iSlot);
+					UndoEntity (KIND_LOOSE, iSlot, 1);
+					iChanged++;
 				}
-				ulLooseY[ulNrLoose] = AlignY (iCFY, 1);
-				ulLooseRight[ulNrLoose] = iFront1901;
-				iChanged++;
 				iChangeFront = 0;
 				break;
 		}
+		UndoEnd();
 	}
 
 	if (strcmp (sAction, "left") == 0)
@@ -3499,6 +4245,7 @@ void ChangeFront (void)
 					ShowChangeFront();
 					break;
 				case SDL_MOUSEMOTION:
+					LatestMotion (&event);
 					iOldXPos = iXPos;
 					iOldYPos = iYPos;
 					iXPos = event.motion.x;
@@ -3817,12 +4564,8 @@ void CenterNumber (int iNumber, int iX, int iY,
 	} else {
 		snprintf (arText[0], MAX_TEXT, "%02x", iNumber);
 	}
-	/* The 100000 is a workaround for 0 being broken. SDL devs have fixed that
-	 * see e.g. https://hg.libsdl.org/SDL_ttf/rev/72b8861dbc01 but
-	 * Ubuntu et al. still ship older sdl2-ttf versions.
-	 */
-	message = TTF_RenderText_Blended_Wrapped (font[20], arText[0], fore, 100000);
-	messaget = SDL_CreateTextureFromSurface (ascreen, message);
+	messaget = CachedText (arText[0], 20, 1, fore, color_bl,
+		&offset.w, &offset.h);
 	if (iHex == 0)
 	{
 		if ((iNumber >= -9) && (iNumber <= -1))
@@ -3839,9 +4582,7 @@ void CenterNumber (int iNumber, int iX, int iY,
 		offset.x = iX + 14;
 	}
 	offset.y = iY - 1;
-	offset.w = message->w; offset.h = message->h;
 	CustomRenderCopy (messaget, NULL, &offset, "message", 1);
-	SDL_DestroyTexture (messaget); SDL_FreeSurface (message);
 }
 /*****************************************************************************/
 int PlusMinus (int *iWhat, int iX, int iY,
@@ -3865,167 +4606,140 @@ void LevelSave (void)
 /*****************************************************************************/
 {
 	char sLocation[MAX_PATHFILE + 2];
-	int iFd;
-
-	/*** Used for looping. ***/
-	int iRowLoop, iColumnLoop;
-	int iLoop;
-	int iLoopChar;
+	int iProblems;
+	char sLine1[MAX_STATUS + 2];
+	char sLine2[MAX_STATUS + 2];
 
 	if (iChanged == 0) { return; }
 
+	/*** The problems are shown on the console. ***/
+	iProblems = LevelCheck (iCurLevel);
+	if (iProblems != 0)
+	{
+		snprintf (sLine1, MAX_STATUS, "This level has %i problem(s).", iProblems);
+		snprintf (sLine2, MAX_STATUS, "%s", "Save it anyway?");
+		if (PopUpYN (sLine1, sLine2) == 0) { return; }
+	}
+
 	CreateBAK();
 
 	snprintf (sLocation, MAX_PATHFILE, "%s%s%i.lvl",
 		DIR_UNCOMP, SLASH, iCurLevel);
-	iFd = open (sLocation, O_WRONLY|O_TRUNC|O_CREAT|O_BINARY, 0600);
-	if (iFd == -1)
-	{
-		printf ("[FAILED] Could not open \"%s\": %s!\n",
-			sPathFile, strerror (errno));
-		exit (EXIT_ERROR);
-	}
+	LevelWrite (sLocation);
 
-	/*** width and height ***/
-	WriteByte (iFd, ulWidth);
-	WriteByte (iFd, ulHeight);
+	Compress();
+
+	PlaySound ("wav/save.wav");
+
+	iChanged = 0;
+	JournalClear();
+}
+/*****************************************************************************/
+void LevelWrite (char *sLocation)
+/*****************************************************************************/
+{
+	/*** Writes the loaded level to sLocation, as a .lvl file. ***/
+
+	int iFd;
+	long lLength;
+
+	lLength = LevelBytes (sLvl);
+	iFd = open (sLocation, O_WRONLY|O_TRUNC|O_CREAT|O_BINARY, 0600);
+	if (iFd == -1)
+	{
+		printf ("[FAILED] Could not open \"%s\": %s!\n",
+			sLocation, strerror (errno));
+		exit (EXIT_ERROR);
+	}
+	if (write (iFd, sLvl, lLength) != lLength)
+	{
+		snprintf (sWarning, MAX_WARNING, "Could not write: %s!",
+			strerror (errno));
+		Warning();
+	}
+	close (iFd);
+}
+/*****************************************************************************/
+long LevelBytes (unsigned char *sBytes)
+/*****************************************************************************/
+{
+	/*** The loaded level as a .lvl file; returns its length. ***/
+
+	long lLength;
+
+	/*** Used for looping. ***/
+	int iRowLoop, iColumnLoop;
+	int iLoop;
+	int iLoopChar;
+
+	lLength = 0;
+
+	/*** width and height ***/
+	PutByte (sBytes, &lLength, ulWidth);
+	PutByte (sBytes, &lLength, ulHeight);
 
 	/*** back ***/
 	for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
 	{
 		for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
 		{
-			WriteByte (iFd, ulBack[iRowLoop][iColumnLoop]);
+			PutByte (sBytes, &lLength, ulBack[iRowLoop][iColumnLoop]);
 		}
 	}
 
 	/*** unknown ***/
-	WriteWord (iFd, ulNrUnknown);
+	PutWord (sBytes, &lLength, ulNrUnknown);
 	for (iLoop = 1; iLoop <= (int)ulNrUnknown; iLoop++)
 	{
-		WriteByte (iFd, ulUnknownA[iLoop]);
-		WriteByte (iFd, ulUnknownB[iLoop]);
-		WriteByte (iFd, ulUnknownC[iLoop]);
-		WriteByte (iFd, ulUnknownD[iLoop]);
+		PutByte (sBytes, &lLength, ulUnknownA[iLoop]);
+		PutByte (sBytes, &lLength, ulUnknownB[iLoop]);
+		PutByte (sBytes, &lLength, ulUnknownC[iLoop]);
+		PutByte (sBytes, &lLength, ulUnknownD[iLoop]);
 	}
 
 	/*** 0x00 0x00 ***/
-	WriteByte (iFd, 0);
-	WriteByte (iFd, 0);
+	PutByte (sBytes, &lLength, 0);
+	PutByte (sBytes, &lLength, 0);
 
 	/*** front types ***/
-	WriteWord (iFd, ulFrontTypes);
+	PutWord (sBytes, &lLength, ulFrontTypes);
 	for (iLoop = 1; iLoop <= (int)ulFrontTypes; iLoop++)
 	{
-		WriteByte (iFd, ulFrontTypeA[iLoop]);
-		WriteByte (iFd, ulFrontTypeB[iLoop]);
-		WriteByte (iFd, ulFrontTypeNr[iLoop]);
+		PutByte (sBytes, &lLength, ulFrontTypeA[iLoop]);
+		PutByte (sBytes, &lLength, ulFrontTypeB[iLoop]);
+		PutByte (sBytes, &lLength, ulFrontTypeNr[iLoop]);
 	}
 
 	/*** front ***/
-	WriteWord (iFd, ulNrFront);
-	for (iLoop = 1; iLoop <= (int)ulNrFront; iLoop++)
-	{
-		WriteWord (iFd, ulFrontX[iLoop]);
-		WriteWord (iFd, ulFrontY[iLoop]);
-		WriteByte (iFd, ulFrontType[iLoop]);
-		WriteByte (iFd, ulFrontA[iLoop]);
-		WriteByte (iFd, ulFrontB[iLoop]);
-	}
+	SaveKind (sBytes, &lLength, KIND_FRONT);
 
 	/*** prince ***/
-	WriteWord (iFd, ulPrinceX);
-	WriteWord (iFd, ulPrinceY);
+	PutWord (sBytes, &lLength, ulPrinceX);
+	PutWord (sBytes, &lLength, ulPrinceY);
 
 	/*** exit trigger ***/
-	WriteWord (iFd, ulExitTriggerX);
-	WriteWord (iFd, ulExitTriggerY);
+	PutWord (sBytes, &lLength, ulExitTriggerX);
+	PutWord (sBytes, &lLength, ulExitTriggerY);
 
 	/*** save ***/
-	WriteWord (iFd, ulSaveTriggerX);
-	WriteWord (iFd, ulSaveTriggerY);
+	PutWord (sBytes, &lLength, ulSaveTriggerX);
+	PutWord (sBytes, &lLength, ulSaveTriggerY);
 
 	/*** entrance image ***/
-	WriteWord (iFd, ulEntranceImageX);
-	WriteWord (iFd, ulEntranceImageY);
+	PutWord (sBytes, &lLength, ulEntranceImageX);
+	PutWord (sBytes, &lLength, ulEntranceImageY);
 
 	/*** exit image ***/
-	WriteWord (iFd, ulExitImageX);
-	WriteWord (iFd, ulExitImageY);
-
-	/*** chompers ***/
-	WriteWord (iFd, ulNrChompers);
-	for (iLoop = 1; iLoop <= (int)ulNrChompers; iLoop++)
-	{
-		WriteWord (iFd, ulChomperX[iLoop]);
-		WriteWord (iFd, ulChomperY[iLoop]);
-		WriteByte (iFd, ulChomperA[iLoop]);
-	}
-
-	/*** spikes ***/
-	WriteWord (iFd, ulNrSpikes);
-	for (iLoop = 1; iLoop <= (int)ulNrSpikes; iLoop++)
-	{
-		WriteWord (iFd, ulSpikeX[iLoop]);
-		WriteWord (iFd, ulSpikeY[iLoop]);
-		WriteByte (iFd, ulSpikeRight[iLoop]);
-	}
-
-	/*** gates ***/
-	WriteWord (iFd, ulNrGates);
-	for (iLoop = 1; iLoop <= (int)ulNrGates; iLoop++)
-	{
-		WriteWord (iFd, ulGateX[iLoop]);
-		WriteWord (iFd, ulGateY[iLoop]);
-		WriteWord (iFd, ulGateTimeOpen[iLoop]);
-	}
-
-	/*** raise ***/
-	WriteWord (iFd, ulNrRaise);
-	for (iLoop = 1; iLoop <= (int)ulNrRaise; iLoop++)
-	{
-		WriteWord (iFd, ulRaiseGate[iLoop]);
-		WriteWord (iFd, ulRaiseX[iLoop]);
-		WriteWord (iFd, ulRaiseY[iLoop]);
-	}
-
-	/*** guards ***/
-	WriteWord (iFd, ulNrGuards);
-	for (iLoop = 1; iLoop <= (int)ulNrGuards; iLoop++)
-	{
-		WriteWord (iFd, ulGuardX[iLoop]);
-		WriteWord (iFd, ulGuardY[iLoop]);
-		WriteByte (iFd, ulGuardDir[iLoop]);
-		WriteByte (iFd, ulGuardHP[iLoop]);
-		WriteByte (iFd, ulGuardA[iLoop]);
-		WriteByte (iFd, ulGuardB[iLoop]);
-		WriteByte (iFd, ulGuardC[iLoop]);
-		WriteByte (iFd, ulGuardD[iLoop]);
-		WriteByte (iFd, ulGuardE[iLoop]);
-		WriteByte (iFd, ulGuardF[iLoop]);
-	}
-
-	/*** potions ***/
-	WriteWord (iFd, ulNrPotions);
-	for (iLoop = 1; iLoop <= (int)ulNrPotions; iLoop++)
-	{
-		WriteByte (iFd, ulPotionType[iLoop]);
-		WriteWord (iFd, ulPotionX[iLoop]);
-		WriteWord (iFd, ulPotionY[iLoop]);
-	}
+	PutWord (sBytes, &lLength, ulExitImageX);
+	PutWord (sBytes, &lLength, ulExitImageY);
 
-	/*** loose ***/
-	WriteWord (iFd, ulNrLoose);
-	for (iLoop = 1; iLoop <= (int)ulNrLoose; iLoop++)
-	{
-		WriteWord (iFd, ulLooseX[iLoop]);
-		WriteWord (iFd, ulLooseY[iLoop]);
-		WriteByte (iFd, ulLooseRight[iLoop]);
-	}
+	/*** chompers, spikes, gates, raise, guards, potions, loose ***/
+	for (iLoop = KIND_CHOMPERS; iLoop <= KIND_LOOSE; iLoop++)
+		{ SaveKind (sBytes, &lLength, iLoop); }
 
 	/*** 0x00 0x00 ***/
-	WriteByte (iFd, 0);
-	WriteByte (iFd, 0);
+	PutByte (sBytes, &lLength, 0);
+	PutByte (sBytes, &lLength, 0);
 
 	/*** text ***/
 	ulNrText = 0;
@@ -4036,7 +4750,7 @@ void LevelSave (void)
 			ulNrText += strlen (arTextLine[iLoop]) + 1; /*** + 1 for '\' ***/
 		}
 	}
-	WriteWord (iFd, ulNrText);
+	PutWord (sBytes, &lLength, ulNrText);
 	for (iLoop = 1; iLoop <= MAX_LINES; iLoop++)
 	{
 		if (strcmp (arTextLine[iLoop], "") != 0)
@@ -4044,19 +4758,13 @@ void LevelSave (void)
 			for (iLoopChar = 0; iLoopChar < (int)strlen (arTextLine[iLoop]);
 				iLoopChar++)
 			{
-				WriteByte (iFd, arTextLine[iLoop][iLoopChar]);
+				PutByte (sBytes, &lLength, arTextLine[iLoop][iLoopChar]);
 			}
-			WriteByte (iFd, 0x5C); /*** '\' ***/
+			PutByte (sBytes, &lLength, 0x5C); /*** '\' ***/
 		}
 	}
 
-	close (iFd);
-
-	Compress();
-
-	PlaySound ("wav/save.wav");
-
-	iChanged = 0;
+	return (lLength);
 }
 /*****************************************************************************/
 void CreateBAK (void)
@@ -4120,17 +4828,54 @@ void WriteWord (int iFd, int iValue)
 	}
 }
 /*****************************************************************************/
+void PutByte (unsigned char *sBytes, long *lLength, unsigned long ulValue)
+/*****************************************************************************/
+{
+	if (*lLength == MAX_LVL_BYTES) { return; }
+	sBytes[*lLength] = ulValue & 0xFF;
+	(*lLength)++;
+}
+/*****************************************************************************/
+void PutWord (unsigned char *sBytes, long *lLength, unsigned long ulValue)
+/*****************************************************************************/
+{
+	PutByte (sBytes, lLength, ulValue);
+	PutByte (sBytes, lLength, ulValue >> 8);
+}
+/*****************************************************************************/
 void PopUpSave (void)
 /*****************************************************************************/
 {
-	int iSave;
+	char sLine1[MAX_STATUS + 2];
+	char sLine2[MAX_STATUS + 2];
+
+	if (iChanged == 1)
+	{
+		snprintf (sLine1, MAX_STATUS, "%s", "You made an unsaved change.");
+		snprintf (sLine2, MAX_STATUS, "%s", "Do you want to save it?");
+	} else {
+		snprintf (sLine1, MAX_STATUS, "%s", "There are unsaved changes.");
+		snprintf (sLine2, MAX_STATUS, "%s", "Do you wish to save these?");
+	}
+	if (PopUpYN (sLine1, sLine2) == 1) { LevelSave(); }
+}
+/*****************************************************************************/
+int PopUpYN (char *sLine1, char *sLine2)
+/*****************************************************************************/
+{
+	/* Asks a yes/no question; returns 1 for yes, 0 for no. */
+
+	int iPopUpYN;
+	int iAnswer;
 	SDL_Event event;
 
-	iSave = 1;
+	iPopUpYN = 1;
+	iAnswer = 0;
 
+	AssetUse (ASSET_POPUP);
 	PlaySound ("wav/popup_yn.wav");
-	ShowPopUpSave();
-	while (iSave == 1)
+	ShowPopUpYN (sLine1, sLine2);
+	while (iPopUpYN == 1)
 	{
 		while (SDL_PollEvent (&event))
 		{
@@ -4143,9 +4888,9 @@ void PopUpSave (void)
 					switch (event.cbutton.button)
 					{
 						case SDL_CONTROLLER_BUTTON_A:
-							LevelSave(); iSave = 0; break;
+							iAnswer = 1; iPopUpYN = 0; break;
 						case SDL_CONTROLLER_BUTTON_B:
-							iSave = 0; break;
+							iPopUpYN = 0; break;
 					}
 					break;
 				case SDL_KEYDOWN:
@@ -4153,9 +4898,9 @@ void PopUpSave (void)
 					{
 						case SDLK_ESCAPE:
 						case SDLK_n:
-							iSave = 0; break;
+							iPopUpYN = 0; break;
 						case SDLK_y:
-							LevelSave(); iSave = 0; break;
+							iAnswer = 1; iPopUpYN = 0; break;
 					}
 					break;
 				case SDL_MOUSEMOTION:
@@ -4170,7 +4915,7 @@ void PopUpSave (void)
 						if (InArea (177, 428, 177 + 85, 428 + 32) == 1) /*** No ***/
 							{ iNoOn = 1; }
 					}
-					ShowPopUpSave();
+					ShowPopUpYN (sLine1, sLine2);
 					break;
 				case SDL_MOUSEBUTTONUP:
 					iYesOn = 0;
@@ -4178,15 +4923,15 @@ void PopUpSave (void)
 					if (event.button.button == 1)
 					{
 						if (InArea (450, 428, 450 + 85, 428 + 32) == 1) /*** Yes ***/
-							{ LevelSave(); iSave = 0; }
+							{ iAnswer = 1; iPopUpYN = 0; }
 						if (InArea (177, 428, 177 + 85, 428 + 32) == 1) /*** No ***/
-							{ iSave = 0; }
+							{ iPopUpYN = 0; }
 					}
-					ShowPopUpSave();
+					ShowPopUpYN (sLine1, sLine2);
 					break;
 				case SDL_WINDOWEVENT:
 					if (event.window.event == SDL_WINDOWEVENT_EXPOSED)
-						{ ShowScreen(); ShowPopUpSave(); } break;
+						{ ShowScreen(); ShowPopUpYN (sLine1, sLine2); } break;
 				case SDL_QUIT:
 					Quit(); break;
 			}
@@ -4201,10 +4946,13 @@ void PopUpSave (void)
 		looptime = SDL_GetTicks();
 	}
 	PlaySound ("wav/popup_close.wav");
+	AssetDrop (ASSET_POPUP);
 	ShowScreen();
+
+	return (iAnswer);
 }
 /*****************************************************************************/
-void ShowPopUpSave (void)
+void ShowPopUpYN (char *sLine1, char *sLine2)
 /*****************************************************************************/
 {
 	/*** faded background ***/
@@ -4231,14 +4979,8 @@ void ShowPopUpSave (void)
 			ascreen, iScale, 1); break; /*** on ***/
 	}
 
-	if (iChanged == 1)
-	{
-		snprintf (arText[0], MAX_TEXT, "%s", "You made an unsaved change.");
-		snprintf (arText[1], MAX_TEXT, "%s", "Do you want to save it?");
-	} else {
-		snprintf (arText[0], MAX_TEXT, "%s", "There are unsaved changes.");
-		snprintf (arText[1], MAX_TEXT, "%s", "Do you wish to save these?");
-	}
+	snprintf (arText[0], MAX_TEXT, "%s", sLine1);
+	snprintf (arText[1], MAX_TEXT, "%s", sLine2);
 
 	DisplayText (190, 231, 15, 2, color_wh, 1);
 
@@ -4249,9 +4991,6 @@ void ShowPopUpSave (void)
 void Zoom (int iToggleFull)
 /*****************************************************************************/
 {
-	/*** Used for looping. ***/
-	int iLoopFont;
-
 	if (iToggleFull == 1)
 	{
 		if (iFullscreen == 0)
@@ -4278,9 +5017,8 @@ void Zoom (int iToggleFull)
 		(WINDOW_HEIGHT) * iScale);
 	SDL_SetWindowPosition (window, SDL_WINDOWPOS_CENTERED,
 		SDL_WINDOWPOS_CENTERED);
-	for (iLoopFont = 1; iLoopFont <= MAX_FONT_SIZE; iLoopFont++)
-		 { TTF_CloseFont (font[iLoopFont]); }
-	LoadFonts();
+	CloseFonts(); /*** Reopened at the new scale when used. ***/
+	FlushCachedText(); /*** The font sizes have changed. ***/
 
 	PlaySound ("wav/extras.wav");
 }
@@ -4399,6 +5137,7 @@ void Playtest (void)
 {
 	SDL_Thread *princethread;
 
+	JournalFlush (1);
 	princethread = SDL_CreateThread (StartGame, "StartGame", NULL);
 	if (princethread == NULL)
 		{ printf ("[ WARN ] Could not create thread!\n"); }
@@ -4425,11 +5164,14 @@ int StartGame (void *unused)
 	return (EXIT_NORMAL);
 }
 /*****************************************************************************/
-void AddFront (int iX, int iY, int iFrontTypeNr)
+int AddFront (int iX, int iY, int iFrontTypeNr)
 /*****************************************************************************/
 {
+	/*** Returns 1 if the object was added. ***/
+
 	int iType;
-	int iLoop;
+	int iSlot;
+	struct entity *stEnt;
 
 	if (iDebug == 1)
 	{
@@ -4437,11 +5179,23 @@ void AddFront (int iX, int iY, int iFrontTypeNr)
 			iFrontTypeNr, iX, iY);
 	}
 
-	iType = -1;
-	for (iLoop = 1; iLoop <= (int)ulFrontTypes; iLoop++)
+	iType = iFrontTypeOf[iFrontTypeNr];
+	if ((iType == -1) && (ulFrontTypes == MAX_FRONT_TYPE))
+	{
+		snprintf (sWarning, MAX_WARNING, "Cannot add: max. %i front types.",
+			MAX_FRONT_TYPE);
+		Warning();
+		return (0);
+	}
+	/*** Before a new front type is added, that would then be unused. ***/
+	if (ent[KIND_FRONT].ulNr == MAX_PER_KIND)
 	{
-		if ((int)ulFrontTypeNr[iLoop] == iFrontTypeNr) { iType = iLoop - 1; }
+		snprintf (sWarning, MAX_WARNING, "Cannot add: max. %i %s per level.",
+			MAX_PER_KIND, kind[KIND_FRONT].sPlural);
+		Warning();
+		return (0);
 	}
+	UndoBegin();
 	if (iType == -1)
 	{
 		ulFrontTypes++;
@@ -4449,6 +5203,10 @@ void AddFront (int iX, int iY, int iFrontTypeNr)
 		ulFrontTypeB[ulFrontTypes] = 0x00;
 		ulFrontTypeNr[ulFrontTypes] = iFrontTypeNr;
 		iType = ulFrontTypes - 1;
+		iFrontTypeOf[iFrontTypeNr] = iType;
+		UndoRecord (DELTA_FRONT_TYPE, iFrontTypeNr, 0, 0,
+			ulFrontTypes - 1, ulFrontTypes);
+		JournalAdd (DELTA_FRONT_TYPE, iFrontTypeNr, 0, 0, ulFrontTypes, NULL);
 		if (iDebug == 1)
 		{
 			printf ("[  OK  ] Added front type 0x%02X as %i.\n",
@@ -4461,41 +5219,49 @@ void AddFront (int iX, int iY, int iFrontTypeNr)
 				iFrontTypeNr, iType);
 		}
 	}
-	ulNrFront++;
-	ulFrontX[ulNrFront] = iX;
-	ulFrontY[ulNrFront] = iY;
-	ulFrontType[ulNrFront] = iType;
+	iSlot = EntAdd (KIND_FRONT);
+	if (iSlot == -1) { UndoEnd(); return (0); }
+	stEnt = &ent[KIND_FRONT].arEnt[iSlot];
+	stEnt->ulX = iX;
+	stEnt->ulY = iY;
+	stEnt->ulField[FIELD_FRONT_TYPE] = iType;
+	stEnt->ulField[FIELD_FRONT_CODE] = iFrontTypeNr;
 	switch (iFrontTypeNr)
 	{
 		case 0x30: /*** torch ***/
-			ulFrontA[ulNrFront] = iFront0101;
-			ulFrontB[ulNrFront] = iFront0102;
+			stEnt->ulField[FIELD_FRONT_A] = iFront0101;
+			stEnt->ulField[FIELD_FRONT_B] = iFront0102;
 			break;
 		case 0x31: /*** pillar front ***/
-			ulFrontA[ulNrFront] = iFront0201;
-			ulFrontB[ulNrFront] = iFront0202;
+			stEnt->ulField[FIELD_FRONT_A] = iFront0201;
+			stEnt->ulField[FIELD_FRONT_B] = iFront0202;
 			break;
 		case 0x32: /*** skeleton ***/
-			ulFrontA[ulNrFront] = iFront0301;
-			ulFrontB[ulNrFront] = iFront0302;
+			stEnt->ulField[FIELD_FRONT_A] = iFront0301;
+			stEnt->ulField[FIELD_FRONT_B] = iFront0302;
 			break;
 		case 0x33: /*** wall top left slash ***/
-			ulFrontA[ulNrFront] = iFront0401;
-			ulFrontB[ulNrFront] = iFront0402;
+			stEnt->ulField[FIELD_FRONT_A] = iFront0401;
+			stEnt->ulField[FIELD_FRONT_B] = iFront0402;
 			break;
 		case 0x34: /*** wall top left dot ***/
-			ulFrontA[ulNrFront] = iFront0501;
-			ulFrontB[ulNrFront] = iFront0502;
+			stEnt->ulField[FIELD_FRONT_A] = iFront0501;
+			stEnt->ulField[FIELD_FRONT_B] = iFront0502;
 			break;
 		case 0x35: /*** wall bottom left ***/
-			ulFrontA[ulNrFront] = iFront0601;
-			ulFrontB[ulNrFront] = iFront0602;
+			stEnt->ulField[FIELD_FRONT_A] = iFront0601;
+			stEnt->ulField[FIELD_FRONT_B] = iFront0602;
 			break;
 		case 0x36: /*** floor climbable ***/
-			ulFrontA[ulNrFront] = iFront0701;
-			ulFrontB[ulNrFront] = iFront0702;
+			stEnt->ulField[FIELD_FRONT_A] = iFront0701;
+			stEnt->ulField[FIELD_FRONT_B] = iFront0702;
 			break;
 	}
+	IndexAdd (KIND_FRONT, iSlot);
+	UndoEntity (KIND_FRONT, iSlot, 1);
+	UndoEnd();
+
+	return (1);
 }
 /*****************************************************************************/
 void ClearLevel (void)
@@ -4503,22 +5269,32 @@ void ClearLevel (void)
 {
 	/*** Used for looping. ***/
 	int iRowLoop, iColumnLoop;
+	int iLoop;
 
+	UndoBegin();
+	UndoAreaBegin();
 	for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
 	{
 		for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
-			{ ulBack[iRowLoop][iColumnLoop] = 0x04; }
+			{ SetBack (iRowLoop, iColumnLoop, 0x04); }
 	}
+	UndoAreaEnd();
 	/*** Not touching ulNrUnknown. ***/
 	/*** Not touching ulFrontTypes. ***/
-	ulNrFront = 1; /*** Should not be 0, to prevent level start hang. ***/
-	ulNrChompers = 0;
-	ulNrSpikes = 1; /*** Should not be 0, to prevent fall hang. ***/
-	ulNrGates = 1; /*** Should not be 0, to prevent error messages. ***/
-	ulNrRaise = 0;
-	ulNrGuards = 0;
-	ulNrPotions = 1; /*** Must not be 0, to prevent level start hang. ***/
-	ulNrLoose = 0;
+	/* Keeps the first kind[].iMin objects. There must be 1+ front and
+	 * potions to prevent a level start hang, 1+ spikes to prevent a fall
+	 * hang and 1+ gates to prevent error messages.
+	 */
+	for (iLoop = 1; iLoop <= MAX_KINDS; iLoop++)
+	{
+		while ((int)ent[iLoop].ulNr > kind[iLoop].iMin)
+		{
+			UndoEntity (iLoop, ent[iLoop].iLast, 0);
+			EntDel (iLoop, ent[iLoop].iLast);
+		}
+	}
+	IndexRebuild();
+	UndoEnd();
 
 	PlaySound ("wav/ok_close.wav");
 	iChanged++;
@@ -4530,7 +5306,7 @@ void Text (void)
 	int iText;
 	SDL_Event event;
 	char cAdd;
-	char sTempLine[MAX_LINECHARS + 2];
+	int iLen;
 
 	/*** Used for looping. ***/
 	int iLoopLine;
@@ -4538,6 +5314,10 @@ void Text (void)
 	iText = 1;
 	iLine = 0;
 
+	/*** All typing in one visit is one undo step. ***/
+	UndoBegin();
+
+	AssetUse (ASSET_TEXT);
 	PlaySound ("wav/popup.wav");
 	ShowText();
 	while (iText == 1)
@@ -4569,7 +5349,7 @@ void Text (void)
 						case SDLK_BACKSPACE:
 							if ((iLine != 0) && (strlen (arTextLine[iLine]) > 0))
 							{
-								arTextLine[iLine][strlen (arTextLine[iLine]) - 1] = '\0';
+								SetTextChar (iLine, strlen (arTextLine[iLine]) - 1, '\0');
 								PlaySound ("wav/hum_adj.wav");
 							}
 							break;
@@ -4629,9 +5409,9 @@ void Text (void)
 							(cAdd == ' ') || (cAdd == '\'') ||
 							(cAdd == '!') || (cAdd == '.'))
 						{
-							snprintf (sTempLine, MAX_LINECHARS, "%s", arTextLine[iLine]);
-							snprintf (arTextLine[iLine], MAX_LINECHARS, "%s%c",
-								sTempLine, cAdd);
+							iLen = strlen (arTextLine[iLine]);
+							SetTextChar (iLine, iLen + 1, '\0');
+							SetTextChar (iLine, iLen, cAdd);
 							PlaySound ("wav/hum_adj.wav");
 							iChanged++;
 						}
@@ -4649,7 +5429,9 @@ void Text (void)
 		}
 		looptime = SDL_GetTicks();
 	}
+	UndoEnd();
 	PlaySound ("wav/popup_close.wav");
+	AssetDrop (ASSET_TEXT);
 	SDL_SetCursor (curArrow);
 	SDL_StopTextInput();
 	ShowScreen();
@@ -4698,24 +5480,23 @@ void EXE (void)
 	SDL_Event event;
 	int iOldXPos, iOldYPos;
 	int iEXEOld;
+	int iMenuWas, iEmphasisWas, iLinesWas;
 
 	iEXE = 1;
-	iStatusBarFrame = 1;
+	InitAnim (ANIM_STATUSBAR, 18, REFRESH_PROG);
 	snprintf (sStatus, MAX_STATUS, "%s", "");
 
 	EXELoad();
+	iMenuWas = iEXEMenuInitialSelection;
+	iEmphasisWas = iEXECutscenesFontEmphasis;
+	iLinesWas = iEXECutscenesTextLines;
 
+	AssetUse (ASSET_EXE);
 	PlaySound ("wav/popup.wav");
 	ShowEXE();
 	while (iEXE == 1)
 	{
-		if (iNoAnim == 0)
-		{
-			/*** We use the global REFRESH. No need for newticks/oldticks. ***/
-			iStatusBarFrame++;
-			if (iStatusBarFrame == 19) { iStatusBarFrame = 1; }
-			ShowEXE();
-		}
+		if (AnimTick (ANIM_STATUSBAR) == 1) { ShowEXE(); }
 
 		while (SDL_PollEvent (&event))
 		{
@@ -4728,7 +5509,7 @@ void EXE (void)
 					switch (event.cbutton.button)
 					{
 						case SDL_CONTROLLER_BUTTON_A:
-							EXESave(); iEXE = 0; break;
+							iEXE = 2; break; /*** save ***/
 						case SDL_CONTROLLER_BUTTON_B:
 							iEXE = 0; break;
 					}
@@ -4742,12 +5523,13 @@ void EXE (void)
 						case SDLK_RETURN:
 						case SDLK_SPACE:
 						case SDLK_s:
-							EXESave(); iEXE = 0;
+							iEXE = 2; /*** save ***/
 							break;
 					}
 					ShowEXE();
 					break;
 				case SDL_MOUSEMOTION:
+					LatestMotion (&event);
 					iOldXPos = iXPos;
 					iOldYPos = iYPos;
 					iXPos = event.motion.x;
@@ -4794,7 +5576,7 @@ void EXE (void)
 						if (iEXECutscenesTextLines != iEXEOld) { UpdateStatusBar(); }
 
 						if (InArea (610, 633, 610 + 85, 633 + 32) == 1) /*** Save ***/
-							{ EXESave(); iEXE = 0; }
+							{ iEXE = 2; /*** save ***/ }
 					}
 					ShowEXE();
 					break;
@@ -4807,14 +5589,31 @@ void EXE (void)
 		}
 
 		/*** prevent CPU eating ***/
-		gamespeed = REFRESH_PROG;
-		while ((SDL_GetTicks() - looptime) < gamespeed)
+		AnimSleep (ANIM_STATUSBAR);
+	}
+	if (iEXE == 2)
+	{
+		UndoBegin();
+		if (iEXEMenuInitialSelection != iMenuWas)
 		{
-			SDL_Delay (10);
+			UndoRecord (DELTA_EXE, EXE_MENU_SELECTION, 0, 0,
+				iMenuWas, iEXEMenuInitialSelection);
 		}
-		looptime = SDL_GetTicks();
+		if (iEXECutscenesFontEmphasis != iEmphasisWas)
+		{
+			UndoRecord (DELTA_EXE, EXE_FONT_EMPHASIS, 0, 0,
+				iEmphasisWas, iEXECutscenesFontEmphasis);
+		}
+		if (iEXECutscenesTextLines != iLinesWas)
+		{
+			UndoRecord (DELTA_EXE, EXE_TEXT_LINES, 0, 0,
+				iLinesWas, iEXECutscenesTextLines);
+		}
+		UndoEnd();
+		EXESave();
 	}
 	PlaySound ("wav/popup_close.wav");
+	AssetDrop (ASSET_EXE);
 	ShowScreen();
 }
 /*****************************************************************************/
@@ -5081,193 +5880,13 @@ int AlignY (int iY, int iOverTwentyFour)
 	return (iReturn);
 }
 /*****************************************************************************/
-void DelWhat (int iType, int iX, int iY)
-/*****************************************************************************/
-{
-	int iLoopE;
-	int iXE, iYE;
-
-	/*** Used for looping. ***/
-	int iLoop;
-
-	switch (iType)
-	{
-		case 1: iLoopE = ulNrFront; break;
-		case 2: iLoopE = ulNrChompers; break;
-		case 3: iLoopE = ulNrSpikes; break;
-		case 4: iLoopE = ulNrGates; break;
-		case 5: iLoopE = ulNrRaise; break;
-		case 6: iLoopE = ulNrGuards; break;
-		case 7: iLoopE = ulNrPotions; break;
-		case 8: iLoopE = ulNrLoose; break;
-		default:
-			snprintf (sError, MAX_ERROR, "Unknown type: %i", iType);
-			ErrorAndExit(); break;
-	}
-	for (iLoop = 1; iLoop <= iLoopE; iLoop++)
-	{
-		switch (iType)
-		{
-			case 1: iXE = ulFrontX[iLoop]; iYE = ulFrontY[iLoop]; break;
-			case 2: iXE = ulChomperX[iLoop]; iYE = ulChomperY[iLoop]; break;
-			case 3: iXE = ulSpikeX[iLoop]; iYE = ulSpikeY[iLoop]; break;
-			case 4: iXE = ulGateX[iLoop]; iYE = ulGateY[iLoop]; break;
-			case 5: iXE = ulRaiseX[iLoop]; iYE = ulRaiseY[iLoop]; break;
-			case 6: iXE = ulGuardX[iLoop]; iYE = ulGuardY[iLoop]; break;
-			case 7: iXE = ulPotionX[iLoop]; iYE = ulPotionY[iLoop]; break;
-			case 8: iXE = ulLooseX[iLoop]; iYE = ulLooseY[iLoop]; break;
-			default:
-				snprintf (sError, MAX_ERROR, "Unknown type: %i", iType);
-				ErrorAndExit(); break;
-		}
-
-		if (((abs (iX - iXE)) +
-			(abs (iY - iYE))) < iXYNear)
-		{
-			iXYNear = (abs (iX - iXE)) +
-				(abs (iY - iYE));
-			iDelWhat = iType;
-			iDelX = iXE;
-			iDelY = iYE;
-			iDelXPos = iXPos;
-			iDelYPos = iYPos;
-		}
-	}
-}
-/*****************************************************************************/
 void Del (void)
 /*****************************************************************************/
 {
-	int iMove;
-
-	/*** Used for looping. ***/
-	int iLoop;
-
-	iMove = 0;
-	switch (iDelWhat)
-	{
-		case 1: /*** front ***/
-			for (iLoop = 1; iLoop <= (int)ulNrFront; iLoop++)
-			{
-				if (((int)ulFrontX[iLoop] == iDelX) &&
-					((int)ulFrontY[iLoop] == iDelY)) { iMove = 1; }
-				if ((iMove == 1) && (iLoop != (int)ulNrFront))
-				{
-					ulFrontX[iLoop] = ulFrontX[iLoop + 1];
-					ulFrontY[iLoop] = ulFrontY[iLoop + 1];
-					ulFrontType[iLoop] = ulFrontType[iLoop + 1];
-					ulFrontA[iLoop] = ulFrontA[iLoop + 1];
-					ulFrontB[iLoop] = ulFrontB[iLoop + 1];
-				}
-			}
-			ulNrFront--;
-			break;
-		case 2: /*** chompers ***/
-			for (iLoop = 1; iLoop <= (int)ulNrChompers; iLoop++)
-			{
-				if (((int)ulChomperX[iLoop] == iDelX) &&
-					((int)ulChomperY[iLoop] == iDelY)) { iMove = 1; }
-				if ((iMove == 1) && (iLoop != (int)ulNrChompers))
-				{
-					ulChomperX[iLoop] = ulChomperX[iLoop + 1];
-					ulChomperY[iLoop] = ulChomperY[iLoop + 1];
-					ulChomperA[iLoop] = ulChomperA[iLoop + 1];
-				}
-			}
-			ulNrChompers--;
-			break;
-		case 3: /*** spikes ***/
-			for (iLoop = 1; iLoop <= (int)ulNrSpikes; iLoop++)
-			{
-				if (((int)ulSpikeX[iLoop] == iDelX) &&
-					((int)ulSpikeY[iLoop] == iDelY)) { iMove = 1; }
-				if ((iMove == 1) && (iLoop != (int)ulNrSpikes))
-				{
-					ulSpikeX[iLoop] = ulSpikeX[iLoop + 1];
-					ulSpikeY[iLoop] = ulSpikeY[iLoop + 1];
-					ulSpikeRight[iLoop] = ulSpikeRight[iLoop + 1];
-				}
-			}
-			ulNrSpikes--;
-			break;
-		case 4: /*** gates ***/
-			for (iLoop = 1; iLoop <= (int)ulNrGates; iLoop++)
-			{
-				if (((int)ulGateX[iLoop] == iDelX) &&
-					((int)ulGateY[iLoop] == iDelY)) { iMove = 1; }
-				if ((iMove == 1) && (iLoop != (int)ulNrGates))
-				{
-					ulGateX[iLoop] = ulGateX[iLoop + 1];
-					ulGateY[iLoop] = ulGateY[iLoop + 1];
-					ulGateTimeOpen[iLoop] = ulGateTimeOpen[iLoop + 1];
-				}
-			}
-			ulNrGates--;
-			break;
-		case 5: /*** raise ***/
-			for (iLoop = 1; iLoop <= (int)ulNrRaise; iLoop++)
-			{
-				if (((int)ulRaiseX[iLoop] == iDelX) &&
-					((int)ulRaiseY[iLoop] == iDelY)) { iMove = 1; }
-				if ((iMove == 1) && (iLoop != (int)ulNrRaise))
-				{
-					ulRaiseGate[iLoop] = ulRaiseGate[iLoop + 1];
-					ulRaiseX[iLoop] = ulRaiseX[iLoop + 1];
-					ulRaiseY[iLoop] = ulRaiseY[iLoop + 1];
-				}
-			}
-			ulNrRaise--;
-			break;
-		case 6: /*** guards ***/
-			for (iLoop = 1; iLoop <= (int)ulNrGuards; iLoop++)
-			{
-				if (((int)ulGuardX[iLoop] == iDelX) &&
-					((int)ulGuardY[iLoop] == iDelY)) { iMove = 1; }
-				if ((iMove == 1) && (iLoop != (int)ulNrGuards))
-				{
-					ulGuardX[iLoop] = ulGuardX[iLoop + 1];
-					ulGuardY[iLoop] = ulGuardY[iLoop + 1];
-					ulGuardDir[iLoop] = ulGuardDir[iLoop + 1];
-					ulGuardHP[iLoop] = ulGuardHP[iLoop + 1];
-					ulGuardA[iLoop] = ulGuardA[iLoop + 1];
-					ulGuardB[iLoop] = ulGuardB[iLoop + 1];
-					ulGuardC[iLoop] = ulGuardC[iLoop + 1];
-					ulGuardD[iLoop] = ulGuardD[iLoop + 1];
-					ulGuardE[iLoop] = ulGuardE[iLoop + 1];
-					ulGuardF[iLoop] = ulGuardF[iLoop + 1];
-				}
-			}
-			ulNrGuards--;
-			break;
-		case 7: /*** potions ***/
-			for (iLoop = 1; iLoop <= (int)ulNrPotions; iLoop++)
-			{
-				if (((int)ulPotionX[iLoop] == iDelX) &&
-					((int)ulPotionY[iLoop] == iDelY)) { iMove = 1; }
-				if ((iMove == 1) && (iLoop != (int)ulNrPotions))
-				{
-					ulPotionType[iLoop] = ulPotionType[iLoop + 1];
-					ulPotionX[iLoop] = ulPotionX[iLoop + 1];
-					ulPotionY[iLoop] = ulPotionY[iLoop + 1];
-				}
-			}
-			ulNrPotions--;
-			break;
-		case 8: /*** loose ***/
-			for (iLoop = 1; iLoop <= (int)ulNrLoose; iLoop++)
-			{
-				if (((int)ulLooseX[iLoop] == iDelX) &&
-					((int)ulLooseY[iLoop] == iDelY)) { iMove = 1; }
-				if ((iMove == 1) && (iLoop != (int)ulNrLoose))
-				{
-					ulLooseX[iLoop] = ulLooseX[iLoop + 1];
-					ulLooseY[iLoop] = ulLooseY[iLoop + 1];
-					ulLooseRight[iLoop] = ulLooseRight[iLoop + 1];
-				}
-			}
-			ulNrLoose--;
-			break;
-	}
+	UndoEntity (iDelWhat, iDelSlot, 0);
+	IndexDel (iDelWhat, iDelSlot);
+	LinkDel (iDelWhat, iDelSlot);
+	EntDel (iDelWhat, iDelSlot);
 
 	PlaySound ("wav/hum_adj.wav");
 	iChanged++;
@@ -5319,6 +5938,7 @@ void InitPopUp (void)
 
 	iPopUp = 1;
 
+	AssetUse (ASSET_POPUP);
 	PlaySound ("wav/popup.wav");
 	ShowPopUp();
 	while (iPopUp == 1)
@@ -5387,6 +6007,7 @@ void InitPopUp (void)
 		looptime = SDL_GetTicks();
 	}
 	PlaySound ("wav/popup_close.wav");
+	AssetDrop (ASSET_POPUP);
 	ShowScreen();
 }
 /*****************************************************************************/
@@ -5432,29 +6053,5564 @@ void ShowPopUp (void)
 void UpdateHover (void)
 /*****************************************************************************/
 {
+	/* The tiles are 16x24 times iZoom, starting at the map origin, so the
+	 * tile under the mouse can simply be calculated. As before, the hover
+	 * only changes if the mouse is on a tile.
+	 */
+
 	int iX, iY;
-	int iXFull, iYFull;
+	int iRow, iColumn;
+
+	iX = iXPos - MapStartX();
+	iY = iYPos - MapStartY();
+	if ((iX < 0) || (iY < 0)) { return; }
+	iColumn = (iX / (16 * iZoom)) + 1;
+	iRow = (iY / (24 * iZoom)) + 1;
+	if ((iColumn > (int)ulWidth) || (iRow > (int)ulHeight)) { return; }
+
+	iHoverRow = iRow;
+	iHoverColumn = iColumn;
+}
+/*****************************************************************************/
+SDL_Texture *CachedText (char *sString, int iFontSize, int iBlended,
+	SDL_Color fore, SDL_Color back, int *iWidth, int *iHeight)
+/*****************************************************************************/
+{
+	/* Returns a texture of sString, rendered in font size iFontSize. With
+	 * iBlended 0 it is shaded on back, with iBlended 1 it is blended (back is
+	 * then ignored). Since mostly the same labels are drawn every frame, the
+	 * least recently used textures are kept. The caller must NOT destroy the
+	 * returned texture.
+	 */
+
+	int iOldest;
+	int iUse;
 
 	/*** Used for looping. ***/
-	int iRowLoop, iColumnLoop;
+	int iLoop;
 
-	iY = 0;
-	for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
+	ulCacheTick++;
+	iOldest = 0;
+	for (iLoop = 0; iLoop < MAX_CACHED; iLoop++)
+	{
+		if ((cached[iLoop].text != NULL) &&
+			(cached[iLoop].iFontSize == iFontSize) &&
+			(cached[iLoop].iBlended == iBlended) &&
+			(memcmp (&cached[iLoop].fore, &fore, sizeof (SDL_Color)) == 0) &&
+			((iBlended == 1) ||
+			(memcmp (&cached[iLoop].back, &back, sizeof (SDL_Color)) == 0)) &&
+			(strcmp (cached[iLoop].sText, sString) == 0))
+		{
+			cached[iLoop].ulLastUsed = ulCacheTick;
+			*iWidth = cached[iLoop].iWidth;
+			*iHeight = cached[iLoop].iHeight;
+			ulCacheHits++;
+			return (cached[iLoop].text);
+		}
+		if (cached[iLoop].ulLastUsed < cached[iOldest].ulLastUsed)
+			{ iOldest = iLoop; }
+	}
+	ulCacheMisses++;
+
+	/*** Replace the least recently used (or an empty) entry. ***/
+	iUse = iOldest;
+	if (cached[iUse].text != NULL) { SDL_DestroyTexture (cached[iUse].text); }
+	if (iBlended == 0)
 	{
-		iX = 0;
-		for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
+		message = TTF_RenderText_Shaded (Font (iFontSize), sString, color_bl, back);
+	} else {
+		/* The 100000 is a workaround for 0 being broken. SDL devs have fixed
+		 * that see e.g. https://hg.libsdl.org/SDL_ttf/rev/72b8861dbc01 but
+		 * Ubuntu et al. still ship older sdl2-ttf versions.
+		 */
+		message = TTF_RenderText_Blended_Wrapped (Font (iFontSize), sString,
+			fore, 100000);
+	}
+	cached[iUse].text = SDL_CreateTextureFromSurface (ascreen, message);
+	cached[iUse].iWidth = message->w;
+	cached[iUse].iHeight = message->h;
+	SDL_FreeSurface (message);
+	if (strlen (sString) <= MAX_CACHED_TEXT)
+	{
+		snprintf (cached[iUse].sText, MAX_CACHED_TEXT + 1, "%s", sString);
+		cached[iUse].iFontSize = iFontSize;
+	} else {
+		snprintf (cached[iUse].sText, MAX_CACHED_TEXT, "%s", "");
+		cached[iUse].iFontSize = -1; /*** Too long to be a key. ***/
+	}
+	cached[iUse].iBlended = iBlended;
+	cached[iUse].fore = fore;
+	cached[iUse].back = back;
+	cached[iUse].ulLastUsed = ulCacheTick;
+
+	*iWidth = cached[iUse].iWidth;
+	*iHeight = cached[iUse].iHeight;
+	return (cached[iUse].text);
+}
+/*****************************************************************************/
+void FlushCachedText (void)
+/*****************************************************************************/
+{
+	/*** Used for looping. ***/
+	int iLoop;
+
+	for (iLoop = 0; iLoop < MAX_CACHED; iLoop++)
+	{
+		if (cached[iLoop].text != NULL)
 		{
-			iXFull = MapStartX() + (iX * iZoom);
-			iYFull = MapStartY() + (iY * iZoom);
-			if ((iXPos >= iXFull) && (iXPos < (iXFull + (16 * iZoom))) &&
-				(iYPos >= iYFull) && (iYPos < (iYFull + (24 * iZoom))))
-			{
-				iHoverRow = iRowLoop;
-				iHoverColumn = iColumnLoop;
-			}
-			iX+=16;
+			SDL_DestroyTexture (cached[iLoop].text);
+			cached[iLoop].text = NULL;
 		}
-		iY+=24;
+		cached[iLoop].ulLastUsed = 0;
+	}
+}
+/*****************************************************************************/
+TTF_Font *Font (int iSize)
+/*****************************************************************************/
+{
+	SDL_RWops *rwFont;
+
+	if (iSize < 1) { iSize = 1; }
+	if (iSize > MAX_FONT_SIZE) { iSize = MAX_FONT_SIZE; }
+	if (font[iSize] == NULL)
+	{
+		rwFont = SDL_RWFromConstMem (sFontData, lFontDataSize);
+		if (rwFont != NULL)
+			{ font[iSize] = TTF_OpenFontRW (rwFont, 1, iSize * iScale); }
+		if (font[iSize] == NULL)
+		{
+			snprintf (sError, MAX_ERROR, "%s", "Could not load font!");
+			ErrorAndExit();
+		}
+		if (iDebug == 1)
+			{ printf ("[  OK  ] Opened font size %i.\n", iSize * iScale); }
 	}
+
+	return (font[iSize]);
 }
 /*****************************************************************************/
+void CloseFonts (void)
+/*****************************************************************************/
+{
+	/*** Used for looping. ***/
+	int iLoopFont;
+
+	for (iLoopFont = 1; iLoopFont <= MAX_FONT_SIZE; iLoopFont++)
+	{
+		if (font[iLoopFont] != NULL)
+		{
+			TTF_CloseFont (font[iLoopFont]);
+			font[iLoopFont] = NULL;
+		}
+	}
+}
+/*****************************************************************************/
+void InitAnim (int iAnim, int iFrames, Uint32 ulRate)
+/*****************************************************************************/
+{
+	anim[iAnim].iFrames = iFrames;
+	anim[iAnim].ulRate = ulRate;
+	anim[iAnim].iFrame = 1;
+	anim[iAnim].ulNext = SDL_GetTicks() + ulRate;
+}
+/*****************************************************************************/
+int AnimTick (int iAnim)
+/*****************************************************************************/
+{
+	/* Advances animation iAnim if its next frame is due. Returns 1 if the
+	 * frame changed, so that the caller knows it has to redraw. Drawing code
+	 * only reads anim[].iFrame and never advances it.
+	 */
+
+	Uint32 ulNow;
+
+	if (iNoAnim == 1) { return (0); }
+	ulNow = SDL_GetTicks();
+	if ((Sint32)(ulNow - anim[iAnim].ulNext) < 0) { return (0); }
+
+	anim[iAnim].iFrame++;
+	if (anim[iAnim].iFrame > anim[iAnim].iFrames) { anim[iAnim].iFrame = 1; }
+	anim[iAnim].ulNext += anim[iAnim].ulRate;
+	/*** If we fell behind, do not try to catch up. ***/
+	if ((Sint32)(ulNow - anim[iAnim].ulNext) >= 0)
+		{ anim[iAnim].ulNext = ulNow + anim[iAnim].ulRate; }
+
+	return (1);
+}
+/*****************************************************************************/
+void AnimSleep (int iAnim)
+/*****************************************************************************/
+{
+	/* Sleeps until the next frame of animation iAnim is due, but no longer
+	 * than REFRESH_PROG after the previous loop, so that events are still
+	 * handled in time.
+	 */
+
+	Uint32 ulUntil;
+	Uint32 ulNow;
+
+	ulUntil = looptime + REFRESH_PROG;
+	if ((iNoAnim == 0) && ((Sint32)(anim[iAnim].ulNext - ulUntil) < 0))
+		{ ulUntil = anim[iAnim].ulNext; }
+	ulNow = SDL_GetTicks();
+	if ((Sint32)(ulUntil - ulNow) > 0) { SDL_Delay (ulUntil - ulNow); }
+	looptime = SDL_GetTicks();
+}
+/*****************************************************************************/
+int IndexCell (int iX, int iY)
+/*****************************************************************************/
+{
+	/* Objects (and queries) outside of the level go in the cells around it,
+	 * so that the grid is (ulWidth + 2) x (ulHeight + 2).
+	 */
+
+	int iCellX, iCellY;
+
+	if (iX < 0) { iCellX = 0; } else { iCellX = iX / 16; }
+	if (iCellX > (int)ulWidth + 1) { iCellX = (int)ulWidth + 1; }
+	if (iY < 0) { iCellY = 0; } else { iCellY = iY / 24; }
+	if (iCellY > (int)ulHeight + 1) { iCellY = (int)ulHeight + 1; }
+
+	return ((iCellY * (MAX_WIDTH + 2)) + iCellX);
+}
+/*****************************************************************************/
+void IndexRebuild (void)
+/*****************************************************************************/
+{
+	/*** Used for looping. ***/
+	int iLoop;
+	int iKind;
+	int iSlot;
+
+	for (iLoop = 0; iLoop < ((int)ulHeight + 2) * (MAX_WIDTH + 2); iLoop++)
+		{ iIndexHead[iLoop] = -1; }
+	for (iLoop = 0; iLoop < MAX_INDEXED; iLoop++)
+		{ indexed[iLoop].iNext = iLoop + 1; }
+	indexed[MAX_INDEXED - 1].iNext = -1;
+	iIndexFree = 0;
+
+	for (iKind = 1; iKind <= MAX_KINDS; iKind++)
+	{
+		for (iSlot = ent[iKind].iFirst; iSlot != -1;
+			iSlot = ent[iKind].arEnt[iSlot].iNext) { IndexAdd (iKind, iSlot); }
+	}
+	LinkRebuild();
+}
+/*****************************************************************************/
+void IndexAdd (int iKind, int iSlot)
+/*****************************************************************************/
+{
+	int iEntry;
+
+	if (iIndexFree == -1)
+	{
+		printf ("[ WARN ] Cannot index %s %i!\n", kind[iKind].sName, iSlot);
+		return;
+	}
+	iEntry = iIndexFree;
+	iIndexFree = indexed[iEntry].iNext;
+
+	indexed[iEntry].iKind = iKind;
+	indexed[iEntry].iSlot = iSlot;
+	indexed[iEntry].iCell = IndexCell (ent[iKind].arEnt[iSlot].ulX,
+		ent[iKind].arEnt[iSlot].ulY);
+	indexed[iEntry].iPrev = -1;
+	indexed[iEntry].iNext = iIndexHead[indexed[iEntry].iCell];
+	if (indexed[iEntry].iNext != -1)
+		{ indexed[indexed[iEntry].iNext].iPrev = iEntry; }
+	iIndexHead[indexed[iEntry].iCell] = iEntry;
+	iIndexOf[iKind][iSlot] = iEntry;
+}
+/*****************************************************************************/
+void IndexDel (int iKind, int iSlot)
+/*****************************************************************************/
+{
+	int iEntry;
+
+	iEntry = iIndexOf[iKind][iSlot];
+	if (indexed[iEntry].iPrev != -1)
+	{
+		indexed[indexed[iEntry].iPrev].iNext = indexed[iEntry].iNext;
+	} else {
+		iIndexHead[indexed[iEntry].iCell] = indexed[iEntry].iNext;
+	}
+	if (indexed[iEntry].iNext != -1)
+		{ indexed[indexed[iEntry].iNext].iPrev = indexed[iEntry].iPrev; }
+	indexed[iEntry].iNext = iIndexFree;
+	iIndexFree = iEntry;
+}
+/*****************************************************************************/
+int NearestObject (int iX, int iY, int iMax, int *iKind, int *iSlot)
+/*****************************************************************************/
+{
+	/* Returns the Manhattan distance of the object nearest to iX,iY, or -1 if
+	 * there is none closer than iMax. The cells are searched in rings around
+	 * the cell of iX,iY. Objects in ring r+1 are more than r*16 away, so the
+	 * search stops as soon as that cannot beat the best so far.
+	 */
+
+	int iCell, iCellX, iCellY;
+	int iMaxRing, iRing;
+	int iStep;
+	int iBest;
+
+	/*** Used for looping. ***/
+	int iCX, iCY;
+
+	iCell = IndexCell (iX, iY);
+	iCellX = iCell % (MAX_WIDTH + 2);
+	iCellY = iCell / (MAX_WIDTH + 2);
+	iMaxRing = (int)ulWidth + 1;
+	if ((int)ulHeight + 1 > iMaxRing) { iMaxRing = (int)ulHeight + 1; }
+
+	iBest = -1;
+	for (iRing = 0; iRing <= iMaxRing; iRing++)
+	{
+		for (iCY = iCellY - iRing; iCY <= iCellY + iRing; iCY++)
+		{
+			if ((iCY >= 0) && (iCY <= (int)ulHeight + 1))
+			{
+				/*** All of the top and bottom row, else the left and right cell. ***/
+				if ((iCY == iCellY - iRing) || (iCY == iCellY + iRing))
+					{ iStep = 1; } else { iStep = iRing * 2; }
+				for (iCX = iCellX - iRing; iCX <= iCellX + iRing; iCX+=iStep)
+				{
+					if ((iCX >= 0) && (iCX <= (int)ulWidth + 1))
+					{
+						NearestInCell ((iCY * (MAX_WIDTH + 2)) + iCX, iX, iY, iMax,
+							&iBest, iKind, iSlot);
+					}
+				}
+			}
+		}
+		if ((iBest != -1) && (iBest <= iRing * 16)) { break; }
+		if (iRing * 16 >= iMax) { break; }
+	}
+
+	return (iBest);
+}
+/*****************************************************************************/
+void NearestInCell (int iCell, int iX, int iY, int iMax,
+	int *iBest, int *iKind, int *iSlot)
+/*****************************************************************************/
+{
+	/* Ties go to the lowest kind, then to the first in file order, like the
+	 * old scans per kind did.
+	 */
+
+	int iEntry;
+	struct entity *stEnt;
+	int iDist;
+
+	iEntry = iIndexHead[iCell];
+	while (iEntry != -1)
+	{
+		stEnt = &ent[indexed[iEntry].iKind].arEnt[indexed[iEntry].iSlot];
+		iDist = abs (iX - (int)stEnt->ulX) + abs (iY - (int)stEnt->ulY);
+		if ((iDist < iMax) && ((*iBest == -1) || (iDist < *iBest) ||
+			((iDist == *iBest) && ((indexed[iEntry].iKind < *iKind) ||
+			((indexed[iEntry].iKind == *iKind) &&
+			(stEnt->ulOrder < ent[*iKind].arEnt[*iSlot].ulOrder))))))
+		{
+			*iBest = iDist;
+			*iKind = indexed[iEntry].iKind;
+			*iSlot = indexed[iEntry].iSlot;
+		}
+		iEntry = indexed[iEntry].iNext;
+	}
+}
+/*****************************************************************************/
+void IndexStampVisible (void)
+/*****************************************************************************/
+{
+	/* Marks the objects near the visible part of the map in iVisible[][], so
+	 * that ShowFrontTiles() can skip the others. The sprites are drawn around
+	 * their coordinates, hence the margin of 3 cells.
+	 */
+
+	int iFromX, iFromY, iToX, iToY;
+	int iCell;
+	int iEntry;
+
+	/*** Used for looping. ***/
+	int iCX, iCY;
+
+	iVisibleStamp++;
+	iCell = IndexCell ((MAP_LEFT - iMapStartX) / iZoom,
+		(MAP_TOP - iMapStartY) / iZoom);
+	iFromX = (iCell % (MAX_WIDTH + 2)) - 3;
+	iFromY = (iCell / (MAX_WIDTH + 2)) - 3;
+	iCell = IndexCell ((MAP_LEFT + MAP_WIDTH - iMapStartX) / iZoom,
+		(MAP_TOP + MAP_HEIGHT - iMapStartY) / iZoom);
+	iToX = (iCell % (MAX_WIDTH + 2)) + 3;
+	iToY = (iCell / (MAX_WIDTH + 2)) + 3;
+	if (iFromX < 0) { iFromX = 0; }
+	if (iFromY < 0) { iFromY = 0; }
+	if (iToX > (int)ulWidth + 1) { iToX = (int)ulWidth + 1; }
+	if (iToY > (int)ulHeight + 1) { iToY = (int)ulHeight + 1; }
+
+	for (iCY = iFromY; iCY <= iToY; iCY++)
+	{
+		for (iCX = iFromX; iCX <= iToX; iCX++)
+		{
+			iEntry = iIndexHead[(iCY * (MAX_WIDTH + 2)) + iCX];
+			while (iEntry != -1)
+			{
+				iVisible[indexed[iEntry].iKind][indexed[iEntry].iSlot] =
+					iVisibleStamp;
+				iEntry = indexed[iEntry].iNext;
+			}
+		}
+	}
+}
+/*****************************************************************************/
+void EntClear (int iKind)
+/*****************************************************************************/
+{
+	/*** Used for looping. ***/
+	int iLoop;
+
+	ent[iKind].ulNr = 0;
+	ent[iKind].iFirst = -1;
+	ent[iKind].iLast = -1;
+	for (iLoop = 0; iLoop < MAX_PER_KIND; iLoop++)
+		{ ent[iKind].arEnt[iLoop].iNext = iLoop + 1; }
+	ent[iKind].arEnt[MAX_PER_KIND - 1].iNext = -1;
+	ent[iKind].iFree = 0;
+	ent[iKind].ulNextOrder = 0;
+}
+/*****************************************************************************/
+int EntAdd (int iKind)
+/*****************************************************************************/
+{
+	/* Appends an object of kind iKind, with all fields 0. Returns its slot,
+	 * or -1 if there is no room.
+	 */
+
+	int iSlot;
+	struct entity *stEnt;
+
+	iSlot = ent[iKind].iFree;
+	if (iSlot == -1)
+	{
+		snprintf (sWarning, MAX_WARNING, "Cannot add: max. %i %s per level.",
+			MAX_PER_KIND, kind[iKind].sPlural);
+		Warning();
+		return (-1);
+	}
+	stEnt = &ent[iKind].arEnt[iSlot];
+	ent[iKind].iFree = stEnt->iNext;
+
+	memset (stEnt, 0, sizeof (struct entity));
+	stEnt->ulOrder = ent[iKind].ulNextOrder++;
+	stEnt->iPrev = ent[iKind].iLast;
+	stEnt->iNext = -1;
+	if (ent[iKind].iLast != -1)
+		{ ent[iKind].arEnt[ent[iKind].iLast].iNext = iSlot; }
+			else { ent[iKind].iFirst = iSlot; }
+	ent[iKind].iLast = iSlot;
+	ent[iKind].ulNr++;
+
+	return (iSlot);
+}
+/*****************************************************************************/
+void EntDel (int iKind, int iSlot)
+/*****************************************************************************/
+{
+	struct entity *stEnt;
+
+	stEnt = &ent[iKind].arEnt[iSlot];
+	if (stEnt->iPrev != -1)
+		{ ent[iKind].arEnt[stEnt->iPrev].iNext = stEnt->iNext; }
+			else { ent[iKind].iFirst = stEnt->iNext; }
+	if (stEnt->iNext != -1)
+		{ ent[iKind].arEnt[stEnt->iNext].iPrev = stEnt->iPrev; }
+			else { ent[iKind].iLast = stEnt->iPrev; }
+	stEnt->iNext = ent[iKind].iFree;
+	ent[iKind].iFree = iSlot;
+	ent[iKind].ulNr--;
+}
+/*****************************************************************************/
+unsigned long *EntField (struct entity *stEnt, int iField)
+/*****************************************************************************/
+{
+	switch (iField)
+	{
+		case FIELD_X: return (&stEnt->ulX);
+		case FIELD_Y: return (&stEnt->ulY);
+		default: return (&stEnt->ulField[iField]);
+	}
+}
+/*****************************************************************************/
+void LoadKind (int iFd, int iKind, unsigned char *sData)
+/*****************************************************************************/
+{
+	int iNr;
+	int iSlot;
+
+	/*** Used for looping. ***/
+	int iLoop;
+	int iField;
+
+	EntClear (iKind);
+	iNr = ReadFromFile (iFd, "", 2, sData);
+	if (iNr > MAX_PER_KIND)
+	{
+		snprintf (sError, MAX_ERROR, "Too many %s: %i (max. %i)!",
+			kind[iKind].sPlural, iNr, MAX_PER_KIND);
+		ErrorAndExit();
+	}
+	for (iLoop = 1; iLoop <= iNr; iLoop++)
+	{
+		iSlot = EntAdd (iKind);
+		for (iField = 0; iField < kind[iKind].iFields; iField++)
+		{
+			*EntField (&ent[iKind].arEnt[iSlot], kind[iKind].iField[iField]) =
+				ReadFromFile (iFd, "", kind[iKind].iBytes[iField], sData);
+		}
+	}
+}
+/*****************************************************************************/
+void SaveKind (unsigned char *sBytes, long *lLength, int iKind)
+/*****************************************************************************/
+{
+	int iSlot;
+
+	/*** Used for looping. ***/
+	int iField;
+
+	PutWord (sBytes, lLength, ent[iKind].ulNr);
+	for (iSlot = ent[iKind].iFirst; iSlot != -1;
+		iSlot = ent[iKind].arEnt[iSlot].iNext)
+	{
+		for (iField = 0; iField < kind[iKind].iFields; iField++)
+		{
+			switch (kind[iKind].iBytes[iField])
+			{
+				case 1:
+					PutByte (sBytes, lLength, *EntField (&ent[iKind].arEnt[iSlot],
+						kind[iKind].iField[iField]));
+					break;
+				case 2:
+					PutWord (sBytes, lLength, *EntField (&ent[iKind].arEnt[iSlot],
+						kind[iKind].iField[iField]));
+					break;
+			}
+		}
+	}
+}
+/*****************************************************************************/
+void DumpKind (int iKind)
+/*****************************************************************************/
+{
+	int iSlot;
+	struct entity *stEnt;
+	unsigned long ulTypeNr;
+
+	/*** Used for looping. ***/
+	int iField;
+
+	printf ("[ INFO ] # %s: %lu\n", kind[iKind].sHeader, ent[iKind].ulNr);
+	for (iSlot = ent[iKind].iFirst; iSlot != -1; iSlot = stEnt->iNext)
+	{
+		stEnt = &ent[iKind].arEnt[iSlot];
+		printf ("(");
+		if (iKind == KIND_FRONT)
+		{
+			ulTypeNr = stEnt->ulField[FIELD_FRONT_CODE];
+			switch (ulTypeNr)
+			{
+				case 0x30: printf ("Torch"); break;
+				case 0x31: printf ("Pillar Front"); break;
+				case 0x32: printf ("Skeleton"); break;
+				case 0x33: printf ("Wall Top Left Slash"); break;
+				case 0x34: printf ("Wall Top Left Dot"); break;
+				case 0x35: printf ("Wall Bottom Left"); break;
+				case 0x36: printf ("Floor Climbable"); break;
+				default:
+					printf ("%lu (0x%02X)", /*** No WARN or \n. ***/
+						ulTypeNr, (int)ulTypeNr);
+					break;
+			}
+		} else {
+			printf ("%s", kind[iKind].sItem);
+		}
+		printf (")");
+		for (iField = 0; iField < kind[iKind].iFields; iField++)
+		{
+			printf ("%s %s: %lu", (iField == 0) ? "" : ",",
+				kind[iKind].sField[iField],
+				*EntField (stEnt, kind[iKind].iField[iField]));
+		}
+		printf ("\n");
+	}
+}
+/*****************************************************************************/
+void ShowEntity (int iKind, int iSlot)
+/*****************************************************************************/
+{
+	/* Shows one object on the map. The gates show their number (0 for the
+	 * first gate in the level), the raise show the gate they open.
+	 */
+
+	struct entity *stEnt;
+	SDL_Texture *img;
+	char sImageInfo[MAX_IMG + 2];
+	int iOffsetX, iOffsetY;
+
+	stEnt = &ent[iKind].arEnt[iSlot];
+	img = EntityImage (iKind, stEnt, sImageInfo, &iOffsetX, &iOffsetY);
+	if (strcmp (sImageInfo, "") == 0) { return; } /*** Unknown. ***/
+
+	ShowImage (img,
+		iMapStartX + (stEnt->ulX * iZoom) - (iOffsetX * iZoom),
+		iMapStartY + (stEnt->ulY * iZoom) - (iOffsetY * iZoom),
+		sImageInfo, ascreen, iZoom, 0);
+	if (iKind == KIND_GATES)
+	{
+		snprintf (arText[0], MAX_TEXT, "%i", iGateNr[iSlot]);
+		DisplayText (iMapStartX + (stEnt->ulX * iZoom) - (1 * iZoom),
+			iMapStartY + (stEnt->ulY * iZoom) - (42 * iZoom),
+			(10 * iZoom) / iScale, 1, color_wh, 0);
+	}
+	if (iKind == KIND_RAISE)
+	{
+		snprintf (arText[0], MAX_TEXT, "%lu", stEnt->ulField[FIELD_RAISE_GATE]);
+		DisplayText (iMapStartX + (stEnt->ulX * iZoom) - (4 * iZoom),
+			iMapStartY + (stEnt->ulY * iZoom) - (15 * iZoom),
+			(10 * iZoom) / iScale, 1, color_wh, 0);
+	}
+}
+/*****************************************************************************/
+SDL_Texture *EntityImage (int iKind, struct entity *stEnt, char *sImageInfo,
+	int *iOffsetX, int *iOffsetY)
+/*****************************************************************************/
+{
+	/* Picks the image of one object, and where it goes relative to the
+	 * object's X and Y. Sets sImageInfo to "" for unknown objects.
+	 */
+
+	SDL_Texture *img;
+	unsigned long ulTypeNr;
+
+	img = NULL;
+	snprintf (sImageInfo, MAX_IMG, "%s", "");
+	*iOffsetX = 0; *iOffsetY = 0;
+	switch (iKind)
+	{
+		case KIND_CHOMPERS:
+			img = imgchomper; snprintf (sImageInfo, MAX_IMG, "imgchomper");
+			*iOffsetX = 8; *iOffsetY = 46;
+			break;
+		case KIND_SPIKES:
+			switch (stEnt->ulField[FIELD_SPIKE_RIGHT])
+			{
+				case 0:
+					img = imgspikes0; snprintf (sImageInfo, MAX_IMG, "imgspikes0");
+					break;
+				case 1:
+					img = imgspikes1; snprintf (sImageInfo, MAX_IMG, "imgspikes1");
+					break;
+				default:
+					printf ("[ WARN ] Unknown spikes right: %lu!\n",
+						stEnt->ulField[FIELD_SPIKE_RIGHT]);
+					break;
+			}
+			*iOffsetX = 10; *iOffsetY = 24;
+			break;
+		case KIND_GATES:
+			img = imggate; snprintf (sImageInfo, MAX_IMG, "imggate");
+			*iOffsetX = 6; *iOffsetY = 46;
+			break;
+		case KIND_RAISE:
+			img = imgraise; snprintf (sImageInfo, MAX_IMG, "imgraise");
+			*iOffsetX = 14; *iOffsetY = 15;
+			break;
+		case KIND_GUARDS:
+			switch (stEnt->ulField[FIELD_GUARD_DIR])
+			{
+				case 0: /*** left ***/
+					img = imgguardl; snprintf (sImageInfo, MAX_IMG, "imgguardl");
+					break;
+				case 1: /*** right ***/
+					img = imgguardr; snprintf (sImageInfo, MAX_IMG, "imgguardr");
+					break;
+			}
+			*iOffsetX = 13; *iOffsetY = 27;
+			break;
+		case KIND_POTIONS:
+			switch (stEnt->ulField[FIELD_POTION_TYPE])
+			{
+				case 0: /*** life potion ***/
+					img = imgpotion0; snprintf (sImageInfo, MAX_IMG, "imgpotion0");
+					*iOffsetX = 4; *iOffsetY = 7;
+					break;
+				case 1: /*** hurt potion ***/
+					img = imgpotion1; snprintf (sImageInfo, MAX_IMG, "imgpotion1");
+					*iOffsetX = 3; *iOffsetY = 7;
+					break;
+				case 2: /*** health potion ***/
+					img = imgpotion2; snprintf (sImageInfo, MAX_IMG, "imgpotion2");
+					*iOffsetX = 3; *iOffsetY = 6;
+					break;
+				case 3: /*** save lamp animation ***/
+					img = imgpotion3; snprintf (sImageInfo, MAX_IMG, "imgpotion3");
+					*iOffsetX = 11; *iOffsetY = 12;
+					break;
+				default:
+					printf ("[ WARN ] Unknown potion: %lu\n",
+						stEnt->ulField[FIELD_POTION_TYPE]);
+					break;
+			}
+			break;
+		case KIND_LOOSE:
+			switch (stEnt->ulField[FIELD_LOOSE_RIGHT])
+			{
+				case 0:
+					img = imgloose0; snprintf (sImageInfo, MAX_IMG, "imgloose0");
+					*iOffsetX = 13;
+					break;
+				case 1:
+					img = imgloose1; snprintf (sImageInfo, MAX_IMG, "imgloose1");
+					*iOffsetX = 15;
+					break;
+				default:
+					printf ("[ WARN ] Unknown loose: %lu\n",
+						stEnt->ulField[FIELD_LOOSE_RIGHT]);
+					break;
+			}
+			*iOffsetY = 20;
+			break;
+		case KIND_FRONT:
+			ulTypeNr = stEnt->ulField[FIELD_FRONT_CODE];
+			switch (ulTypeNr)
+			{
+				case 0x30: /*** torch ***/
+					img = imgtorchsprite;
+					snprintf (sImageInfo, MAX_IMG, "imgtorchsprite");
+					*iOffsetX = 17; *iOffsetY = 28;
+					break;
+				case 0x31: /*** pillar front ***/
+					img = imgpillarfront;
+					snprintf (sImageInfo, MAX_IMG, "imgpillarfront");
+					*iOffsetX = 1; *iOffsetY = 45;
+					break;
+				case 0x32: /*** skeleton ***/
+					img = imgskeleton;
+					snprintf (sImageInfo, MAX_IMG, "imgskeleton");
+					*iOffsetX = 9; *iOffsetY = 8;
+					break;
+				case 0x33: /*** wall top left slash ***/
+					img = imgwalltopleftslash;
+					snprintf (sImageInfo, MAX_IMG, "imgwalltopleftslash");
+					*iOffsetX = 9; *iOffsetY = 24;
+					break;
+				case 0x34: /*** wall top left dot ***/
+					img = imgwalltopleftdot;
+					snprintf (sImageInfo, MAX_IMG, "imgwalltopleftdot");
+					*iOffsetX = 9; *iOffsetY = 24;
+					break;
+				case 0x35: /*** wall bottom left ***/
+					img = imgwallbottomleft;
+					snprintf (sImageInfo, MAX_IMG, "imgwallbottomleft");
+					*iOffsetX = 9; *iOffsetY = 24;
+					break;
+				case 0x36: /*** floor climbable ***/
+					img = imgfloorclimbable;
+					snprintf (sImageInfo, MAX_IMG, "imgfloorclimbable");
+					*iOffsetX = 3; *iOffsetY = 12;
+					break;
+				default:
+					printf ("[ WARN ] Unknown front: %lu (0x%02X)\n",
+						ulTypeNr, (int)ulTypeNr);
+					break;
+			}
+			break;
+	}
+
+	return (img);
+}
+/*****************************************************************************/
+void FrontResolve (struct entity *stEnt)
+/*****************************************************************************/
+{
+	/* Caches the code (0x30 = torch, etc.) of the front type of stEnt, so
+	 * that drawing does not have to look it up.
+	 */
+
+	if (stEnt->ulField[FIELD_FRONT_TYPE] < ulFrontTypes)
+	{
+		stEnt->ulField[FIELD_FRONT_CODE] =
+			ulFrontTypeNr[stEnt->ulField[FIELD_FRONT_TYPE] + 1];
+	} else {
+		stEnt->ulField[FIELD_FRONT_CODE] = 0x00; /*** unknown ***/
+	}
+}
+/*****************************************************************************/
+void LatestMotion (SDL_Event *event)
+/*****************************************************************************/
+{
+	/* Merges mouse motion events that are queued directly after event, so
+	 * that only the latest position gets handled. Stops at the first other
+	 * event, to keep clicks at the position where they happened.
+	 */
+
+	SDL_Event next;
+
+	while (SDL_PeepEvents (&next, 1, SDL_PEEKEVENT,
+		SDL_FIRSTEVENT, SDL_LASTEVENT) == 1)
+	{
+		if (next.type != SDL_MOUSEMOTION) { break; }
+		SDL_PeepEvents (&next, 1, SDL_GETEVENT,
+			SDL_MOUSEMOTION, SDL_MOUSEMOTION);
+		*event = next;
+	}
+}
+/*****************************************************************************/
+void UndoClear (void)
+/*****************************************************************************/
+{
+	iStepFirst = 0;
+	iSteps = 0;
+	iStepsDone = 0;
+	ulDeltaUsed = 0;
+	ulDeltaNext = 0;
+	ulSavedUsed = 0;
+	ulSavedNext = 0;
+	UndoFreeAreas (ulAreaUsed, ulAreaNext);
+	ulAreaUsed = 0;
+	ulAreaNext = 0;
+	ulStepStart = 0;
+	iStepOverflow = 0;
+}
+/*****************************************************************************/
+void UndoBegin (void)
+/*****************************************************************************/
+{
+	/* Starts an undo step; all changes until the matching UndoEnd() are
+	 * undone together. Calls may be nested.
+	 */
+
+	int iLast;
+
+	if (iRecording == 0)
+	{
+		/*** A new step makes the redo steps unreachable. ***/
+		iSteps = iStepsDone;
+		if (iSteps == 0)
+		{
+			ulDeltaNext = ulDeltaUsed;
+			ulSavedNext = ulSavedUsed;
+			UndoFreeAreas (ulAreaUsed, ulAreaNext);
+			ulAreaNext = ulAreaUsed;
+		} else {
+			iLast = (iStepFirst + iSteps - 1) % MAX_UNDO;
+			ulDeltaNext = step[iLast].ulFirst + step[iLast].ulCount;
+			ulSavedNext = step[iLast].ulSavedEnd;
+			UndoFreeAreas (step[iLast].ulAreaEnd, ulAreaNext);
+			ulAreaNext = step[iLast].ulAreaEnd;
+		}
+		ulStepStart = ulDeltaNext;
+		iStepOverflow = 0;
+	}
+	iRecording++;
+}
+/*****************************************************************************/
+void UndoEnd (void)
+/*****************************************************************************/
+{
+	int iNew;
+
+	iRecording--;
+	if (iRecording != 0) { return; }
+
+	if (iStepOverflow == 1)
+	{
+		UndoClear();
+		snprintf (sWarning, MAX_WARNING, "%s",
+			"Too many changes at once to undo; cleared the undo history.");
+		Warning();
+		return;
+	}
+	if (ulDeltaNext == ulStepStart) { return; } /*** Nothing changed. ***/
+
+	if (iSteps == iUndoMax) { UndoDropOldest(); }
+	iNew = (iStepFirst + iSteps) % MAX_UNDO;
+	step[iNew].ulFirst = ulStepStart;
+	step[iNew].ulCount = ulDeltaNext - ulStepStart;
+	step[iNew].ulSavedEnd = ulSavedNext;
+	step[iNew].ulAreaEnd = ulAreaNext;
+	iSteps++;
+	iStepsDone++;
+}
+/*****************************************************************************/
+void UndoDropOldest (void)
+/*****************************************************************************/
+{
+	ulDeltaUsed = step[iStepFirst].ulFirst + step[iStepFirst].ulCount;
+	ulSavedUsed = step[iStepFirst].ulSavedEnd;
+	UndoFreeAreas (ulAreaUsed, step[iStepFirst].ulAreaEnd);
+	ulAreaUsed = step[iStepFirst].ulAreaEnd;
+	iStepFirst = (iStepFirst + 1) % MAX_UNDO;
+	iSteps--;
+	iStepsDone--;
+}
+/*****************************************************************************/
+struct delta *UndoRecord (int iType, int iA, int iB, int iC,
+	unsigned long ulOld, unsigned long ulNew)
+/*****************************************************************************/
+{
+	/* Adds a delta to the current step, or makes it a step of its own if
+	 * there is no UndoBegin(). Returns NULL if the delta was not kept.
+	 * DELTA_ENTITY also gets a saved[] object (iC), and DELTA_AREA an
+	 * area[] (iA); the caller fills these in.
+	 */
+
+	struct delta *stDelta;
+
+	if ((iReplaying == 1) || (iUndoMax == 0)) { return (NULL); }
+	if (iRecording == 0)
+	{
+		UndoBegin();
+		stDelta = UndoRecord (iType, iA, iB, iC, ulOld, ulNew);
+		UndoEnd();
+		return (stDelta);
+	}
+	if (iStepOverflow == 1) { return (NULL); }
+	if (UndoRoom (iType) == 0) { iStepOverflow = 1; return (NULL); }
+
+	stDelta = &delta[ulDeltaNext % MAX_DELTAS];
+	ulDeltaNext++;
+	stDelta->iType = iType;
+	stDelta->iA = iA;
+	stDelta->iB = iB;
+	stDelta->iC = iC;
+	stDelta->ulOld = ulOld;
+	stDelta->ulNew = ulNew;
+	if (iType == DELTA_ENTITY)
+	{
+		stDelta->iC = ulSavedNext % MAX_SAVED;
+		ulSavedNext++;
+	}
+	if (iType == DELTA_AREA)
+	{
+		stDelta->iA = ulAreaNext % MAX_AREAS;
+		ulAreaNext++;
+	}
+
+	return (stDelta);
+}
+/*****************************************************************************/
+void UndoEntity (int iKind, int iSlot, int iAdded)
+/*****************************************************************************/
+{
+	/* Call after an object was added (iAdded 1), or before it is removed
+	 * (iAdded 0).
+	 */
+
+	struct delta *stDelta;
+
+	JournalAdd (DELTA_ENTITY, iKind, iSlot, 0, iAdded,
+		&ent[iKind].arEnt[iSlot]);
+	if (iAdded == 1)
+	{
+		stDelta = UndoRecord (DELTA_ENTITY, iKind, iSlot, 0, 0, 1);
+	} else {
+		stDelta = UndoRecord (DELTA_ENTITY, iKind, iSlot, 0, 1, 0);
+	}
+	if (stDelta != NULL)
+	{
+		memcpy (&saved[stDelta->iC], &ent[iKind].arEnt[iSlot],
+			sizeof (struct entity));
+	}
+}
+/*****************************************************************************/
+void UndoFreeAreas (unsigned long ulFrom, unsigned long ulTo)
+/*****************************************************************************/
+{
+	/*** Frees the tiles of area[] counters ulFrom up to ulTo. ***/
+
+	struct area *stArea;
+
+	/*** Used for looping. ***/
+	unsigned long ulLoop;
+
+	for (ulLoop = ulFrom; ulLoop != ulTo; ulLoop++)
+	{
+		stArea = &area[ulLoop % MAX_AREAS];
+		free (stArea->sOld);
+		free (stArea->sNew);
+		stArea->sOld = NULL;
+		stArea->sNew = NULL;
+	}
+}
+/*****************************************************************************/
+int UndoRoom (int iType)
+/*****************************************************************************/
+{
+	/* Makes room for a delta of type iType by forgetting the oldest steps.
+	 * Returns 0 if even the current step alone does not fit.
+	 */
+
+	while ((ulDeltaNext - ulDeltaUsed == MAX_DELTAS) ||
+		((iType == DELTA_ENTITY) && (ulSavedNext - ulSavedUsed == MAX_SAVED)) ||
+		((iType == DELTA_AREA) && (ulAreaNext - ulAreaUsed == MAX_AREAS)))
+	{
+		if (iSteps == 0) { return (0); }
+		UndoDropOldest();
+	}
+
+	return (1);
+}
+/*****************************************************************************/
+void UndoAreaBegin (void)
+/*****************************************************************************/
+{
+	/* Call after UndoBegin(), before changing many back tiles at once.
+	 * Until UndoAreaEnd(), SetBack() records no deltas. Instead, it keeps
+	 * the old tiles of each row that it changes, and grows the rectangle
+	 * that changed. That rectangle becomes one delta, so a step never
+	 * needs more deltas than the ring has. The reach masks are also redone
+	 * once, at the end, for the rows of the rectangle only.
+	 */
+
+	if ((iRecording == 0) || (iReplaying == 1) || (iUndoMax == 0)) { return; }
+	iAreaOpen = 1;
+	iAreaTop = ulHeight + 1; iAreaLeft = ulWidth + 1;
+	iAreaBottom = 0; iAreaRight = 0;
+}
+/*****************************************************************************/
+void UndoAreaTile (int iRow, int iColumn, unsigned long ulOld)
+/*****************************************************************************/
+{
+	/*** Call after back tile (iRow, iColumn) changed from ulOld. ***/
+
+	/*** Used for looping. ***/
+	int iColumnLoop;
+
+	if (sAreaRow[iRow] == NULL)
+	{
+		sAreaRow[iRow] = (unsigned char *)malloc (ulWidth);
+		if (sAreaRow[iRow] == NULL) { iStepOverflow = 1; return; }
+		for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
+			{ sAreaRow[iRow][iColumnLoop - 1] = ulBack[iRow][iColumnLoop]; }
+		sAreaRow[iRow][iColumn - 1] = ulOld;
+	}
+	if (iRow < iAreaTop) { iAreaTop = iRow; }
+	if (iRow > iAreaBottom) { iAreaBottom = iRow; }
+	if (iColumn < iAreaLeft) { iAreaLeft = iColumn; }
+	if (iColumn > iAreaRight) { iAreaRight = iColumn; }
+}
+/*****************************************************************************/
+void UndoAreaEnd (void)
+/*****************************************************************************/
+{
+	struct delta *stDelta;
+	struct area *stArea;
+	int iTile;
+
+	/*** Used for looping. ***/
+	int iRowLoop, iColumnLoop;
+
+	if (iAreaOpen == 0) { return; }
+	iAreaOpen = 0;
+	if (iAreaBottom == 0) { return; }
+
+	stArea = NULL;
+	stDelta = UndoRecord (DELTA_AREA, 0, 0, 0, 0, 1);
+	if (stDelta != NULL)
+	{
+		stArea = &area[stDelta->iA];
+		stArea->iRow = iAreaTop;
+		stArea->iColumn = iAreaLeft;
+		stArea->iRows = iAreaBottom - iAreaTop + 1;
+		stArea->iColumns = iAreaRight - iAreaLeft + 1;
+		stArea->sOld = (unsigned char *)malloc
+			(stArea->iRows * stArea->iColumns);
+		stArea->sNew = (unsigned char *)malloc
+			(stArea->iRows * stArea->iColumns);
+		if ((stArea->sOld == NULL) || (stArea->sNew == NULL))
+			{ iStepOverflow = 1; stArea = NULL; }
+	}
+	iTile = 0;
+	for (iRowLoop = iAreaTop; iRowLoop <= iAreaBottom; iRowLoop++)
+	{
+		for (iColumnLoop = iAreaLeft; (stArea != NULL) &&
+			(iColumnLoop <= iAreaRight); iColumnLoop++)
+		{
+			/*** A row without old tiles did not change. ***/
+			if (sAreaRow[iRowLoop] != NULL)
+			{
+				stArea->sOld[iTile] = sAreaRow[iRowLoop][iColumnLoop - 1];
+			} else {
+				stArea->sOld[iTile] = ulBack[iRowLoop][iColumnLoop];
+			}
+			stArea->sNew[iTile] = ulBack[iRowLoop][iColumnLoop];
+			iTile++;
+		}
+		free (sAreaRow[iRowLoop]);
+		sAreaRow[iRowLoop] = NULL;
+	}
+	ReachRows (iAreaTop - 1, iAreaBottom);
+}
+/*****************************************************************************/
+void UndoApply (int iStep, int iRedo)
+/*****************************************************************************/
+{
+	/* Undoes (iRedo 0) step iStep in reverse, or redoes it (iRedo 1). */
+
+	struct delta *stDelta;
+	struct entity *stEnt;
+	unsigned long ulValue;
+	int iEXEChanged;
+
+	/*** Used for looping. ***/
+	unsigned long ulLoop;
+
+	iEXEChanged = 0;
+	iReplaying = 1;
+	for (ulLoop = 0; ulLoop < step[iStep].ulCount; ulLoop++)
+	{
+		if (iRedo == 1)
+		{
+			stDelta = &delta[(step[iStep].ulFirst + ulLoop) % MAX_DELTAS];
+			ulValue = stDelta->ulNew;
+		} else {
+			stDelta = &delta[(step[iStep].ulFirst + step[iStep].ulCount - 1 -
+				ulLoop) % MAX_DELTAS];
+			ulValue = stDelta->ulOld;
+		}
+		if (stDelta->iType == DELTA_ENTITY)
+			{ stEnt = &saved[stDelta->iC]; } else { stEnt = NULL; }
+		DeltaApply (stDelta, ulValue, stEnt);
+		if (stDelta->iType == DELTA_EXE)
+		{
+			iEXEChanged = 1;
+		} else if (stDelta->iType != DELTA_AREA) {
+			/*** AreaApply() adds its tiles itself. ***/
+			JournalAdd (stDelta->iType, stDelta->iA, stDelta->iB, stDelta->iC,
+				ulValue, stEnt);
+		}
+	}
+	iReplaying = 0;
+
+	/*** The executable settings are not part of the level. ***/
+	if (iEXEChanged == 1) { EXESave(); } else { PlaySound ("wav/hum_adj.wav"); }
+
+	/*** A pending removal may point to a different object now. ***/
+	iDelX = -1;
+	iDelY = -1;
+	iChanged++;
+}
+/*****************************************************************************/
+void Undo (void)
+/*****************************************************************************/
+{
+	if (iStepsDone == 0) { return; }
+	iStepsDone--;
+	UndoApply ((iStepFirst + iStepsDone) % MAX_UNDO, 0);
+}
+/*****************************************************************************/
+void Redo (void)
+/*****************************************************************************/
+{
+	if (iStepsDone == iSteps) { return; }
+	UndoApply ((iStepFirst + iStepsDone) % MAX_UNDO, 1);
+	iStepsDone++;
+}
+/*****************************************************************************/
+void SetBack (int iRow, int iColumn, unsigned long ulTile)
+/*****************************************************************************/
+{
+	/* Changes a back tile and records it. A run of neighbouring tiles in a
+	 * row that change from and to the same values becomes a single delta.
+	 */
+
+	unsigned long ulOld;
+	struct delta *stDelta;
+
+	ulOld = ulBack[iRow][iColumn];
+	if (ulOld == ulTile) { return; }
+	ulBack[iRow][iColumn] = ulTile;
+	FindMove (iRow, iColumn, ulOld, ulTile);
+	if (iAreaOpen == 0) { ReachTile (iRow, iColumn, ulOld, ulTile); }
+	MiniTile (iRow, iColumn, ulOld, ulTile);
+	thumb[iCurLevel].iFresh = 0;
+	JournalAdd (DELTA_BACK, iRow, iColumn, 1, ulTile, NULL);
+	if (iAreaOpen == 1) { UndoAreaTile (iRow, iColumn, ulOld); return; }
+
+	if ((iRecording != 0) && (iReplaying == 0) && (iStepOverflow == 0) &&
+		(ulDeltaNext != ulStepStart))
+	{
+		stDelta = &delta[(ulDeltaNext - 1) % MAX_DELTAS];
+		if ((stDelta->iType == DELTA_BACK) && (stDelta->iA == iRow) &&
+			(stDelta->iB + stDelta->iC == iColumn) &&
+			(stDelta->ulOld == ulOld) && (stDelta->ulNew == ulTile))
+		{
+			stDelta->iC++;
+			return;
+		}
+	}
+	UndoRecord (DELTA_BACK, iRow, iColumn, 1, ulOld, ulTile);
+}
+/*****************************************************************************/
+unsigned long *LevelValue (int iValue)
+/*****************************************************************************/
+{
+	switch (iValue)
+	{
+		case VALUE_PRINCE_X: return (&ulPrinceX);
+		case VALUE_PRINCE_Y: return (&ulPrinceY);
+		case VALUE_EXIT_TRIGGER_X: return (&ulExitTriggerX);
+		case VALUE_EXIT_TRIGGER_Y: return (&ulExitTriggerY);
+		case VALUE_SAVE_TRIGGER_X: return (&ulSaveTriggerX);
+		case VALUE_SAVE_TRIGGER_Y: return (&ulSaveTriggerY);
+		case VALUE_ENTRANCE_IMAGE_X: return (&ulEntranceImageX);
+		case VALUE_ENTRANCE_IMAGE_Y: return (&ulEntranceImageY);
+		case VALUE_EXIT_IMAGE_X: return (&ulExitImageX);
+		default: return (&ulExitImageY);
+	}
+}
+/*****************************************************************************/
+void SetValue (int iValue, unsigned long ulValue)
+/*****************************************************************************/
+{
+	unsigned long ulOld;
+
+	ulOld = *LevelValue (iValue);
+	if (ulOld == ulValue) { return; }
+	*LevelValue (iValue) = ulValue;
+	iReachDirty = 1;
+	JournalAdd (DELTA_VALUE, iValue, 0, 0, ulValue, NULL);
+	UndoRecord (DELTA_VALUE, iValue, 0, 0, ulOld, ulValue);
+}
+/*****************************************************************************/
+void SetTextChar (int iTextLine, int iPos, char cChar)
+/*****************************************************************************/
+{
+	char cOld;
+
+	cOld = arTextLine[iTextLine][iPos];
+	if (cOld == cChar) { return; }
+	arTextLine[iTextLine][iPos] = cChar;
+	JournalAdd (DELTA_TEXT, iTextLine, iPos, 0, (unsigned char)cChar, NULL);
+	UndoRecord (DELTA_TEXT, iTextLine, iPos, 0,
+		(unsigned char)cOld, (unsigned char)cChar);
+}
+/*****************************************************************************/
+int *EXEValue (int iValue)
+/*****************************************************************************/
+{
+	switch (iValue)
+	{
+		case EXE_MENU_SELECTION: return (&iEXEMenuInitialSelection);
+		case EXE_FONT_EMPHASIS: return (&iEXECutscenesFontEmphasis);
+		default: return (&iEXECutscenesTextLines);
+	}
+}
+/*****************************************************************************/
+void EntRestore (int iKind, int iSlot, struct entity *stFrom)
+/*****************************************************************************/
+{
+	/* Puts a copy of stFrom in the unused slot iSlot, at its old place in
+	 * file order. Since EntAdd() only appends, the objects are sorted on
+	 * ulOrder. Objects are usually restored near the end, so search back.
+	 */
+
+	struct entity *stEnt;
+	int iFree, iPrevFree;
+	int iAt, iNext;
+
+	/*** Take iSlot from the free list. ***/
+	iPrevFree = -1;
+	iFree = ent[iKind].iFree;
+	while ((iFree != -1) && (iFree != iSlot))
+	{
+		iPrevFree = iFree;
+		iFree = ent[iKind].arEnt[iFree].iNext;
+	}
+	if (iFree == -1)
+	{
+		printf ("[ WARN ] Slot %i of the %s is in use!\n",
+			iSlot, kind[iKind].sPlural);
+		return;
+	}
+	stEnt = &ent[iKind].arEnt[iSlot];
+	if (iPrevFree == -1)
+		{ ent[iKind].iFree = stEnt->iNext; }
+			else { ent[iKind].arEnt[iPrevFree].iNext = stEnt->iNext; }
+
+	/*** Find the objects that go before and after it. ***/
+	iNext = -1;
+	iAt = ent[iKind].iLast;
+	while ((iAt != -1) && (ent[iKind].arEnt[iAt].ulOrder > stFrom->ulOrder))
+	{
+		iNext = iAt;
+		iAt = ent[iKind].arEnt[iAt].iPrev;
+	}
+
+	memcpy (stEnt, stFrom, sizeof (struct entity));
+	stEnt->iPrev = iAt;
+	stEnt->iNext = iNext;
+	if (iAt != -1)
+		{ ent[iKind].arEnt[iAt].iNext = iSlot; }
+			else { ent[iKind].iFirst = iSlot; }
+	if (iNext != -1)
+		{ ent[iKind].arEnt[iNext].iPrev = iSlot; }
+			else { ent[iKind].iLast = iSlot; }
+	ent[iKind].ulNr++;
+	if (stFrom->ulOrder >= ent[iKind].ulNextOrder)
+		{ ent[iKind].ulNextOrder = stFrom->ulOrder + 1; }
+}
+/*****************************************************************************/
+void DeltaApply (struct delta *stDelta, unsigned long ulValue,
+	struct entity *stEnt)
+/*****************************************************************************/
+{
+	/* Sets what stDelta changed to ulValue; its ulOld or ulNew. For
+	 * DELTA_ENTITY, stEnt is the object.
+	 */
+
+	unsigned long ulOld;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	switch (stDelta->iType)
+	{
+		case DELTA_BACK:
+			for (iLoop = 0; iLoop < stDelta->iC; iLoop++)
+			{
+				ulOld = ulBack[stDelta->iA][stDelta->iB + iLoop];
+				ulBack[stDelta->iA][stDelta->iB + iLoop] = ulValue;
+				FindMove (stDelta->iA, stDelta->iB + iLoop, ulOld, ulValue);
+				ReachTile (stDelta->iA, stDelta->iB + iLoop, ulOld, ulValue);
+				MiniTile (stDelta->iA, stDelta->iB + iLoop, ulOld, ulValue);
+			}
+			thumb[iCurLevel].iFresh = 0;
+			break;
+		case DELTA_VALUE:
+			*LevelValue (stDelta->iA) = ulValue;
+			iReachDirty = 1;
+			break;
+		case DELTA_ENTITY:
+			if (ulValue == 1)
+			{
+				EntRestore (stDelta->iA, stDelta->iB, stEnt);
+				IndexAdd (stDelta->iA, stDelta->iB);
+				LinkAdd (stDelta->iA, stDelta->iB);
+			} else {
+				IndexDel (stDelta->iA, stDelta->iB);
+				LinkDel (stDelta->iA, stDelta->iB);
+				EntDel (stDelta->iA, stDelta->iB);
+			}
+			break;
+		case DELTA_FRONT_TYPE:
+			if (ulValue > ulFrontTypes)
+			{
+				ulFrontTypes++;
+				ulFrontTypeA[ulFrontTypes] = 0x01;
+				ulFrontTypeB[ulFrontTypes] = 0x00;
+				ulFrontTypeNr[ulFrontTypes] = stDelta->iA;
+				iFrontTypeOf[stDelta->iA] = ulFrontTypes - 1;
+			} else {
+				iFrontTypeOf[stDelta->iA] = -1;
+				ulFrontTypes--;
+			}
+			break;
+		case DELTA_TEXT:
+			arTextLine[stDelta->iA][stDelta->iB] = (char)ulValue;
+			break;
+		case DELTA_EXE:
+			*EXEValue (stDelta->iA) = ulValue;
+			break;
+		case DELTA_AREA:
+			AreaApply (&area[stDelta->iA], ulValue);
+			break;
+	}
+}
+/*****************************************************************************/
+void AreaApply (struct area *stArea, unsigned long ulValue)
+/*****************************************************************************/
+{
+	/*** Sets the tiles of stArea to its old (ulValue 0) or new ones. ***/
+
+	unsigned char *sTiles;
+	unsigned long ulOld, ulTile;
+	int iRow, iColumn;
+	int iChangedTiles;
+
+	/*** Used for looping. ***/
+	int iRowLoop, iColumnLoop;
+
+	if (ulValue == 1) { sTiles = stArea->sNew; } else { sTiles = stArea->sOld; }
+	iChangedTiles = 0;
+	for (iRowLoop = 0; iRowLoop < stArea->iRows; iRowLoop++)
+	{
+		for (iColumnLoop = 0; iColumnLoop < stArea->iColumns; iColumnLoop++)
+		{
+			iRow = stArea->iRow + iRowLoop;
+			iColumn = stArea->iColumn + iColumnLoop;
+			ulOld = ulBack[iRow][iColumn];
+			ulTile = sTiles[(iRowLoop * stArea->iColumns) + iColumnLoop];
+			if (ulOld == ulTile) { continue; }
+			ulBack[iRow][iColumn] = ulTile;
+			FindMove (iRow, iColumn, ulOld, ulTile);
+			MiniTile (iRow, iColumn, ulOld, ulTile);
+			JournalAdd (DELTA_BACK, iRow, iColumn, 1, ulTile, NULL);
+			iChangedTiles++;
+		}
+	}
+	if (iChangedTiles != 0)
+		{ ReachRows (stArea->iRow - 1, stArea->iRow + stArea->iRows - 1); }
+	thumb[iCurLevel].iFresh = 0;
+}
+/*****************************************************************************/
+int DeltaValid (struct delta *stDelta, unsigned long ulValue)
+/*****************************************************************************/
+{
+	/* Returns 1 if DeltaApply() can be used with these values; to check
+	 * what is read from the journal.
+	 */
+
+	int iFree;
+
+	switch (stDelta->iType)
+	{
+		case DELTA_BACK:
+			if ((stDelta->iA < 1) || (stDelta->iA > (int)ulHeight) ||
+				(stDelta->iB < 1) || (stDelta->iC < 1) ||
+				(stDelta->iB + stDelta->iC - 1 > (int)ulWidth)) { return (0); }
+			return (1);
+		case DELTA_VALUE:
+			if ((stDelta->iA < VALUE_PRINCE_X) ||
+				(stDelta->iA > VALUE_EXIT_IMAGE_Y)) { return (0); }
+			return (1);
+		case DELTA_ENTITY:
+			if ((stDelta->iA < 1) || (stDelta->iA > MAX_KINDS) ||
+				(stDelta->iB < 0) || (stDelta->iB >= MAX_PER_KIND) ||
+				(ulValue > 1)) { return (0); }
+			iFree = ent[stDelta->iA].iFree;
+			while ((iFree != -1) && (iFree != stDelta->iB))
+				{ iFree = ent[stDelta->iA].arEnt[iFree].iNext; }
+			/*** Only unused slots can be restored, and vice versa. ***/
+			if ((ulValue == 1) && (iFree == -1)) { return (0); }
+			if ((ulValue == 0) && (iFree != -1)) { return (0); }
+			return (1);
+		case DELTA_FRONT_TYPE:
+			if ((stDelta->iA < 0) || (stDelta->iA > 0xFF)) { return (0); }
+			if ((ulValue == ulFrontTypes + 1) && (ulValue <= MAX_FRONT_TYPE) &&
+				(iFrontTypeOf[stDelta->iA] == -1)) { return (1); }
+			if ((ulValue + 1 == ulFrontTypes) &&
+				((int)ulFrontTypeNr[ulFrontTypes] == stDelta->iA)) { return (1); }
+			return (0);
+		case DELTA_TEXT:
+			if ((stDelta->iA < 1) || (stDelta->iA > MAX_LINES) ||
+				(stDelta->iB < 0) || (stDelta->iB >= MAX_LINECHARS) ||
+				(ulValue > 0xFF)) { return (0); }
+			return (1);
+		default: return (0);
+	}
+}
+/*****************************************************************************/
+void JournalAdd (int iType, int iA, int iB, int iC,
+	unsigned long ulValue, struct entity *stEnt)
+/*****************************************************************************/
+{
+	/* Appends a change to the journal, as "set to ulValue". The journal is
+	 * kept in sJournal and written by JournalFlush(). Back tile runs are
+	 * merged, as in SetBack(). Executable settings are saved right away,
+	 * so those are not needed here.
+	 */
+
+	int iField;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	if (iType == DELTA_EXE) { return; }
+
+	if ((iType == DELTA_BACK) && (iJournalBack != -1) &&
+		(iJournalBackRow == iA) &&
+		(iJournalBackColumn + iJournalBackLength == iB) &&
+		(ulJournalBackTile == ulValue))
+	{
+		/*** Rewrite the run length (C) of that record. ***/
+		iJournalBackLength+=iC;
+		for (iLoop = 0; iLoop < 4; iLoop++)
+		{
+			sJournal[iJournalBack + 9 + iLoop] =
+				(iJournalBackLength >> (iLoop * 8)) & 0xFF;
+		}
+		return;
+	}
+
+	/*** A record is at most 1 + (4 * 4) + (11 * 4) bytes. ***/
+	if (iJournalLen > MAX_JOURNAL - 64) { JournalFlush (1); }
+
+	if (iType == DELTA_BACK)
+	{
+		iJournalBack = iJournalLen;
+		iJournalBackRow = iA;
+		iJournalBackColumn = iB;
+		iJournalBackLength = iC;
+		ulJournalBackTile = ulValue;
+	} else { iJournalBack = -1; }
+
+	sJournal[iJournalLen] = iType;
+	iJournalLen++;
+	JournalLU (iA);
+	JournalLU (iB);
+	JournalLU (iC);
+	JournalLU (ulValue);
+	if ((iType == DELTA_ENTITY) && (ulValue == 1))
+	{
+		JournalLU (stEnt->ulOrder);
+		JournalLU (stEnt->ulX);
+		JournalLU (stEnt->ulY);
+		for (iField = 0; iField < MAX_FIELDS; iField++)
+			{ JournalLU (stEnt->ulField[iField]); }
+	}
+}
+/*****************************************************************************/
+void JournalLU (unsigned long ulValue)
+/*****************************************************************************/
+{
+	sJournal[iJournalLen] = (ulValue >> 0) & 0xFF;
+	sJournal[iJournalLen + 1] = (ulValue >> 8) & 0xFF;
+	sJournal[iJournalLen + 2] = (ulValue >> 16) & 0xFF;
+	sJournal[iJournalLen + 3] = (ulValue >> 24) & 0xFF;
+	iJournalLen+=4;
+}
+/*****************************************************************************/
+void JournalFlush (int iForce)
+/*****************************************************************************/
+{
+	/* Writes the buffered journal records. Unless iForce is 1, this
+	 * happens at most once per JOURNAL_FLUSH ms.
+	 */
+
+	unsigned char sHeader[12 + 2];
+	unsigned long ulHash;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	if (iJournalLen == 0) { return; }
+	if ((iForce == 0) &&
+		((SDL_GetTicks() - ulJournalFlushed) < JOURNAL_FLUSH)) { return; }
+
+	if (iJournalFd == -1)
+	{
+		iJournalFd = open (JOURNAL, O_WRONLY|O_TRUNC|O_CREAT|O_BINARY, 0600);
+		if (iJournalFd == -1)
+		{
+			printf ("[ WARN ] Could not create \"%s\": %s!\n",
+				JOURNAL, strerror (errno));
+			iJournalLen = 0;
+			iJournalBack = -1;
+			return;
+		}
+		/*** Magic, level, and the level file it was made for. ***/
+		ulHash = LevelHash (iCurLevel);
+		memcpy (sHeader, JOURNAL_MAGIC, 4);
+		for (iLoop = 0; iLoop < 4; iLoop++)
+		{
+			sHeader[4 + iLoop] = (iCurLevel >> (iLoop * 8)) & 0xFF;
+			sHeader[8 + iLoop] = (ulHash >> (iLoop * 8)) & 0xFF;
+		}
+		if (write (iJournalFd, sHeader, 12) == -1)
+		{
+			printf ("[ WARN ] Could not write \"%s\": %s!\n",
+				JOURNAL, strerror (errno));
+		}
+	}
+
+	if (write (iJournalFd, sJournal, iJournalLen) == -1)
+	{
+		printf ("[ WARN ] Could not write \"%s\": %s!\n",
+			JOURNAL, strerror (errno));
+	}
+	iJournalLen = 0;
+	iJournalBack = -1;
+	ulJournalFlushed = SDL_GetTicks();
+}
+/*****************************************************************************/
+void JournalClear (void)
+/*****************************************************************************/
+{
+	/*** Call when there are no unsaved changes (left). ***/
+
+	iJournalLen = 0;
+	iJournalBack = -1;
+	if (iJournalFd != -1)
+	{
+		close (iJournalFd);
+		iJournalFd = -1;
+	}
+	unlink (JOURNAL);
+}
+/*****************************************************************************/
+void JournalOffer (void)
+/*****************************************************************************/
+{
+	/* If the editor did not quit normally, the journal has the unsaved
+	 * changes. Offers to restore them, and keeps adding to the journal.
+	 */
+
+	int iFd;
+	struct stat stStatus;
+	unsigned char *sData;
+	int iLevel;
+	char sLine1[MAX_STATUS + 2];
+	char sLine2[MAX_STATUS + 2];
+	int iRestored;
+
+	iFd = open (JOURNAL, O_RDONLY|O_BINARY);
+	if (iFd == -1) { return; }
+	if ((fstat (iFd, &stStatus) == -1) || (stStatus.st_size <= 12))
+	{
+		close (iFd);
+		JournalClear();
+		return;
+	}
+	sData = malloc (stStatus.st_size);
+	if (sData == NULL)
+	{
+		close (iFd);
+		return;
+	}
+	if ((read (iFd, sData, stStatus.st_size) != stStatus.st_size) ||
+		(memcmp (sData, JOURNAL_MAGIC, 4) != 0))
+	{
+		printf ("[ WARN ] Ignoring \"%s\"; it is damaged.\n", JOURNAL);
+		free (sData);
+		close (iFd);
+		JournalClear();
+		return;
+	}
+	close (iFd);
+
+	iLevel = BytesAsLU (&sData[4], 4);
+	snprintf (sLine1, MAX_STATUS, "Found unsaved changes to level %i.", iLevel);
+	snprintf (sLine2, MAX_STATUS, "%s", "Do you want to restore these?");
+	if (PopUpYN (sLine1, sLine2) == 0)
+	{
+		free (sData);
+		JournalClear();
+		return;
+	}
+
+	if ((iLevel < 0) || (iLevel > MAX_LEVEL) ||
+		(LevelHash (iLevel) != BytesAsLU (&sData[8], 4)))
+	{
+		snprintf (sWarning, MAX_WARNING, "%s",
+			"Cannot restore; the level was changed after these changes.");
+		Warning();
+		free (sData);
+		JournalClear();
+		return;
+	}
+	if (iLevel != iCurLevel)
+	{
+		iCurLevel = iLevel;
+		LevelLoad (iLevel);
+	}
+	iRestored = JournalReplay (&sData[12], stStatus.st_size - 12);
+	free (sData);
+	if (iDebug == 1)
+		{ printf ("[ INFO ] Restored %i changes.\n", iRestored); }
+	iChanged++;
+	PlaySound ("wav/ok_close.wav");
+
+	/*** Continue the journal. ***/
+	iJournalFd = open (JOURNAL, O_WRONLY|O_APPEND|O_BINARY);
+	ShowScreen();
+}
+/*****************************************************************************/
+int JournalReplay (unsigned char *sData, long lSize)
+/*****************************************************************************/
+{
+	/* Applies the journal records in sData; returns how many. Stops at the
+	 * first record that is cut off or does not fit the level.
+	 */
+
+	struct delta stDelta;
+	struct entity stEnt;
+	unsigned long ulValue;
+	long lAt;
+	int iRecords;
+	int iField;
+
+	lAt = 0;
+	iRecords = 0;
+	while (lAt + 17 <= lSize)
+	{
+		stDelta.iType = sData[lAt];
+		stDelta.iA = BytesAsLU (&sData[lAt + 1], 4);
+		stDelta.iB = BytesAsLU (&sData[lAt + 5], 4);
+		stDelta.iC = BytesAsLU (&sData[lAt + 9], 4);
+		ulValue = BytesAsLU (&sData[lAt + 13], 4);
+		lAt+=17;
+		if ((stDelta.iType == DELTA_ENTITY) && (ulValue == 1))
+		{
+			if (lAt + 44 > lSize) { break; }
+			stEnt.ulOrder = BytesAsLU (&sData[lAt], 4);
+			stEnt.ulX = BytesAsLU (&sData[lAt + 4], 4);
+			stEnt.ulY = BytesAsLU (&sData[lAt + 8], 4);
+			for (iField = 0; iField < MAX_FIELDS; iField++)
+			{
+				stEnt.ulField[iField] =
+					BytesAsLU (&sData[lAt + 12 + (iField * 4)], 4);
+			}
+			lAt+=44;
+		}
+		if (DeltaValid (&stDelta, ulValue) == 0)
+		{
+			printf ("[ WARN ] Journal record %i does not fit the level.\n",
+				iRecords + 1);
+			break;
+		}
+		DeltaApply (&stDelta, ulValue, &stEnt);
+		iRecords++;
+	}
+
+	return (iRecords);
+}
+/*****************************************************************************/
+unsigned long LevelHash (int iLevel)
+/*****************************************************************************/
+{
+	/*** FNV-1a of the level file, to see if it changed. ***/
+
+	char sLocation[MAX_PATHFILE + 2];
+	int iFd;
+	unsigned char sData[MAX_DATA + 2];
+	int iRead;
+	unsigned long ulHash;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	ulHash = 2166136261UL;
+	snprintf (sLocation, MAX_PATHFILE, "%s%s%i.lvl", DIR_UNCOMP, SLASH, iLevel);
+	iFd = open (sLocation, O_RDONLY|O_BINARY);
+	if (iFd == -1) { return (0); }
+	while ((iRead = read (iFd, sData, MAX_DATA)) > 0)
+	{
+		for (iLoop = 0; iLoop < iRead; iLoop++)
+		{
+			ulHash ^= sData[iLoop];
+			ulHash = (ulHash * 16777619UL) & 0xFFFFFFFFUL;
+		}
+	}
+	close (iFd);
+
+	return (ulHash);
+}
+/*****************************************************************************/
+void SelectionBounds (int *iTop, int *iLeft, int *iBottom, int *iRight)
+/*****************************************************************************/
+{
+	if (iSelRow1 < iSelRow2)
+		{ *iTop = iSelRow1; *iBottom = iSelRow2; }
+			else { *iTop = iSelRow2; *iBottom = iSelRow1; }
+	if (iSelColumn1 < iSelColumn2)
+		{ *iLeft = iSelColumn1; *iRight = iSelColumn2; }
+			else { *iLeft = iSelColumn2; *iRight = iSelColumn1; }
+}
+/*****************************************************************************/
+void SelectionCopy (void)
+/*****************************************************************************/
+{
+	/*** The clipboard is kept when changing levels. ***/
+
+	int iTop, iLeft, iBottom, iRight;
+	unsigned long *ulNew;
+
+	/*** Used for looping. ***/
+	int iRowLoop;
+
+	SelectionBounds (&iTop, &iLeft, &iBottom, &iRight);
+	ulNew = realloc (ulClip, (iBottom - iTop + 1) * (iRight - iLeft + 1) *
+		sizeof (unsigned long));
+	if (ulNew == NULL)
+	{
+		printf ("[ WARN ] Could not allocate the clipboard!\n");
+		return;
+	}
+	ulClip = ulNew;
+	iClipWidth = iRight - iLeft + 1;
+	iClipHeight = iBottom - iTop + 1;
+	for (iRowLoop = iTop; iRowLoop <= iBottom; iRowLoop++)
+	{
+		memcpy (&ulClip[(iRowLoop - iTop) * iClipWidth],
+			&ulBack[iRowLoop][iLeft], iClipWidth * sizeof (unsigned long));
+	}
+	PlaySound ("wav/check_box.wav");
+}
+/*****************************************************************************/
+void SelectionFill (unsigned long ulTile)
+/*****************************************************************************/
+{
+	int iTop, iLeft, iBottom, iRight;
+
+	/*** Used for looping. ***/
+	int iRowLoop, iColumnLoop;
+
+	SelectionBounds (&iTop, &iLeft, &iBottom, &iRight);
+	UndoBegin();
+	UndoAreaBegin();
+	for (iRowLoop = iTop; iRowLoop <= iBottom; iRowLoop++)
+	{
+		for (iColumnLoop = iLeft; iColumnLoop <= iRight; iColumnLoop++)
+			{ SetBack (iRowLoop, iColumnLoop, ulTile); }
+	}
+	UndoAreaEnd();
+	UndoEnd();
+	PlaySound ("wav/ok_close.wav");
+	iChanged++;
+}
+/*****************************************************************************/
+void SelectionPaste (void)
+/*****************************************************************************/
+{
+	/* Pastes the clipboard with its top left at the hover tile, and selects
+	 * what was pasted. What does not fit the level is left out.
+	 */
+
+	int iRows, iColumns;
+
+	/*** Used for looping. ***/
+	int iRowLoop, iColumnLoop;
+
+	if (ulClip == NULL) { return; }
+	iRows = iClipHeight;
+	if (iHoverRow + iRows - 1 > (int)ulHeight)
+		{ iRows = ulHeight - iHoverRow + 1; }
+	iColumns = iClipWidth;
+	if (iHoverColumn + iColumns - 1 > (int)ulWidth)
+		{ iColumns = ulWidth - iHoverColumn + 1; }
+
+	UndoBegin();
+	UndoAreaBegin();
+	for (iRowLoop = 0; iRowLoop < iRows; iRowLoop++)
+	{
+		for (iColumnLoop = 0; iColumnLoop < iColumns; iColumnLoop++)
+		{
+			SetBack (iHoverRow + iRowLoop, iHoverColumn + iColumnLoop,
+				ulClip[(iRowLoop * iClipWidth) + iColumnLoop]);
+		}
+	}
+	UndoAreaEnd();
+	UndoEnd();
+
+	iSelRow1 = iHoverRow;
+	iSelColumn1 = iHoverColumn;
+	iSelRow2 = iHoverRow + iRows - 1;
+	iSelColumn2 = iHoverColumn + iColumns - 1;
+	iSelection = 1;
+	PlaySound ("wav/ok_close.wav");
+	iChanged++;
+}
+/*****************************************************************************/
+void FloodFill (int iRow, int iColumn, unsigned long ulTile)
+/*****************************************************************************/
+{
+	/* Gives the back tiles that are connected to (iRow, iColumn), and have
+	 * the same code, code ulTile. This is a scanline fill: each seed is
+	 * widened to a whole run in its row, and only the first tile of each
+	 * matching run above and below it is pushed. The seeds are kept on a
+	 * stack on the heap, not by recursion, so that any level size is safe.
+	 */
+
+	unsigned long ulOld;
+	int *iSeeds; /*** Pairs of row and column. ***/
+	int iMax, iNr;
+	int iAt, iLeft, iRight;
+	int iNeighbour;
+	int iInRun;
+
+	/*** Used for looping. ***/
+	int iLoop;
+	int iColumnLoop;
+
+	if ((iRow < 1) || (iRow > (int)ulHeight) ||
+		(iColumn < 1) || (iColumn > (int)ulWidth)) { return; }
+	ulOld = ulBack[iRow][iColumn];
+	if (ulOld == ulTile) { return; }
+
+	iSeeds = NULL;
+	iMax = 0;
+	iNr = FloodPush (&iSeeds, &iMax, 0, iRow, iColumn);
+
+	UndoBegin();
+	UndoAreaBegin();
+	while (iNr > 0)
+	{
+		iNr--;
+		iAt = iSeeds[(iNr * 2) + 1];
+		iRow = iSeeds[iNr * 2];
+		if (ulBack[iRow][iAt] != ulOld) { continue; }
+
+		iLeft = iAt;
+		while ((iLeft > 1) && (ulBack[iRow][iLeft - 1] == ulOld)) { iLeft--; }
+		iRight = iAt;
+		while ((iRight < (int)ulWidth) && (ulBack[iRow][iRight + 1] == ulOld))
+			{ iRight++; }
+		for (iColumnLoop = iLeft; iColumnLoop <= iRight; iColumnLoop++)
+			{ SetBack (iRow, iColumnLoop, ulTile); }
+
+		for (iLoop = 0; iLoop <= 1; iLoop++)
+		{
+			if (iLoop == 0) { iNeighbour = iRow - 1; } else { iNeighbour = iRow + 1; }
+			if ((iNeighbour < 1) || (iNeighbour > (int)ulHeight)) { continue; }
+			iInRun = 0;
+			for (iColumnLoop = iLeft; iColumnLoop <= iRight; iColumnLoop++)
+			{
+				if (ulBack[iNeighbour][iColumnLoop] == ulOld)
+				{
+					if (iInRun == 0)
+					{
+						iNr = FloodPush (&iSeeds, &iMax, iNr, iNeighbour, iColumnLoop);
+						if (iNr == -1) { break; }
+						iInRun = 1;
+					}
+				} else { iInRun = 0; }
+			}
+			if (iNr == -1) { break; }
+		}
+		if (iNr == -1)
+		{
+			printf ("[ WARN ] Could not allocate the fill stack!\n");
+			break;
+		}
+	}
+	UndoAreaEnd();
+	UndoEnd();
+	free (iSeeds);
+
+	PlaySound ("wav/ok_close.wav");
+	iChanged++;
+}
+/*****************************************************************************/
+int FloodPush (int **iSeeds, int *iMax, int iNr, int iRow, int iColumn)
+/*****************************************************************************/
+{
+	/*** Returns the new number of seeds, or -1 if out of memory. ***/
+
+	int *iNew;
+
+	if (iNr == *iMax)
+	{
+		if (*iMax == 0) { *iMax = 1024; } else { *iMax = *iMax * 2; }
+		iNew = realloc (*iSeeds, *iMax * 2 * sizeof (int));
+		if (iNew == NULL) { return (-1); }
+		*iSeeds = iNew;
+	}
+	(*iSeeds)[iNr * 2] = iRow;
+	(*iSeeds)[(iNr * 2) + 1] = iColumn;
+
+	return (iNr + 1);
+}
+/*****************************************************************************/
+void FindRebuild (int iLevel)
+/*****************************************************************************/
+{
+	/* Puts the back tiles of the loaded level, iLevel, in one list per code.
+	 * A level that is left may have had unsaved changes, so its counts are
+	 * taken from its file again when needed.
+	 */
+
+	/*** Used for looping. ***/
+	int iRowLoop, iColumnLoop;
+	int iLoop;
+
+	if ((iFindLevel != -1) && (iFindLevel != iLevel))
+		{ iFindCounted[iFindLevel] = 0; }
+	iFindLevel = iLevel;
+
+	for (iLoop = 0; iLoop < 256; iLoop++)
+	{
+		iFindHead[iLoop] = -1;
+		ulFindCount[iLevel][iLoop] = 0;
+	}
+	for (iRowLoop = (int)ulHeight; iRowLoop >= 1; iRowLoop--)
+	{
+		for (iColumnLoop = (int)ulWidth; iColumnLoop >= 1; iColumnLoop--)
+		{
+			FindMove (iRowLoop, iColumnLoop, 256, ulBack[iRowLoop][iColumnLoop]);
+		}
+	}
+	iFindCounted[iLevel] = 1;
+}
+/*****************************************************************************/
+void FindMove (int iRow, int iColumn, unsigned long ulOld, unsigned long ulNew)
+/*****************************************************************************/
+{
+	/* Moves a back tile from the list of code ulOld to that of ulNew. Use
+	 * 256 for ulOld if the tile is in no list yet.
+	 */
+
+	int iCell;
+
+	if ((ulOld == ulNew) || (iFindLevel == -1)) { return; }
+	iCell = (iRow * (MAX_WIDTH + 2)) + iColumn;
+
+	if (ulOld < 256)
+	{
+		if (iFindPrev[iCell] != -1)
+			{ iFindNext[iFindPrev[iCell]] = iFindNext[iCell]; }
+				else { iFindHead[ulOld] = iFindNext[iCell]; }
+		if (iFindNext[iCell] != -1)
+			{ iFindPrev[iFindNext[iCell]] = iFindPrev[iCell]; }
+		ulFindCount[iFindLevel][ulOld]--;
+	}
+
+	iFindPrev[iCell] = -1;
+	iFindNext[iCell] = iFindHead[ulNew];
+	if (iFindHead[ulNew] != -1) { iFindPrev[iFindHead[ulNew]] = iCell; }
+	iFindHead[ulNew] = iCell;
+	ulFindCount[iFindLevel][ulNew]++;
+}
+/*****************************************************************************/
+void FindCount (int iLevel)
+/*****************************************************************************/
+{
+	/*** Counts the back tiles of a level that is not loaded. ***/
+
+	char sLocation[MAX_PATHFILE + 2];
+	int iFd;
+	unsigned char sSize[2 + 2];
+	unsigned char *sBack;
+	int iSize;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	for (iLoop = 0; iLoop < 256; iLoop++) { ulFindCount[iLevel][iLoop] = 0; }
+	iFindCounted[iLevel] = 1;
+
+	snprintf (sLocation, MAX_PATHFILE, "%s%s%i.lvl", DIR_UNCOMP, SLASH, iLevel);
+	iFd = open (sLocation, O_RDONLY|O_BINARY);
+	if (iFd == -1) { return; }
+	if (read (iFd, sSize, 2) != 2) { close (iFd); return; }
+	iSize = sSize[0] * sSize[1];
+	sBack = malloc (iSize + 1);
+	if (sBack == NULL) { close (iFd); return; }
+	if (read (iFd, sBack, iSize) == iSize)
+	{
+		for (iLoop = 0; iLoop < iSize; iLoop++)
+			{ ulFindCount[iLevel][sBack[iLoop]]++; }
+	}
+	free (sBack);
+	close (iFd);
+}
+/*****************************************************************************/
+unsigned long FindTotal (int iCode)
+/*****************************************************************************/
+{
+	unsigned long ulTotal;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	ulTotal = 0;
+	for (iLoop = 0; iLoop <= MAX_LEVEL; iLoop++)
+	{
+		if (iFindCounted[iLoop] == 0) { FindCount (iLoop); }
+		ulTotal += ulFindCount[iLoop][iCode];
+	}
+
+	return (ulTotal);
+}
+/*****************************************************************************/
+void FindToggle (void)
+/*****************************************************************************/
+{
+	/*** Highlights the code of the active tile, or stops highlighting it. ***/
+
+	int iCode;
+
+	iCode = (int)ulBack[iHoverRow][iHoverColumn];
+	if (iFindCode == iCode) { iFindCode = -1; } else { iFindCode = iCode; }
+	PlaySound ("wav/check_box.wav");
+}
+/*****************************************************************************/
+void FindReplaceAll (void)
+/*****************************************************************************/
+{
+	/* Gives all back tiles with the highlighted code, in all levels, the
+	 * last used back tile. The loaded level changes as one undo step, and
+	 * is saved as usual. The other levels are changed in their files, and
+	 * saved at once, in a single backup and compress. That cannot be
+	 * undone, so the pop-up lists these levels.
+	 */
+
+	char sLine1[MAX_STATUS + 2];
+	char sLine2[MAX_STATUS + 2];
+	char sLevels[MAX_STATUS + 2];
+	int iLength;
+	unsigned long ulFrom, ulTo;
+	int *iCells;
+	int iNr;
+	int iSaved;
+	int iCell;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	if (iFindCode == -1) { return; }
+	ulFrom = iFindCode;
+	ulTo = iLastBack;
+	if (ulFrom == ulTo) { return; }
+
+	snprintf (sLevels, MAX_STATUS, "%s", "");
+	for (iLoop = 0; iLoop <= MAX_LEVEL; iLoop++)
+	{
+		if (iLoop == iFindLevel) { continue; }
+		if (iFindCounted[iLoop] == 0) { FindCount (iLoop); }
+		if (ulFindCount[iLoop][ulFrom] == 0) { continue; }
+		iLength = strlen (sLevels);
+		snprintf (sLevels + iLength, MAX_STATUS - iLength, "%s%i",
+			(iLength == 0) ? "" : ", ", iLoop);
+	}
+	snprintf (sLine1, MAX_STATUS, "Replace 0x%02lX by 0x%02lX everywhere?",
+		ulFrom, ulTo);
+	if (sLevels[0] == '\0')
+	{
+		snprintf (sLine2, MAX_STATUS, "%s", "No other level has it.");
+	} else {
+		snprintf (sLine2, MAX_STATUS, "No undo for levels %s.", sLevels);
+	}
+	if (PopUpYN (sLine1, sLine2) == 0) { return; }
+
+	iSaved = 0;
+	for (iLoop = 0; iLoop <= MAX_LEVEL; iLoop++)
+	{
+		if (iLoop == iFindLevel) { continue; }
+		if (ulFindCount[iLoop][ulFrom] == 0) { continue; }
+		if (iSaved == 0) { CreateBAK(); }
+		iSaved+=FindReplaceFile (iLoop, ulFrom, ulTo);
+	}
+	if (iSaved != 0) { Compress(); }
+
+	/*** In row order, so that SetBack() can merge runs. ***/
+	iNr = 0;
+	iCells = malloc ((ulFindCount[iFindLevel][ulFrom] + 1) * sizeof (int));
+	if (iCells == NULL)
+	{
+		printf ("[ WARN ] Could not allocate the replace list!\n");
+		return;
+	}
+	for (iCell = iFindHead[ulFrom]; iCell != -1; iCell = iFindNext[iCell])
+		{ iCells[iNr] = iCell; iNr++; }
+	qsort (iCells, iNr, sizeof (int), CompareInt);
+	if (iNr != 0)
+	{
+		UndoBegin();
+		UndoAreaBegin();
+		for (iLoop = 0; iLoop < iNr; iLoop++)
+		{
+			SetBack (iCells[iLoop] / (MAX_WIDTH + 2),
+				iCells[iLoop] % (MAX_WIDTH + 2), ulTo);
+		}
+		UndoAreaEnd();
+		UndoEnd();
+		iChanged++;
+	}
+	free (iCells);
+
+	iFindCode = ulTo;
+	PlaySound ("wav/ok_close.wav");
+}
+/*****************************************************************************/
+int FindReplaceFile (int iLevel, unsigned long ulFrom, unsigned long ulTo)
+/*****************************************************************************/
+{
+	/*** Returns 1 if the level file was changed. ***/
+
+	char sLocation[MAX_PATHFILE + 2];
+	int iFd;
+	unsigned char sSize[2 + 2];
+	unsigned char *sBack;
+	int iSize;
+	int iReturn;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	snprintf (sLocation, MAX_PATHFILE, "%s%s%i.lvl", DIR_UNCOMP, SLASH, iLevel);
+	iFd = open (sLocation, O_RDWR|O_BINARY);
+	if (iFd == -1)
+	{
+		snprintf (sWarning, MAX_WARNING, "Could not open \"%s\": %s!",
+			sLocation, strerror (errno));
+		Warning();
+		return (0);
+	}
+	if (read (iFd, sSize, 2) != 2) { close (iFd); return (0); }
+	iSize = sSize[0] * sSize[1];
+	sBack = malloc (iSize + 1);
+	if (sBack == NULL) { close (iFd); return (0); }
+
+	iReturn = 0;
+	if (read (iFd, sBack, iSize) == iSize)
+	{
+		for (iLoop = 0; iLoop < iSize; iLoop++)
+			{ if (sBack[iLoop] == ulFrom) { sBack[iLoop] = ulTo; } }
+		if ((lseek (iFd, 2, SEEK_SET) == 2) &&
+			(write (iFd, sBack, iSize) == iSize))
+		{
+			ulFindCount[iLevel][ulTo] += ulFindCount[iLevel][ulFrom];
+			ulFindCount[iLevel][ulFrom] = 0;
+			thumb[iLevel].iFresh = 0;
+			iReturn = 1;
+		} else {
+			snprintf (sWarning, MAX_WARNING, "Could not write \"%s\": %s!",
+				sLocation, strerror (errno));
+			Warning();
+			iFindCounted[iLevel] = 0;
+		}
+	}
+	free (sBack);
+	close (iFd);
+
+	return (iReturn);
+}
+/*****************************************************************************/
+int CompareInt (const void *a, const void *b)
+/*****************************************************************************/
+{
+	/*** For qsort(). ***/
+
+	if (*(const int *)a < *(const int *)b) { return (-1); }
+	if (*(const int *)a > *(const int *)b) { return (1); }
+	return (0);
+}
+/*****************************************************************************/
+void Batch (void)
+/*****************************************************************************/
+{
+	/* Runs the --batch command and exits. Only the level and JAR code is
+	 * used; SDL is never initialized, so no display is needed. The command
+	 * is run for the level of --level, or for all levels.
+	 */
+
+	int iFirst, iLast;
+	int iErrors;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	iNoAudio = 1;
+	if (iBatchLevel == -1) { iFirst = 0; iLast = MAX_LEVEL; }
+		else { iFirst = iBatchLevel; iLast = iBatchLevel; }
+
+	/*** pack: uncomp/ to the JAR, without extracting the JAR first ***/
+	if (strcmp (sBatch, "pack") == 0)
+	{
+		VerifyVersion();
+		CreateBAK();
+		Compress();
+		PrIfDe ("[  OK  ] Compressed JAR file.\n");
+		exit (EXIT_NORMAL);
+	}
+
+#ifdef BENCH
+	/*** bench: only in a "make bench" build ***/
+	if (strcmp (sBatch, "bench") == 0) { HoverBench(); exit (EXIT_NORMAL); }
+#endif
+
+	if ((strcmp (sBatch, "dump") != 0) &&
+		(strcmp (sBatch, "export") != 0) &&
+		(strcmp (sBatch, "import") != 0) &&
+		(strcmp (sBatch, "validate") != 0) &&
+		(strcmp (sBatch, "png") != 0))
+	{
+		snprintf (sError, MAX_ERROR, "Unknown batch command \"%s\"!", sBatch);
+		ErrorAndExit();
+	}
+
+	Decompress();
+	VerifyVersion();
+
+	/*** import: all levels must be fine before any is written ***/
+	if (strcmp (sBatch, "import") == 0)
+	{
+		for (iLoop = iFirst; iLoop <= iLast; iLoop++)
+			{ LevelImport (iLoop, 0); }
+		for (iLoop = iFirst; iLoop <= iLast; iLoop++)
+			{ LevelImport (iLoop, 1); }
+		CreateBAK();
+		Compress();
+		printf ("[  OK  ] Imported %i level(s).\n", iLast - iFirst + 1);
+		exit (EXIT_NORMAL);
+	}
+
+	/*** validate: the files themselves, one thread per level ***/
+	if (strcmp (sBatch, "validate") == 0)
+	{
+		iErrors = ValidateLevels (iFirst, iLast);
+		if (iErrors == 0)
+		{
+			printf ("[  OK  ] No problems found.\n");
+		} else {
+			printf ("[FAILED] Problems found: %i\n", iErrors);
+			exit (EXIT_ERROR);
+		}
+		exit (EXIT_NORMAL);
+	}
+
+	/*** png: pictures of the levels, one thread per level ***/
+	if (strcmp (sBatch, "png") == 0)
+	{
+		CreateDir (DIR_EXPORT);
+		iErrors = ShotLevels (iFirst, iLast);
+		if (iErrors != 0)
+		{
+			printf ("[FAILED] Pictures not written: %i\n", iErrors);
+			exit (EXIT_ERROR);
+		}
+		printf ("[  OK  ] Wrote %i picture(s) to %s%s.\n",
+			iLast - iFirst + 1, DIR_EXPORT, SLASH);
+		exit (EXIT_NORMAL);
+	}
+
+	if (strcmp (sBatch, "export") == 0) { CreateDir (DIR_EXPORT); }
+	for (iLoop = iFirst; iLoop <= iLast; iLoop++)
+	{
+		if (strcmp (sBatch, "dump") == 0)
+			{ printf ("[ INFO ] Level %i\n", iLoop); }
+		LevelLoad (iLoop);
+		if (strcmp (sBatch, "dump") == 0)
+		{
+			if (iDebug == 0) { LevelDump(); }
+		} else {
+			LevelExport (iLoop);
+		}
+	}
+	if (strcmp (sBatch, "export") == 0)
+	{
+		printf ("[  OK  ] Exported %i level(s) to %s%s.\n",
+			iLast - iFirst + 1, DIR_EXPORT, SLASH);
+	}
+	exit (EXIT_NORMAL);
+}
+/*****************************************************************************/
+int LevelCheck (int iLevel)
+/*****************************************************************************/
+{
+	/* Checks the loaded level, as it would be saved, with the checks of
+	 * Validate(). Shows the problems and returns how many there are.
+	 */
+
+	struct validation *stVal;
+
+	stVal = &validation[iLevel];
+	stVal->iLevel = iLevel;
+	stVal->lSize = LevelBytes (sLvl);
+	stVal->sData = sLvl;
+	Validate (stVal);
+	printf ("%s", stVal->sReport);
+
+	return (stVal->iProblems);
+}
+/*****************************************************************************/
+const char *SectionName (int iSection)
+/*****************************************************************************/
+{
+	/*** The names in exported levels; SECTION_* ***/
+
+	static const char *sSection[SECTION_KIND + 1] = { "level", "width", "height",
+		"back", "unknown", "front_types", "prince", "exit_trigger",
+		"save_trigger", "entrance_image", "exit_image" };
+
+	if (iSection <= SECTION_KIND) { return (sSection[iSection]); }
+	if (iSection < SECTION_TEXT) { return (kind[iSection - SECTION_KIND].sPlural); }
+	return ("text");
+}
+/*****************************************************************************/
+int SectionNr (char *sName)
+/*****************************************************************************/
+{
+	/*** Returns SECTION_*, or -1. ***/
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	for (iLoop = 0; iLoop < MAX_SECTIONS; iLoop++)
+	{
+		if (strcmp (sName, SectionName (iLoop)) == 0) { return (iLoop); }
+	}
+
+	return (-1);
+}
+/*****************************************************************************/
+void LevelExport (int iLevel)
+/*****************************************************************************/
+{
+	/*** Writes the loaded level to DIR_EXPORT, as JSON or CSV. ***/
+
+	char sLocation[MAX_PATHFILE + 2];
+	FILE *fOut;
+	int iError;
+
+	snprintf (sLocation, MAX_PATHFILE, "%s%s%i.%s", DIR_EXPORT, SLASH,
+		iLevel, iCSV == 1 ? "csv" : "json");
+	fOut = fopen (sLocation, "wb");
+	if (fOut == NULL)
+	{
+		snprintf (sError, MAX_ERROR, "Could not open \"%s\": %s!",
+			sLocation, strerror (errno));
+		ErrorAndExit();
+	}
+	if (iCSV == 1) { ExportCSV (fOut, iLevel); }
+		else { ExportJSON (fOut, iLevel); }
+	iError = ferror (fOut);
+	if (fclose (fOut) != 0) { iError = 1; }
+	if (iError != 0)
+	{
+		snprintf (sError, MAX_ERROR, "Could not write \"%s\"!", sLocation);
+		ErrorAndExit();
+	}
+	if (iDebug == 1) { printf ("[  OK  ] Exported \"%s\".\n", sLocation); }
+}
+/*****************************************************************************/
+void ExportJSON (FILE *fOut, int iLevel)
+/*****************************************************************************/
+{
+	/* Everything is written straight to fOut, in file order. A kind is an
+	 * array of objects with kind[].sField as keys; a point is [X, Y].
+	 */
+
+	int iSlot;
+	struct entity *stEnt;
+	char *sSep;
+
+	/*** Used for looping. ***/
+	int iRowLoop, iColumnLoop;
+	int iLoop;
+	int iField;
+
+	fprintf (fOut, "{\n\t\"%s\": %i,\n", SectionName (SECTION_LEVEL), iLevel);
+	fprintf (fOut, "\t\"%s\": %lu,\n", SectionName (SECTION_WIDTH), ulWidth);
+	fprintf (fOut, "\t\"%s\": %lu,\n", SectionName (SECTION_HEIGHT), ulHeight);
+
+	/*** back ***/
+	fprintf (fOut, "\t\"%s\": [\n", SectionName (SECTION_BACK));
+	for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
+	{
+		fprintf (fOut, "\t\t[");
+		for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
+		{
+			fprintf (fOut, "%s%lu", iColumnLoop == 1 ? "" : ", ",
+				ulBack[iRowLoop][iColumnLoop]);
+		}
+		fprintf (fOut, "]%s\n", iRowLoop == (int)ulHeight ? "" : ",");
+	}
+	fprintf (fOut, "\t],\n");
+
+	/*** unknown, front types ***/
+	fprintf (fOut, "\t\"%s\": [", SectionName (SECTION_UNKNOWN));
+	for (iLoop = 1; iLoop <= (int)ulNrUnknown; iLoop++)
+	{
+		fprintf (fOut, "%s[%lu, %lu, %lu, %lu]", iLoop == 1 ? "" : ", ",
+			ulUnknownA[iLoop], ulUnknownB[iLoop],
+			ulUnknownC[iLoop], ulUnknownD[iLoop]);
+	}
+	fprintf (fOut, "],\n\t\"%s\": [", SectionName (SECTION_FRONT_TYPES));
+	for (iLoop = 1; iLoop <= (int)ulFrontTypes; iLoop++)
+	{
+		fprintf (fOut, "%s[%lu, %lu, %lu]", iLoop == 1 ? "" : ", ",
+			ulFrontTypeA[iLoop], ulFrontTypeB[iLoop], ulFrontTypeNr[iLoop]);
+	}
+	fprintf (fOut, "],\n");
+
+	/*** prince, triggers and images ***/
+	for (iLoop = 0; iLoop < 5; iLoop++)
+	{
+		fprintf (fOut, "\t\"%s\": [%lu, %lu],\n",
+			SectionName (SECTION_POINT + iLoop),
+			*LevelValue (iLoop * 2), *LevelValue ((iLoop * 2) + 1));
+	}
+
+	/*** objects ***/
+	for (iLoop = 1; iLoop <= MAX_KINDS; iLoop++)
+	{
+		fprintf (fOut, "\t\"%s\": [", SectionName (SECTION_KIND + iLoop));
+		sSep = "\n";
+		for (iSlot = ent[iLoop].iFirst; iSlot != -1;
+			iSlot = ent[iLoop].arEnt[iSlot].iNext)
+		{
+			stEnt = &ent[iLoop].arEnt[iSlot];
+			fprintf (fOut, "%s\t\t{", sSep);
+			for (iField = 0; iField < kind[iLoop].iFields; iField++)
+			{
+				fprintf (fOut, "%s\"%s\": %lu", iField == 0 ? "" : ", ",
+					kind[iLoop].sField[iField],
+					*EntField (stEnt, kind[iLoop].iField[iField]));
+			}
+			fprintf (fOut, "}");
+			sSep = ",\n";
+		}
+		fprintf (fOut, "%s],\n", ent[iLoop].ulNr == 0 ? "" : "\n\t");
+	}
+
+	/*** text ***/
+	fprintf (fOut, "\t\"%s\": [", SectionName (SECTION_TEXT));
+	for (iLoop = 1; iLoop <= iNrLines; iLoop++)
+	{
+		if (iLoop != 1) { fprintf (fOut, ", "); }
+		ExportString (fOut, arTextLine[iLoop]);
+	}
+	fprintf (fOut, "]\n}\n");
+}
+/*****************************************************************************/
+void ExportCSV (FILE *fOut, int iLevel)
+/*****************************************************************************/
+{
+	/* One record per line; the first field is the section. A back record
+	 * is one row, an object record has its fields in file order (see
+	 * kind[]), and a text record is one line.
+	 */
+
+	int iSlot;
+	struct entity *stEnt;
+
+	/*** Used for looping. ***/
+	int iRowLoop, iColumnLoop;
+	int iLoop;
+	int iField;
+
+	fprintf (fOut, "%s,%i\n", SectionName (SECTION_LEVEL), iLevel);
+	fprintf (fOut, "%s,%lu\n", SectionName (SECTION_WIDTH), ulWidth);
+	fprintf (fOut, "%s,%lu\n", SectionName (SECTION_HEIGHT), ulHeight);
+	for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
+	{
+		fprintf (fOut, "%s", SectionName (SECTION_BACK));
+		for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
+			{ fprintf (fOut, ",%lu", ulBack[iRowLoop][iColumnLoop]); }
+		fprintf (fOut, "\n");
+	}
+	for (iLoop = 1; iLoop <= (int)ulNrUnknown; iLoop++)
+	{
+		fprintf (fOut, "%s,%lu,%lu,%lu,%lu\n", SectionName (SECTION_UNKNOWN),
+			ulUnknownA[iLoop], ulUnknownB[iLoop],
+			ulUnknownC[iLoop], ulUnknownD[iLoop]);
+	}
+	for (iLoop = 1; iLoop <= (int)ulFrontTypes; iLoop++)
+	{
+		fprintf (fOut, "%s,%lu,%lu,%lu\n", SectionName (SECTION_FRONT_TYPES),
+			ulFrontTypeA[iLoop], ulFrontTypeB[iLoop], ulFrontTypeNr[iLoop]);
+	}
+	for (iLoop = 0; iLoop < 5; iLoop++)
+	{
+		fprintf (fOut, "%s,%lu,%lu\n", SectionName (SECTION_POINT + iLoop),
+			*LevelValue (iLoop * 2), *LevelValue ((iLoop * 2) + 1));
+	}
+	for (iLoop = 1; iLoop <= MAX_KINDS; iLoop++)
+	{
+		for (iSlot = ent[iLoop].iFirst; iSlot != -1;
+			iSlot = ent[iLoop].arEnt[iSlot].iNext)
+		{
+			stEnt = &ent[iLoop].arEnt[iSlot];
+			fprintf (fOut, "%s", SectionName (SECTION_KIND + iLoop));
+			for (iField = 0; iField < kind[iLoop].iFields; iField++)
+				{ fprintf (fOut, ",%lu", *EntField (stEnt, kind[iLoop].iField[iField])); }
+			fprintf (fOut, "\n");
+		}
+	}
+	for (iLoop = 1; iLoop <= iNrLines; iLoop++)
+	{
+		fprintf (fOut, "%s,", SectionName (SECTION_TEXT));
+		ExportString (fOut, arTextLine[iLoop]);
+		fprintf (fOut, "\n");
+	}
+}
+/*****************************************************************************/
+void ExportString (FILE *fOut, char *sString)
+/*****************************************************************************/
+{
+	/* A quoted string. For CSV, quotes are doubled. For JSON, all bytes
+	 * that are not printable ASCII become \u00XX, so that the output is
+	 * valid UTF-8 whatever the game uses.
+	 */
+
+	unsigned char cChar;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	fputc ('"', fOut);
+	for (iLoop = 0; sString[iLoop] != '\0'; iLoop++)
+	{
+		cChar = sString[iLoop];
+		if (iCSV == 1)
+		{
+			if (cChar == '"') { fputc ('"', fOut); }
+			fputc (cChar, fOut);
+		}
+		else if ((cChar == '"') || (cChar == '\\'))
+		{
+			fputc ('\\', fOut);
+			fputc (cChar, fOut);
+		}
+		else if ((cChar < 0x20) || (cChar > 0x7E))
+		{
+			fprintf (fOut, "\\u%04X", cChar);
+		} else {
+			fputc (cChar, fOut);
+		}
+	}
+	fputc ('"', fOut);
+}
+/*****************************************************************************/
+void LevelImport (int iLevel, int iWrite)
+/*****************************************************************************/
+{
+	/* Reads level iLevel from DIR_EXPORT, as JSON or CSV, and checks it. If
+	 * iWrite is 1, it is then written to DIR_UNCOMP. Any problem ends the
+	 * program, with the file and line in the error.
+	 */
+
+	int iFd;
+	struct stat stStatus;
+	long lRead;
+	int iRead;
+	char sLocation[MAX_PATHFILE + 2];
+	char sWhat[MAX_ERROR + 2];
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	snprintf (sImportFile, MAX_PATHFILE, "%s%s%i.%s", DIR_EXPORT, SLASH,
+		iLevel, iCSV == 1 ? "csv" : "json");
+	iFd = open (sImportFile, O_RDONLY|O_BINARY);
+	if ((iFd == -1) || (fstat (iFd, &stStatus) == -1))
+	{
+		snprintf (sError, MAX_ERROR, "Could not open \"%s\": %s!",
+			sImportFile, strerror (errno));
+		ErrorAndExit();
+	}
+	sImport = malloc (stStatus.st_size + 1);
+	if (sImport == NULL)
+	{
+		snprintf (sError, MAX_ERROR, "Could not allocate %li bytes!",
+			(long)stStatus.st_size + 1);
+		ErrorAndExit();
+	}
+	lRead = 0;
+	while (lRead < stStatus.st_size)
+	{
+		iRead = read (iFd, sImport + lRead, stStatus.st_size - lRead);
+		if (iRead <= 0) { break; }
+		lRead+=iRead;
+	}
+	close (iFd);
+	sImport[lRead] = '\0';
+	lImportSize = lRead;
+	lImportPos = 0;
+	iImportLine = 1;
+
+	/*** Start from an empty level. ***/
+	ulWidth = 0;
+	ulHeight = 0;
+	ulNrUnknown = 0;
+	ulFrontTypes = 0;
+	for (iLoop = VALUE_PRINCE_X; iLoop <= VALUE_EXIT_IMAGE_Y; iLoop++)
+		{ *LevelValue (iLoop) = 0; }
+	for (iLoop = 1; iLoop <= MAX_KINDS; iLoop++) { EntClear (iLoop); }
+	for (iLoop = 1; iLoop <= MAX_LINES; iLoop++)
+		{ snprintf (arTextLine[iLoop], MAX_LINECHARS, "%s", ""); }
+	iNrLines = 0;
+	for (iLoop = 0; iLoop < MAX_SECTIONS; iLoop++) { iImportSeen[iLoop] = 0; }
+
+	if (iCSV == 1) { ImportCSV (iLevel); } else { ImportJSON (iLevel); }
+	free (sImport);
+	sImport = NULL;
+
+	/*** Everything but the lists is required. ***/
+	for (iLoop = 0; iLoop < MAX_SECTIONS; iLoop++)
+	{
+		if ((iImportSeen[iLoop] == 0) && ((iLoop <= SECTION_BACK) ||
+			((iLoop >= SECTION_POINT) && (iLoop < SECTION_POINT + 5))))
+		{
+			snprintf (sWhat, MAX_ERROR, "\"%s\" is missing.",
+				SectionName (iLoop));
+			ImportFail (sWhat);
+		}
+	}
+	if (iImportSeen[SECTION_BACK] != (int)ulHeight)
+	{
+		snprintf (sWhat, MAX_ERROR, "There are %i back rows, not %lu.",
+			iImportSeen[SECTION_BACK], ulHeight);
+		ImportFail (sWhat);
+	}
+	if (LevelCheck (iLevel) != 0) { ImportFail ("This is not a valid level."); }
+
+	if (iWrite == 1)
+	{
+		snprintf (sLocation, MAX_PATHFILE, "%s%s%i.lvl",
+			DIR_UNCOMP, SLASH, iLevel);
+		LevelWrite (sLocation);
+		if (iDebug == 1)
+			{ printf ("[  OK  ] Imported \"%s\".\n", sImportFile); }
+	}
+}
+/*****************************************************************************/
+void ImportFail (char *sWhat)
+/*****************************************************************************/
+{
+	snprintf (sError, MAX_ERROR, "%s, line %i: %s",
+		sImportFile, iImportLine, sWhat);
+	ErrorAndExit();
+}
+/*****************************************************************************/
+unsigned long ImportValue (int iField, unsigned long ulMax)
+/*****************************************************************************/
+{
+	/*** Returns arImportField[iField] as a number from 0 to ulMax. ***/
+
+	char sWhat[MAX_ERROR + 2];
+	int iLength;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	iLength = strlen (arImportField[iField]);
+	for (iLoop = 0; iLoop < iLength; iLoop++)
+		{ if (isdigit ((unsigned char)arImportField[iField][iLoop]) == 0) { break; } }
+	if ((iLength == 0) || (iLoop != iLength) || (iLength > 10) ||
+		(strtoul (arImportField[iField], NULL, 10) > ulMax))
+	{
+		snprintf (sWhat, MAX_ERROR, "Value %i, \"%s\", is not a number from"
+			" 0 to %lu.", iField, arImportField[iField], ulMax);
+		ImportFail (sWhat);
+	}
+
+	return (strtoul (arImportField[iField], NULL, 10));
+}
+/*****************************************************************************/
+void ImportRecord (int iLevel, int iSection, int iFields)
+/*****************************************************************************/
+{
+	/* Adds one record, in arImportField[1] to [iFields], to the level. The
+	 * JSON and CSV parsers both end up here, so this is where values are
+	 * checked against what the .lvl format can hold.
+	 */
+
+	char sWhat[MAX_ERROR + 2];
+	int iExpected;
+	int iKind, iSlot;
+	unsigned long ulMax;
+
+	/*** Used for looping. ***/
+	int iField;
+
+	if (iSection >= SECTION_TEXT) { iExpected = 1; }
+	else if (iSection > SECTION_KIND)
+		{ iExpected = kind[iSection - SECTION_KIND].iFields; }
+	else if (iSection >= SECTION_POINT) { iExpected = 2; }
+	else if (iSection == SECTION_FRONT_TYPES) { iExpected = 3; }
+	else if (iSection == SECTION_UNKNOWN) { iExpected = 4; }
+	else if (iSection == SECTION_BACK) { iExpected = ulWidth; }
+	else { iExpected = 1; }
+	if (iFields != iExpected)
+	{
+		snprintf (sWhat, MAX_ERROR, "\"%s\" needs %i value(s), not %i.",
+			SectionName (iSection), iExpected, iFields);
+		ImportFail (sWhat);
+	}
+	if ((iImportSeen[iSection] != 0) && ((iSection < SECTION_BACK) ||
+		((iSection >= SECTION_POINT) && (iSection < SECTION_POINT + 5))))
+	{
+		snprintf (sWhat, MAX_ERROR, "\"%s\" is there twice.",
+			SectionName (iSection));
+		ImportFail (sWhat);
+	}
+
+	switch (iSection)
+	{
+		case SECTION_LEVEL:
+			if ((int)ImportValue (1, MAX_LEVEL) != iLevel)
+			{
+				snprintf (sWhat, MAX_ERROR, "This is level %s, not %i.",
+					arImportField[1], iLevel);
+				ImportFail (sWhat);
+			}
+			break;
+		case SECTION_WIDTH:
+		case SECTION_HEIGHT:
+			if (iImportSeen[SECTION_BACK] != 0)
+				{ ImportFail ("The size must come before the back tiles."); }
+			ulMax = ImportValue (1, 0xFF);
+			if (ulMax == 0)
+				{ ImportFail ("A level needs at least one row and column."); }
+			if (iSection == SECTION_WIDTH) { ulWidth = ulMax; }
+				else { ulHeight = ulMax; }
+			break;
+		case SECTION_BACK:
+			if ((iImportSeen[SECTION_WIDTH] == 0) ||
+				(iImportSeen[SECTION_HEIGHT] == 0))
+				{ ImportFail ("The size must come before the back tiles."); }
+			if (iImportSeen[SECTION_BACK] == (int)ulHeight)
+				{ ImportFail ("There are more back rows than the height."); }
+			for (iField = 1; iField <= iFields; iField++)
+			{
+				ulBack[iImportSeen[SECTION_BACK] + 1][iField] =
+					ImportValue (iField, 0xFF);
+			}
+			break;
+		case SECTION_UNKNOWN:
+			if (ulNrUnknown == MAX_UNKNOWN) { ImportFail ("Too many unknown."); }
+			ulNrUnknown++;
+			ulUnknownA[ulNrUnknown] = ImportValue (1, 0xFF);
+			ulUnknownB[ulNrUnknown] = ImportValue (2, 0xFF);
+			ulUnknownC[ulNrUnknown] = ImportValue (3, 0xFF);
+			ulUnknownD[ulNrUnknown] = ImportValue (4, 0xFF);
+			break;
+		case SECTION_FRONT_TYPES:
+			if (ulFrontTypes == MAX_FRONT_TYPE)
+				{ ImportFail ("Too many front types."); }
+			ulFrontTypes++;
+			ulFrontTypeA[ulFrontTypes] = ImportValue (1, 0xFF);
+			ulFrontTypeB[ulFrontTypes] = ImportValue (2, 0xFF);
+			ulFrontTypeNr[ulFrontTypes] = ImportValue (3, 0xFF);
+			break;
+		case SECTION_TEXT:
+			if (iNrLines == MAX_LINES) { ImportFail ("Too many text lines."); }
+			if ((int)strlen (arImportField[1]) >= MAX_LINECHARS)
+			{
+				snprintf (sWhat, MAX_ERROR, "Text lines can have at most %i"
+					" characters.", MAX_LINECHARS - 1);
+				ImportFail (sWhat);
+			}
+			if (strchr (arImportField[1], '\\') != NULL)
+				{ ImportFail ("Text lines cannot contain '\\'."); }
+			iNrLines++;
+			snprintf (arTextLine[iNrLines], MAX_LINECHARS, "%s",
+				arImportField[1]);
+			break;
+		default:
+			if (iSection <= SECTION_KIND)
+			{
+				*LevelValue ((iSection - SECTION_POINT) * 2) =
+					ImportValue (1, 0xFFFF);
+				*LevelValue (((iSection - SECTION_POINT) * 2) + 1) =
+					ImportValue (2, 0xFFFF);
+				break;
+			}
+			iKind = iSection - SECTION_KIND;
+			if (ent[iKind].ulNr == MAX_PER_KIND)
+			{
+				snprintf (sWhat, MAX_ERROR, "Too many %s (max. %i).",
+					kind[iKind].sPlural, MAX_PER_KIND);
+				ImportFail (sWhat);
+			}
+			iSlot = EntAdd (iKind);
+			for (iField = 0; iField < kind[iKind].iFields; iField++)
+			{
+				if (kind[iKind].iBytes[iField] == 1) { ulMax = 0xFF; }
+					else { ulMax = 0xFFFF; }
+				*EntField (&ent[iKind].arEnt[iSlot], kind[iKind].iField[iField]) =
+					ImportValue (iField + 1, ulMax);
+			}
+			break;
+	}
+	iImportSeen[iSection]++;
+}
+/*****************************************************************************/
+int ImportPeek (void)
+/*****************************************************************************/
+{
+	/*** Skips white space; returns the next character, or -1 at the end. ***/
+
+	while ((lImportPos < lImportSize) &&
+		((sImport[lImportPos] == ' ') || (sImport[lImportPos] == '\t') ||
+		(sImport[lImportPos] == '\r') || (sImport[lImportPos] == '\n')))
+	{
+		if (sImport[lImportPos] == '\n') { iImportLine++; }
+		lImportPos++;
+	}
+	if (lImportPos == lImportSize) { return (-1); }
+
+	return ((unsigned char)sImport[lImportPos]);
+}
+/*****************************************************************************/
+void ImportExpect (char cChar)
+/*****************************************************************************/
+{
+	char sWhat[MAX_ERROR + 2];
+
+	if (ImportPeek() != cChar)
+	{
+		snprintf (sWhat, MAX_ERROR, "Expected '%c'.", cChar);
+		ImportFail (sWhat);
+	}
+	lImportPos++;
+}
+/*****************************************************************************/
+void ImportString (char *sString, int iMax)
+/*****************************************************************************/
+{
+	/* A JSON string of at most iMax - 1 bytes. Escapes are only accepted
+	 * for what ExportString() writes: \" \\ \/ and \u0001 to \u00FF.
+	 */
+
+	int iLength;
+	int iChar;
+	unsigned long ulCode;
+	char sHex[4 + 2];
+
+	ImportExpect ('"');
+	iLength = 0;
+	while (1)
+	{
+		if (lImportPos == lImportSize) { ImportFail ("Unterminated string."); }
+		iChar = (unsigned char)sImport[lImportPos];
+		lImportPos++;
+		if (iChar == '"') { break; }
+		if ((iChar == '\n') || (iChar == '\r'))
+			{ ImportFail ("Unterminated string."); }
+		if (iChar == '\\')
+		{
+			if (lImportPos == lImportSize) { ImportFail ("Unterminated string."); }
+			iChar = (unsigned char)sImport[lImportPos];
+			lImportPos++;
+			if (iChar == 'u')
+			{
+				if (lImportSize - lImportPos < 4) { ImportFail ("Bad \\u escape."); }
+				memcpy (sHex, &sImport[lImportPos], 4);
+				sHex[4] = '\0';
+				lImportPos+=4;
+				ulCode = strtoul (sHex, NULL, 16);
+				if ((isxdigit ((unsigned char)sHex[0]) == 0) ||
+					(isxdigit ((unsigned char)sHex[1]) == 0) ||
+					(isxdigit ((unsigned char)sHex[2]) == 0) ||
+					(isxdigit ((unsigned char)sHex[3]) == 0) ||
+					(ulCode == 0) || (ulCode > 0xFF))
+					{ ImportFail ("Bad \\u escape."); }
+				iChar = ulCode;
+			}
+			else if ((iChar != '"') && (iChar != '\\') && (iChar != '/'))
+				{ ImportFail ("Bad escape."); }
+		}
+		if (iLength == iMax - 1) { ImportFail ("String too long."); }
+		sString[iLength] = iChar;
+		iLength++;
+	}
+	sString[iLength] = '\0';
+}
+/*****************************************************************************/
+void ImportToken (char *sToken)
+/*****************************************************************************/
+{
+	/*** A JSON number; ImportValue() checks it. ***/
+
+	int iLength;
+
+	ImportPeek();
+	iLength = 0;
+	while ((lImportPos < lImportSize) &&
+		(strchr ("0123456789+-.eE", sImport[lImportPos]) != NULL) &&
+		(sImport[lImportPos] != '\0'))
+	{
+		if (iLength == MAX_IMPORT_FIELD) { ImportFail ("Number too long."); }
+		sToken[iLength] = sImport[lImportPos];
+		iLength++;
+		lImportPos++;
+	}
+	sToken[iLength] = '\0';
+	if (iLength == 0) { ImportFail ("Expected a number."); }
+}
+/*****************************************************************************/
+int ImportJSONArray (void)
+/*****************************************************************************/
+{
+	/*** An array of numbers, to arImportField[1] and up; returns how many. ***/
+
+	int iFields;
+	int iMore;
+
+	iFields = 0;
+	ImportExpect ('[');
+	iMore = (ImportPeek() != ']');
+	while (iMore == 1)
+	{
+		if (iFields == MAX_IMPORT_FIELDS) { ImportFail ("Too many values."); }
+		iFields++;
+		ImportToken (arImportField[iFields]);
+		if (ImportPeek() == ',') { lImportPos++; } else { iMore = 0; }
+	}
+	ImportExpect (']');
+
+	return (iFields);
+}
+/*****************************************************************************/
+void ImportJSONObject (int iKind)
+/*****************************************************************************/
+{
+	/*** An object, with kind[].sField keys, to arImportField[] in file order. ***/
+
+	char sKey[MAX_IMPORT_FIELD + 2];
+	char sWhat[MAX_ERROR + 2];
+	int iSet;
+	int iMore;
+
+	/*** Used for looping. ***/
+	int iField;
+
+	for (iField = 1; iField <= kind[iKind].iFields; iField++)
+		{ arImportField[iField][0] = '\0'; }
+	iSet = 0;
+	ImportExpect ('{');
+	iMore = (ImportPeek() != '}');
+	while (iMore == 1)
+	{
+		ImportString (sKey, MAX_IMPORT_FIELD);
+		ImportExpect (':');
+		for (iField = 0; iField < kind[iKind].iFields; iField++)
+			{ if (strcmp (sKey, kind[iKind].sField[iField]) == 0) { break; } }
+		if ((iField == kind[iKind].iFields) ||
+			(arImportField[iField + 1][0] != '\0'))
+		{
+			snprintf (sWhat, MAX_ERROR, "Unexpected \"%s\" in %s.",
+				sKey, kind[iKind].sPlural);
+			ImportFail (sWhat);
+		}
+		ImportToken (arImportField[iField + 1]);
+		iSet++;
+		if (ImportPeek() == ',') { lImportPos++; } else { iMore = 0; }
+	}
+	ImportExpect ('}');
+	if (iSet != kind[iKind].iFields)
+	{
+		snprintf (sWhat, MAX_ERROR, "Each of the %s needs %i values, not %i.",
+			kind[iKind].sPlural, kind[iKind].iFields, iSet);
+		ImportFail (sWhat);
+	}
+}
+/*****************************************************************************/
+void ImportJSON (int iLevel)
+/*****************************************************************************/
+{
+	/*** The layout of ExportJSON(), but the sections may be in any order. ***/
+
+	char sKey[MAX_IMPORT_FIELD + 2];
+	char sWhat[MAX_ERROR + 2];
+	int iSection;
+	int iMore, iMoreRecords;
+
+	ImportExpect ('{');
+	iMore = (ImportPeek() != '}');
+	while (iMore == 1)
+	{
+		ImportString (sKey, MAX_IMPORT_FIELD);
+		ImportExpect (':');
+		iSection = SectionNr (sKey);
+		if (iSection == -1)
+		{
+			snprintf (sWhat, MAX_ERROR, "Unknown section \"%s\".", sKey);
+			ImportFail (sWhat);
+		}
+
+		if (iSection < SECTION_BACK)
+		{
+			ImportToken (arImportField[1]);
+			ImportRecord (iLevel, iSection, 1);
+		}
+		else if ((iSection >= SECTION_POINT) && (iSection <= SECTION_KIND))
+		{
+			ImportRecord (iLevel, iSection, ImportJSONArray());
+		} else {
+			/*** A list of records. ***/
+			ImportExpect ('[');
+			iMoreRecords = (ImportPeek() != ']');
+			while (iMoreRecords == 1)
+			{
+				if (iSection == SECTION_TEXT)
+				{
+					ImportString (arImportField[1], MAX_IMPORT_FIELD);
+					ImportRecord (iLevel, iSection, 1);
+				}
+				else if (iSection > SECTION_KIND)
+				{
+					ImportJSONObject (iSection - SECTION_KIND);
+					ImportRecord (iLevel, iSection,
+						kind[iSection - SECTION_KIND].iFields);
+				} else {
+					ImportRecord (iLevel, iSection, ImportJSONArray());
+				}
+				if (ImportPeek() == ',') { lImportPos++; }
+					else { iMoreRecords = 0; }
+			}
+			ImportExpect (']');
+		}
+
+		if (ImportPeek() == ',') { lImportPos++; } else { iMore = 0; }
+	}
+	ImportExpect ('}');
+	if (ImportPeek() != -1) { ImportFail ("Unexpected data after the level."); }
+}
+/*****************************************************************************/
+int ImportCSVLine (void)
+/*****************************************************************************/
+{
+	/* Splits the next non-empty line into arImportField[]. Returns the
+	 * number of fields, or -1 at the end. A quoted field may contain
+	 * commas, line breaks and doubled quotes.
+	 */
+
+	int iFields;
+	int iLength;
+	int iQuoted; /*** 1 = in quotes, 2 = after the closing quote ***/
+	char cChar;
+
+	while ((lImportPos < lImportSize) &&
+		((sImport[lImportPos] == '\n') || (sImport[lImportPos] == '\r')))
+	{
+		if (sImport[lImportPos] == '\n') { iImportLine++; }
+		lImportPos++;
+	}
+	if (lImportPos == lImportSize) { return (-1); }
+
+	iFields = 0;
+	iLength = 0;
+	iQuoted = 0;
+	while (1)
+	{
+		if (lImportPos == lImportSize)
+		{
+			if (iQuoted == 1) { ImportFail ("Unterminated string."); }
+			cChar = '\n';
+		} else { cChar = sImport[lImportPos]; }
+
+		if (iQuoted == 1)
+		{
+			lImportPos++;
+			if (cChar == '"')
+			{
+				if ((lImportPos < lImportSize) && (sImport[lImportPos] == '"'))
+					{ lImportPos++; } else { iQuoted = 2; continue; }
+			}
+			if (cChar == '\n') { iImportLine++; }
+		}
+		else if ((cChar == ',') || (cChar == '\n') || (cChar == '\r'))
+		{
+			if (iFields == MAX_IMPORT_FIELDS) { ImportFail ("Too many values."); }
+			arImportField[iFields][iLength] = '\0';
+			iFields++;
+			if (cChar != ',') { break; } /*** The next call skips it. ***/
+			lImportPos++;
+			iLength = 0;
+			iQuoted = 0;
+			continue;
+		} else {
+			lImportPos++;
+			if (iQuoted == 2) { ImportFail ("Text after a closing quote."); }
+			if ((cChar == '"') && (iLength == 0)) { iQuoted = 1; continue; }
+		}
+		if (iLength == MAX_IMPORT_FIELD) { ImportFail ("Value too long."); }
+		arImportField[iFields][iLength] = cChar;
+		iLength++;
+	}
+
+	return (iFields);
+}
+/*****************************************************************************/
+void ImportCSV (int iLevel)
+/*****************************************************************************/
+{
+	/*** The layout of ExportCSV(); the first field is the section. ***/
+
+	char sWhat[MAX_ERROR + 2];
+	int iFields;
+	int iSection;
+
+	while ((iFields = ImportCSVLine()) != -1)
+	{
+		iSection = SectionNr (arImportField[0]);
+		if (iSection == -1)
+		{
+			snprintf (sWhat, MAX_ERROR, "Unknown section \"%s\".",
+				arImportField[0]);
+			ImportFail (sWhat);
+		}
+		ImportRecord (iLevel, iSection, iFields - 1);
+	}
+}
+/*****************************************************************************/
+int ValidateLevels (int iFirst, int iLast)
+/*****************************************************************************/
+{
+	/* Checks the files of levels iFirst to iLast in DIR_UNCOMP, one thread
+	 * per level. Shows the problems in level order; returns how many.
+	 */
+
+	SDL_Thread *thread[MAX_LEVEL + 2];
+	int iProblems;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	for (iLoop = iFirst; iLoop <= iLast; iLoop++)
+	{
+		validation[iLoop].iLevel = iLoop;
+		thread[iLoop] = SDL_CreateThread (ValidateThread, "Validate",
+			&validation[iLoop]);
+		/*** Without threads, just check it now. ***/
+		if (thread[iLoop] == NULL) { ValidateThread (&validation[iLoop]); }
+	}
+	iProblems = 0;
+	for (iLoop = iFirst; iLoop <= iLast; iLoop++)
+	{
+		if (thread[iLoop] != NULL) { SDL_WaitThread (thread[iLoop], NULL); }
+		printf ("%s", validation[iLoop].sReport);
+		iProblems+=validation[iLoop].iProblems;
+	}
+
+	return (iProblems);
+}
+/*****************************************************************************/
+int ValidateThread (void *data)
+/*****************************************************************************/
+{
+	/* Reads and checks one level file. This runs next to other threads, so
+	 * it must not touch the globals or exit; problems go in the report.
+	 */
+
+	struct validation *stVal;
+	char sLocation[MAX_PATHFILE + 2];
+	char sLine[MAX_WARNING + 2];
+	int iFd;
+	struct stat stStatus;
+	int iRead;
+
+	stVal = (struct validation *)data;
+	stVal->iShort = 0;
+	stVal->iProblems = 0;
+	snprintf (stVal->sReport, MAX_REPORT, "%s", "");
+	snprintf (sLocation, MAX_PATHFILE, "%s%s%i.lvl",
+		DIR_UNCOMP, SLASH, stVal->iLevel);
+	iFd = open (sLocation, O_RDONLY|O_BINARY);
+	if ((iFd == -1) || (fstat (iFd, &stStatus) == -1))
+	{
+		snprintf (sLine, MAX_WARNING, "could not open \"%s\": %s!",
+			sLocation, strerror (errno));
+		ValidateAdd (stVal, sLine);
+		if (iFd != -1) { close (iFd); }
+		return (0);
+	}
+	stVal->sData = malloc (stStatus.st_size + 1);
+	if (stVal->sData == NULL)
+	{
+		snprintf (sLine, MAX_WARNING, "could not allocate %li bytes!",
+			(long)stStatus.st_size + 1);
+		ValidateAdd (stVal, sLine);
+		close (iFd);
+		return (0);
+	}
+	stVal->lSize = 0;
+	while (stVal->lSize < stStatus.st_size)
+	{
+		iRead = read (iFd, stVal->sData + stVal->lSize,
+			stStatus.st_size - stVal->lSize);
+		if (iRead <= 0) { break; }
+		stVal->lSize+=iRead;
+	}
+	close (iFd);
+
+	Validate (stVal);
+	free (stVal->sData);
+	stVal->sData = NULL;
+
+	return (0);
+}
+/*****************************************************************************/
+int Validate (struct validation *stVal)
+/*****************************************************************************/
+{
+	/* Checks the level file in stVal->sData, in file order, for everything
+	 * that makes the game hang or crash: too few or too many records,
+	 * unknown back tile codes, coordinates outside the level, front types
+	 * and gates that do not exist, and too much text. Only kind[] is read;
+	 * the loaded level is never used. Returns the number of problems.
+	 */
+
+	char sLine[MAX_WARNING + 2];
+	unsigned long ulWidthV, ulHeightV;
+	unsigned long ulTile;
+	long lUnknownTiles, lFirstUnknown;
+	unsigned long ulNr[MAX_KINDS + 2];
+	unsigned long ulNrRecords;
+	unsigned long ulFrontTypesV;
+	unsigned long ulValue[MAX_FIELDS + 2];
+	unsigned long ulX, ulY;
+	unsigned long ulNrTextV;
+	int iLines, iLineChars;
+	static const char *sPoint[5] = { "prince", "exit trigger",
+		"save trigger", "entrance image", "exit image" };
+
+	/*** Used for looping. ***/
+	long lLoop;
+	int iKind;
+	unsigned long ulObject;
+	int iField;
+	int iPoint;
+
+	stVal->lPos = 0;
+	stVal->iShort = 0;
+	stVal->iProblems = 0;
+	snprintf (stVal->sReport, MAX_REPORT, "%s", "");
+
+	/*** width, height and back ***/
+	ulWidthV = ValidateRead (stVal, 1);
+	ulHeightV = ValidateRead (stVal, 1);
+	if ((ulWidthV == 0) || (ulHeightV == 0))
+	{
+		snprintf (sLine, MAX_WARNING, "is %lux%lu tiles.", ulWidthV, ulHeightV);
+		ValidateAdd (stVal, sLine);
+	}
+	lUnknownTiles = 0;
+	lFirstUnknown = 0;
+	for (lLoop = 0; lLoop < (long)(ulWidthV * ulHeightV); lLoop++)
+	{
+		ulTile = ValidateRead (stVal, 1);
+		if (ulTile > LAST_BACK)
+		{
+			if (lUnknownTiles == 0) { lFirstUnknown = lLoop; }
+			lUnknownTiles++;
+		}
+	}
+	if (lUnknownTiles != 0)
+	{
+		snprintf (sLine, MAX_WARNING, "has %li unknown back tile code(s), the"
+			" first at row %li, column %li.", lUnknownTiles,
+			lFirstUnknown / (long)ulWidthV + 1,
+			lFirstUnknown % (long)ulWidthV + 1);
+		ValidateAdd (stVal, sLine);
+	}
+
+	/*** unknown, 0x00 0x00 and front types ***/
+	ulNrRecords = ValidateRead (stVal, 2);
+	if (ulNrRecords > MAX_UNKNOWN)
+	{
+		snprintf (sLine, MAX_WARNING, "has %lu unknown records, max %i.",
+			ulNrRecords, MAX_UNKNOWN);
+		ValidateAdd (stVal, sLine);
+	}
+	for (lLoop = 0; lLoop < (long)ulNrRecords * 4; lLoop++)
+		{ ValidateRead (stVal, 1); }
+	ValidateRead (stVal, 2);
+	ulFrontTypesV = ValidateRead (stVal, 2);
+	if (ulFrontTypesV > MAX_FRONT_TYPE)
+	{
+		snprintf (sLine, MAX_WARNING, "has %lu front types, max %i.",
+			ulFrontTypesV, MAX_FRONT_TYPE);
+		ValidateAdd (stVal, sLine);
+	}
+	for (lLoop = 0; lLoop < (long)ulFrontTypesV * 3; lLoop++)
+		{ ValidateRead (stVal, 1); }
+
+	/*** front, the points, and chompers to loose ***/
+	for (iKind = KIND_FRONT; iKind <= KIND_LOOSE; iKind++)
+	{
+		if (iKind == KIND_CHOMPERS)
+		{
+			for (iPoint = 0; iPoint < 5; iPoint++)
+			{
+				ulX = ValidateRead (stVal, 2);
+				ulY = ValidateRead (stVal, 2);
+				if ((ulX >= ulWidthV * 16) || (ulY >= ulHeightV * 24))
+				{
+					snprintf (sLine, MAX_WARNING, "the %s is outside the level"
+						" (X %lu, Y %lu).", sPoint[iPoint], ulX, ulY);
+					ValidateAdd (stVal, sLine);
+				}
+			}
+		}
+
+		ulNr[iKind] = ValidateRead (stVal, 2);
+		if ((int)ulNr[iKind] < kind[iKind].iMin)
+		{
+			snprintf (sLine, MAX_WARNING, "needs at least %i %s, has %lu.",
+				kind[iKind].iMin, kind[iKind].sPlural, ulNr[iKind]);
+			ValidateAdd (stVal, sLine);
+		}
+		if (ulNr[iKind] > MAX_PER_KIND)
+		{
+			snprintf (sLine, MAX_WARNING, "has %lu %s, max %i.",
+				ulNr[iKind], kind[iKind].sPlural, MAX_PER_KIND);
+			ValidateAdd (stVal, sLine);
+		}
+		for (ulObject = 1; ulObject <= ulNr[iKind]; ulObject++)
+		{
+			ulX = 0;
+			ulY = 0;
+			for (iField = 0; iField < kind[iKind].iFields; iField++)
+			{
+				switch (kind[iKind].iField[iField])
+				{
+					case FIELD_X:
+						ulX = ValidateRead (stVal, kind[iKind].iBytes[iField]); break;
+					case FIELD_Y:
+						ulY = ValidateRead (stVal, kind[iKind].iBytes[iField]); break;
+					default:
+						ulValue[kind[iKind].iField[iField]] =
+							ValidateRead (stVal, kind[iKind].iBytes[iField]);
+						break;
+				}
+			}
+			if ((ulX >= ulWidthV * 16) || (ulY >= ulHeightV * 24))
+			{
+				snprintf (sLine, MAX_WARNING, "%s %lu is outside the level"
+					" (X %lu, Y %lu).", kind[iKind].sName, ulObject, ulX, ulY);
+				ValidateAdd (stVal, sLine);
+			}
+			if ((iKind == KIND_FRONT) &&
+				(ulValue[FIELD_FRONT_TYPE] >= ulFrontTypesV))
+			{
+				snprintf (sLine, MAX_WARNING, "front %lu has type %lu, but there"
+					" are %lu front types.", ulObject, ulValue[FIELD_FRONT_TYPE],
+					ulFrontTypesV);
+				ValidateAdd (stVal, sLine);
+			}
+			/*** The gates come before the raise, in the file. ***/
+			if ((iKind == KIND_RAISE) &&
+				(ulValue[FIELD_RAISE_GATE] >= ulNr[KIND_GATES]))
+			{
+				snprintf (sLine, MAX_WARNING, "raise %lu opens gate %lu, but there"
+					" are %lu gates.", ulObject, ulValue[FIELD_RAISE_GATE],
+					ulNr[KIND_GATES]);
+				ValidateAdd (stVal, sLine);
+			}
+		}
+	}
+
+	/*** 0x00 0x00 and text ***/
+	ValidateRead (stVal, 2);
+	ulNrTextV = ValidateRead (stVal, 2);
+	if (ulNrTextV > MAX_TEXT)
+	{
+		snprintf (sLine, MAX_WARNING, "has %lu bytes of text, max %i.",
+			ulNrTextV, MAX_TEXT);
+		ValidateAdd (stVal, sLine);
+	}
+	iLines = 0;
+	iLineChars = 0;
+	for (lLoop = 0; lLoop < (long)ulNrTextV; lLoop++)
+	{
+		if (ValidateRead (stVal, 1) != '\\')
+		{
+			iLineChars++;
+		} else {
+			iLines++;
+			if (iLineChars > MAX_LINECHARS - 1)
+			{
+				snprintf (sLine, MAX_WARNING, "text line %i has %i characters,"
+					" max %i.", iLines, iLineChars, MAX_LINECHARS - 1);
+				ValidateAdd (stVal, sLine);
+			}
+			iLineChars = 0;
+		}
+	}
+	if (iLines > MAX_LINES)
+	{
+		snprintf (sLine, MAX_WARNING, "has %i text lines, max %i.",
+			iLines, MAX_LINES);
+		ValidateAdd (stVal, sLine);
+	}
+
+	/*** Problems past the end were not added; see ValidateAdd(). ***/
+	if (stVal->iShort == 1)
+	{
+		snprintf (sLine, MAX_WARNING, "the file ends too soon, after %li"
+			" bytes.", stVal->lSize);
+		stVal->iShort = 0;
+		ValidateAdd (stVal, sLine);
+	} else if (stVal->lPos != stVal->lSize) {
+		snprintf (sLine, MAX_WARNING, "the file has %li byte(s) too many.",
+			stVal->lSize - stVal->lPos);
+		ValidateAdd (stVal, sLine);
+	}
+
+	return (stVal->iProblems);
+}
+/*****************************************************************************/
+unsigned long ValidateRead (struct validation *stVal, int iBytes)
+/*****************************************************************************/
+{
+	/*** Like ReadFromFile(), but from stVal->sData. ***/
+
+	unsigned long ulValue;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	if (stVal->lPos + iBytes > stVal->lSize)
+	{
+		stVal->iShort = 1;
+		stVal->lPos = stVal->lSize;
+		return (0);
+	}
+	ulValue = 0;
+	for (iLoop = iBytes - 1; iLoop >= 0; iLoop--)
+		{ ulValue = (ulValue << 8) | stVal->sData[stVal->lPos + iLoop]; }
+	stVal->lPos+=iBytes;
+
+	return (ulValue);
+}
+/*****************************************************************************/
+void ValidateAdd (struct validation *stVal, char *sLine)
+/*****************************************************************************/
+{
+	/* Adds a problem to the report. Once the file ran out, the values are
+	 * made up, so their problems are not real; these are skipped.
+	 */
+
+	int iLength;
+
+	if (stVal->iShort == 1) { return; }
+	stVal->iProblems++;
+	iLength = strlen (stVal->sReport);
+	snprintf (stVal->sReport + iLength, MAX_REPORT - iLength,
+		"[ WARN ] Level %i: %s\n", stVal->iLevel, sLine);
+}
+/*****************************************************************************/
+void ReachMasks (int iRow)
+/*****************************************************************************/
+{
+	/* Sets the bits of row iRow from the back tiles. Empty tiles on a wall
+	 * can be stood on, so this uses row iRow + 1 as well. The columns next
+	 * to the level are walls.
+	 */
+
+	int iClass;
+
+	/*** Used for looping. ***/
+	int iWord;
+	int iColumnLoop;
+
+	for (iWord = 0; iWord < REACH_WORDS; iWord++)
+	{
+		ulReachStand[iRow][iWord] = 0;
+		ulReachClimb[iRow][iWord] = 0;
+		ulReachWall[iRow][iWord] = 0;
+	}
+	if ((iRow < 1) || (iRow > (int)ulHeight)) { return; }
+	ulReachWall[iRow][0] = 1;
+	ulReachWall[iRow][(ulWidth + 1) / 64] |= (Uint64)1 << ((ulWidth + 1) % 64);
+	for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
+	{
+		iClass = TileClass (ulBack[iRow][iColumnLoop]);
+		if ((iClass == TILE_EMPTY) && (iRow < (int)ulHeight) &&
+			(TileClass (ulBack[iRow + 1][iColumnLoop]) == TILE_WALL))
+			{ iClass = TILE_FLOOR; }
+		if (iClass == TILE_CLIMB)
+		{
+			ulReachClimb[iRow][iColumnLoop / 64] |=
+				(Uint64)1 << (iColumnLoop % 64);
+		}
+		if ((iClass == TILE_FLOOR) || (iClass == TILE_CLIMB))
+		{
+			ulReachStand[iRow][iColumnLoop / 64] |=
+				(Uint64)1 << (iColumnLoop % 64);
+		}
+		if (iClass == TILE_WALL)
+		{
+			ulReachWall[iRow][iColumnLoop / 64] |=
+				(Uint64)1 << (iColumnLoop % 64);
+		}
+	}
+}
+/*****************************************************************************/
+void ReachRebuild (void)
+/*****************************************************************************/
+{
+	ReachRows (0, MAX_HEIGHT + 1);
+}
+/*****************************************************************************/
+void ReachRows (int iFirst, int iLast)
+/*****************************************************************************/
+{
+	/*** Redoes the bits of rows iFirst to iLast, after many tiles changed. ***/
+
+	/*** Used for looping. ***/
+	int iRowLoop;
+
+	for (iRowLoop = iFirst; iRowLoop <= iLast; iRowLoop++)
+		{ ReachMasks (iRowLoop); }
+	iReachDirty = 1;
+}
+/*****************************************************************************/
+void ReachTile (int iRow, int iColumn, unsigned long ulOld,
+	unsigned long ulNew)
+/*****************************************************************************/
+{
+	/* Call this when a back tile changes. Only tiles that the last update
+	 * looked at can change what is reachable, and most changes are to or
+	 * from a tile of the same class, so this seldom needs an update.
+	 */
+
+	Uint64 ulBit;
+
+	if (TileClass (ulOld) == TileClass (ulNew)) { return; }
+	ReachMasks (iRow - 1);
+	ReachMasks (iRow);
+	ulBit = (Uint64)1 << (iColumn % 64);
+	if ((ulReachTouched[iRow][iColumn / 64] & ulBit) ||
+		(ulReachTouched[iRow - 1][iColumn / 64] & ulBit))
+		{ iReachDirty = 1; }
+}
+/*****************************************************************************/
+void ReachUpdate (void)
+/*****************************************************************************/
+{
+	/* Finds the tiles that the prince can reach from where he starts. He
+	 * walks, and jumps over at most REACH_JUMP tiles, along a row; falls
+	 * down when he steps on an empty tile; and climbs up two rows to a
+	 * floor next to him, or to a ledge two tiles away. This is generous,
+	 * so that what cannot be reached really cannot. Whole rows are done at
+	 * once; a row is done again when more of it can be reached.
+	 */
+
+	int iRow, iColumn;
+	Uint64 ulSeed[REACH_WORDS];
+
+	/*** Used for looping. ***/
+	int iRowLoop;
+	int iWord;
+
+	if (iReachDirty == 0) { return; }
+	iReachDirty = 0;
+	for (iRowLoop = 0; iRowLoop <= (int)ulHeight + 1; iRowLoop++)
+	{
+		for (iWord = 0; iWord < REACH_WORDS; iWord++)
+		{
+			ulReached[iRowLoop][iWord] = 0;
+			ulReachTouched[iRowLoop][iWord] = 0;
+		}
+		iReachQueued[iRowLoop] = 0;
+	}
+	iReachHead = 0;
+	iReachTail = 0;
+
+	iRow = (ulPrinceY / 24) + 1;
+	iColumn = (ulPrinceX / 16) + 1;
+	if ((iRow > (int)ulHeight) || (iColumn > (int)ulWidth)) { return; }
+	for (iWord = 0; iWord < REACH_WORDS; iWord++) { ulSeed[iWord] = 0; }
+	ulSeed[iColumn / 64] = (Uint64)1 << (iColumn % 64);
+	ReachAdd (iRow, ulSeed);
+	while (iReachHead != iReachTail)
+	{
+		iRow = iReachQueue[iReachHead];
+		iReachHead = (iReachHead + 1) % (MAX_HEIGHT + 2);
+		iReachQueued[iRow] = 0;
+		ReachRow (iRow);
+	}
+}
+/*****************************************************************************/
+void ReachRow (int iRow)
+/*****************************************************************************/
+{
+	/*** Where the prince can go from the reached tiles of row iRow. ***/
+
+	Uint64 ulStep[REACH_WORDS]; /*** One tile away. ***/
+	Uint64 ulSpread[REACH_WORDS]; /*** At most REACH_JUMP tiles away. ***/
+	Uint64 ulFrom[REACH_WORDS];
+	Uint64 ulTo[REACH_WORDS];
+	Uint64 ulAdd[REACH_WORDS];
+	Uint64 ulNear[REACH_WORDS];
+	int iMore;
+	int iDirection;
+
+	/*** Used for looping. ***/
+	int iWord;
+	int iTile;
+	int iRowLoop;
+
+	/*** walk and jump, until nothing is added ***/
+	do {
+		for (iWord = 0; iWord < REACH_WORDS; iWord++)
+		{
+			ulStep[iWord] = 0;
+			ulSpread[iWord] = 0;
+		}
+		for (iDirection = -1; iDirection <= 1; iDirection+=2)
+		{
+			for (iWord = 0; iWord < REACH_WORDS; iWord++)
+				{ ulFrom[iWord] = ulReached[iRow][iWord]; }
+			for (iTile = 1; iTile <= REACH_JUMP; iTile++)
+			{
+				ReachShift (ulFrom, ulTo, iDirection);
+				for (iWord = 0; iWord < REACH_WORDS; iWord++)
+				{
+					ulReachTouched[iRow][iWord] |= ulTo[iWord];
+					ulFrom[iWord] = ulTo[iWord] & ~ulReachWall[iRow][iWord];
+					if (iTile == 1) { ulStep[iWord] |= ulFrom[iWord]; }
+					ulSpread[iWord] |= ulFrom[iWord];
+				}
+			}
+		}
+		iMore = 0;
+		for (iWord = 0; iWord < REACH_WORDS; iWord++)
+		{
+			ulReachTouched[iRow][iWord] |= ulReached[iRow][iWord];
+			ulAdd[iWord] = ulSpread[iWord] & ulReachStand[iRow][iWord] &
+				~ulReached[iRow][iWord];
+			if (ulAdd[iWord] != 0) { iMore = 1; }
+			ulReached[iRow][iWord] |= ulAdd[iWord];
+		}
+	} while (iMore == 1);
+
+	/*** fall, from the empty tiles next to a reached tile ***/
+	iMore = 0;
+	for (iWord = 0; iWord < REACH_WORDS; iWord++)
+	{
+		ulFrom[iWord] = ulStep[iWord] & ~ulReachStand[iRow][iWord];
+		if (ulFrom[iWord] != 0) { iMore = 1; }
+	}
+	for (iRowLoop = iRow + 1; (iRowLoop <= (int)ulHeight) && (iMore == 1);
+		iRowLoop++)
+	{
+		iMore = 0;
+		for (iWord = 0; iWord < REACH_WORDS; iWord++)
+		{
+			ulReachTouched[iRowLoop][iWord] |= ulFrom[iWord];
+			ulAdd[iWord] = ulFrom[iWord] & ulReachStand[iRowLoop][iWord];
+			ulFrom[iWord] &= ~ulReachStand[iRowLoop][iWord] &
+				~ulReachWall[iRowLoop][iWord];
+			if (ulFrom[iWord] != 0) { iMore = 1; }
+		}
+		ReachAdd (iRowLoop, ulAdd);
+	}
+
+	/*** climb, to a floor next to him or a ledge two tiles away ***/
+	if (iRow < 3) { return; }
+	for (iWord = 0; iWord < REACH_WORDS; iWord++)
+	{
+		ulReachTouched[iRow - 1][iWord] |= ulReached[iRow][iWord];
+		ulFrom[iWord] = ulReached[iRow][iWord] & ~ulReachWall[iRow - 1][iWord];
+		ulNear[iWord] = ulFrom[iWord];
+	}
+	ReachShift (ulFrom, ulTo, -1);
+	for (iWord = 0; iWord < REACH_WORDS; iWord++) { ulNear[iWord] |= ulTo[iWord]; }
+	ReachShift (ulFrom, ulTo, 1);
+	for (iWord = 0; iWord < REACH_WORDS; iWord++)
+	{
+		ulNear[iWord] |= ulTo[iWord];
+		ulAdd[iWord] = ulNear[iWord] & ulReachStand[iRow - 2][iWord];
+	}
+	ReachShift (ulNear, ulTo, -1);
+	for (iWord = 0; iWord < REACH_WORDS; iWord++) { ulNear[iWord] |= ulTo[iWord]; }
+	ReachShift (ulNear, ulTo, 1);
+	for (iWord = 0; iWord < REACH_WORDS; iWord++)
+	{
+		ulNear[iWord] |= ulTo[iWord];
+		ulReachTouched[iRow - 2][iWord] |= ulNear[iWord];
+		ulAdd[iWord] |= ulNear[iWord] & ulReachClimb[iRow - 2][iWord];
+	}
+	ReachAdd (iRow - 2, ulAdd);
+}
+/*****************************************************************************/
+void ReachAdd (int iRow, Uint64 *ulAdd)
+/*****************************************************************************/
+{
+	/*** Marks ulAdd as reached; queues iRow if that is new. ***/
+
+	int iNew;
+
+	/*** Used for looping. ***/
+	int iWord;
+
+	iNew = 0;
+	for (iWord = 0; iWord < REACH_WORDS; iWord++)
+	{
+		if ((ulAdd[iWord] & ~ulReached[iRow][iWord]) != 0) { iNew = 1; }
+		ulReached[iRow][iWord] |= ulAdd[iWord];
+	}
+	if ((iNew == 1) && (iReachQueued[iRow] == 0))
+	{
+		iReachQueue[iReachTail] = iRow;
+		iReachTail = (iReachTail + 1) % (MAX_HEIGHT + 2);
+		iReachQueued[iRow] = 1;
+	}
+}
+/*****************************************************************************/
+void ReachShift (Uint64 *ulFrom, Uint64 *ulTo, int iDirection)
+/*****************************************************************************/
+{
+	/*** Moves all bits one column; iDirection is -1 or 1. ***/
+
+	/*** Used for looping. ***/
+	int iWord;
+
+	for (iWord = 0; iWord < REACH_WORDS; iWord++)
+	{
+		if (iDirection == 1)
+		{
+			ulTo[iWord] = ulFrom[iWord] << 1;
+			if (iWord > 0) { ulTo[iWord] |= ulFrom[iWord - 1] >> 63; }
+		} else {
+			ulTo[iWord] = ulFrom[iWord] >> 1;
+			if (iWord < REACH_WORDS - 1) { ulTo[iWord] |= ulFrom[iWord + 1] << 63; }
+		}
+	}
+}
+/*****************************************************************************/
+int ReachAt (unsigned long ulX, unsigned long ulY)
+/*****************************************************************************/
+{
+	/*** Returns 1 if the tile at ulX, ulY can be reached. ***/
+
+	int iRow, iColumn;
+
+	iRow = (ulY / 24) + 1;
+	iColumn = (ulX / 16) + 1;
+	if ((iRow > (int)ulHeight) || (iColumn > (int)ulWidth)) { return (0); }
+	if (ulReached[iRow][iColumn / 64] & ((Uint64)1 << (iColumn % 64)))
+		{ return (1); }
+	return (0);
+}
+/*****************************************************************************/
+int ReachIsolated (void)
+/*****************************************************************************/
+{
+	/*** Returns the number of guards that cannot be reached. ***/
+
+	int iIsolated;
+	int iSlot;
+
+	iIsolated = 0;
+	for (iSlot = ent[KIND_GUARDS].iFirst; iSlot != -1;
+		iSlot = ent[KIND_GUARDS].arEnt[iSlot].iNext)
+	{
+		if (ReachAt (ent[KIND_GUARDS].arEnt[iSlot].ulX,
+			ent[KIND_GUARDS].arEnt[iSlot].ulY) == 0) { iIsolated++; }
+	}
+
+	return (iIsolated);
+}
+/*****************************************************************************/
+void ReachMark (unsigned long ulX, unsigned long ulY)
+/*****************************************************************************/
+{
+	/*** Fills the tile at ulX, ulY if it cannot be reached. ***/
+
+	SDL_Rect markbox;
+
+	if (ReachAt (ulX, ulY) == 1) { return; }
+	markbox.x = iMapStartX + ((ulX / 16) * 16 * iZoom);
+	markbox.y = iMapStartY + ((ulY / 24) * 24 * iZoom);
+	markbox.w = 16 * iZoom;
+	markbox.h = 24 * iZoom;
+	SDL_RenderFillRect (ascreen, &markbox);
+}
+/*****************************************************************************/
+void LinkRebuild (void)
+/*****************************************************************************/
+{
+	int iNr;
+	int iSlot;
+
+	iNr = 0;
+	for (iSlot = ent[KIND_GATES].iFirst; iSlot != -1;
+		iSlot = ent[KIND_GATES].arEnt[iSlot].iNext)
+	{
+		iGateNr[iSlot] = iNr;
+		iGateSlot[iNr] = iSlot;
+		iLinkFirst[iSlot] = -1;
+		iNr++;
+	}
+	iLinkLoose = -1;
+	for (iSlot = ent[KIND_RAISE].iFirst; iSlot != -1;
+		iSlot = ent[KIND_RAISE].arEnt[iSlot].iNext) { LinkPlate (iSlot); }
+}
+/*****************************************************************************/
+void LinkAdd (int iKind, int iSlot)
+/*****************************************************************************/
+{
+	/*** Call after EntAdd() or EntRestore(). ***/
+
+	int iPrev;
+	int iGate;
+
+	if (iKind == KIND_RAISE) { LinkPlate (iSlot); return; }
+	if (iKind != KIND_GATES) { return; }
+
+	/*** The gates after it, and their plates, move up by one. ***/
+	for (iGate = ent[KIND_GATES].arEnt[iSlot].iNext; iGate != -1;
+		iGate = ent[KIND_GATES].arEnt[iGate].iNext)
+		{ LinkRenumber (iGate, iGateNr[iGate] + 1); }
+	iPrev = ent[KIND_GATES].arEnt[iSlot].iPrev;
+	iLinkFirst[iSlot] = -1;
+	LinkRenumber (iSlot, (iPrev == -1) ? 0 : iGateNr[iPrev] + 1);
+
+	LinkLoose ((int)ent[KIND_GATES].ulNr);
+}
+/*****************************************************************************/
+void LinkDel (int iKind, int iSlot)
+/*****************************************************************************/
+{
+	/*** Call before EntDel(). ***/
+
+	int iGate;
+	int iPlate;
+
+	if (iKind == KIND_RAISE) { LinkUnplate (iSlot); return; }
+	if (iKind != KIND_GATES) { return; }
+
+	/*** The gates after it, and their plates, move down by one. ***/
+	for (iGate = ent[KIND_GATES].arEnt[iSlot].iNext; iGate != -1;
+		iGate = ent[KIND_GATES].arEnt[iGate].iNext)
+		{ LinkRenumber (iGate, iGateNr[iGate] - 1); }
+
+	/*** Its own plates become loose. ***/
+	while (iLinkFirst[iSlot] != -1)
+	{
+		iPlate = iLinkFirst[iSlot];
+		LinkUnplate (iPlate);
+		iLinkGate[iPlate] = -1;
+		iLinkPrev[iPlate] = -1;
+		iLinkNext[iPlate] = iLinkLoose;
+		if (iLinkLoose != -1) { iLinkPrev[iLinkLoose] = iPlate; }
+		iLinkLoose = iPlate;
+	}
+
+	LinkLoose ((int)ent[KIND_GATES].ulNr - 1);
+}
+/*****************************************************************************/
+void LinkPlate (int iPlate)
+/*****************************************************************************/
+{
+	/*** Adds plate iPlate to the list of the gate it opens. ***/
+
+	unsigned long ulGate;
+	int *iHead;
+
+	ulGate = ent[KIND_RAISE].arEnt[iPlate].ulField[FIELD_RAISE_GATE];
+	if (ulGate < ent[KIND_GATES].ulNr)
+	{
+		iLinkGate[iPlate] = iGateSlot[ulGate];
+		iHead = &iLinkFirst[iGateSlot[ulGate]];
+	} else {
+		iLinkGate[iPlate] = -1;
+		iHead = &iLinkLoose;
+	}
+	iLinkPrev[iPlate] = -1;
+	iLinkNext[iPlate] = *iHead;
+	if (*iHead != -1) { iLinkPrev[*iHead] = iPlate; }
+	*iHead = iPlate;
+}
+/*****************************************************************************/
+void LinkUnplate (int iPlate)
+/*****************************************************************************/
+{
+	if (iLinkPrev[iPlate] != -1)
+	{
+		iLinkNext[iLinkPrev[iPlate]] = iLinkNext[iPlate];
+	} else if (iLinkGate[iPlate] != -1) {
+		iLinkFirst[iLinkGate[iPlate]] = iLinkNext[iPlate];
+	} else {
+		iLinkLoose = iLinkNext[iPlate];
+	}
+	if (iLinkNext[iPlate] != -1)
+		{ iLinkPrev[iLinkNext[iPlate]] = iLinkPrev[iPlate]; }
+}
+/*****************************************************************************/
+void LinkRenumber (int iGate, int iNr)
+/*****************************************************************************/
+{
+	/*** Gives gate iGate number iNr, and updates the plates that open it. ***/
+
+	int iPlate;
+
+	iGateNr[iGate] = iNr;
+	iGateSlot[iNr] = iGate;
+	for (iPlate = iLinkFirst[iGate]; iPlate != -1; iPlate = iLinkNext[iPlate])
+	{
+		ent[KIND_RAISE].arEnt[iPlate].ulField[FIELD_RAISE_GATE] =
+			(unsigned long)iNr;
+	}
+}
+/*****************************************************************************/
+void LinkLoose (int iGates)
+/*****************************************************************************/
+{
+	/*** Links loose plates whose gate is one of the first iGates. ***/
+
+	int iPlate, iNext;
+
+	for (iPlate = iLinkLoose; iPlate != -1; iPlate = iNext)
+	{
+		iNext = iLinkNext[iPlate];
+		if (ent[KIND_RAISE].arEnt[iPlate].ulField[FIELD_RAISE_GATE] <
+			(unsigned long)iGates)
+		{
+			LinkUnplate (iPlate);
+			LinkPlate (iPlate);
+		}
+	}
+}
+/*****************************************************************************/
+int LinkCount (int iGate)
+/*****************************************************************************/
+{
+	/*** Returns the number of plates that open gate iGate. ***/
+
+	int iCount;
+	int iPlate;
+
+	iCount = 0;
+	for (iPlate = iLinkFirst[iGate]; iPlate != -1; iPlate = iLinkNext[iPlate])
+		{ iCount++; }
+
+	return (iCount);
+}
+/*****************************************************************************/
+void ShowLinks (void)
+/*****************************************************************************/
+{
+	/*** Draws a line from every raise plate to the gate it opens. ***/
+
+	int iPlate;
+	struct entity *stPlate, *stGate;
+
+	SDL_SetRenderDrawColor (ascreen, 0x00, 0xff, 0x00, SDL_ALPHA_OPAQUE);
+	for (iPlate = ent[KIND_RAISE].iFirst; iPlate != -1;
+		iPlate = stPlate->iNext)
+	{
+		stPlate = &ent[KIND_RAISE].arEnt[iPlate];
+		if (iLinkGate[iPlate] == -1) { continue; }
+		stGate = &ent[KIND_GATES].arEnt[iLinkGate[iPlate]];
+		SDL_RenderDrawLine (ascreen,
+			iMapStartX + (stPlate->ulX * iZoom),
+			iMapStartY + (((int)stPlate->ulY - 7) * iZoom),
+			iMapStartX + (stGate->ulX * iZoom),
+			iMapStartY + (((int)stGate->ulY - 23) * iZoom));
+	}
+}
+/*****************************************************************************/
+int ShotLevels (int iFirst, int iLast)
+/*****************************************************************************/
+{
+	/* Writes pictures of levels iFirst to iLast to DIR_EXPORT, at zoom
+	 * iShotZoom, without a window. The levels are loaded here, one by one;
+	 * each is then drawn and written by its own thread, while the next one
+	 * loads. Returns how many pictures could not be written.
+	 */
+
+	SDL_Thread *thread[MAX_LEVEL + 2];
+	int iFailed;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	ShotLoad();
+	for (iLoop = iFirst; iLoop <= iLast; iLoop++)
+	{
+		LevelLoad (iLoop);
+		shot[iLoop].iLevel = iLoop;
+		ShotPlan (&shot[iLoop]);
+		thread[iLoop] = SDL_CreateThread (ShotThread, "Shot", &shot[iLoop]);
+		/*** Without threads, just write it now. ***/
+		if (thread[iLoop] == NULL) { ShotThread (&shot[iLoop]); }
+	}
+	iFailed = 0;
+	for (iLoop = iFirst; iLoop <= iLast; iLoop++)
+	{
+		if (thread[iLoop] != NULL) { SDL_WaitThread (thread[iLoop], NULL); }
+		if (strcmp (shot[iLoop].sError, "") != 0)
+		{
+			printf ("[ WARN ] %s\n", shot[iLoop].sError);
+			iFailed++;
+		} else if (iDebug == 1) {
+			printf ("[  OK  ] Wrote \"%s\".\n", shot[iLoop].sFile);
+		}
+		free (shot[iLoop].sBack);
+		free (shot[iLoop].op);
+		free (shot[iLoop].iRowFirst);
+		free (shot[iLoop].iRowOp);
+	}
+
+	return (iFailed);
+}
+/*****************************************************************************/
+void ShotLoad (void)
+/*****************************************************************************/
+{
+	char sBack[MAX_FILE + 2];
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	for (iLoop = 0; iLoop <= 55; iLoop++)
+	{
+		snprintf (sBack, MAX_FILE, "%02X.png", iLoop);
+		shotback[iLoop] = ShotSurface (PNG_BACK, sBack);
+	}
+	for (iLoop = 0; shotimage[iLoop].sInfo != NULL; iLoop++)
+	{
+		shotimage[iLoop].surface = ShotSurface (shotimage[iLoop].sPath,
+			shotimage[iLoop].sPNG);
+	}
+}
+/*****************************************************************************/
+SDL_Surface *ShotSurface (char *sPath, char *sPNG)
+/*****************************************************************************/
+{
+	char sImage[MAX_IMG + 2];
+	SDL_Surface *loaded;
+	SDL_Surface *converted;
+
+	snprintf (sImage, MAX_IMG, "png%s%s%s%s", SLASH, sPath, SLASH, sPNG);
+	loaded = IMG_Load_RW (AssetOpen (sImage), 1);
+	if (loaded == NULL)
+	{
+		snprintf (sError, MAX_ERROR, "Could not load \"%s\": %s!",
+			sImage, IMG_GetError());
+		ErrorAndExit();
+	}
+	converted = SDL_ConvertSurfaceFormat (loaded, SDL_PIXELFORMAT_RGBA32, 0);
+	SDL_FreeSurface (loaded);
+	if (converted == NULL)
+	{
+		snprintf (sError, MAX_ERROR, "Could not convert \"%s\": %s!",
+			sImage, SDL_GetError());
+		ErrorAndExit();
+	}
+
+	return (converted);
+}
+/*****************************************************************************/
+void ShotPlan (struct shot *stShot)
+/*****************************************************************************/
+{
+	/* Copies what the loaded level looks like to stShot: the back tiles,
+	 * and the images on top of them, in the order of ShowFrontTiles(). Each
+	 * tile row gets a list of the images that cover it.
+	 */
+
+	int iMax;
+	int iKind, iSlot;
+	struct entity *stEnt;
+	char sImageInfo[MAX_IMG + 2];
+	int iOffsetX, iOffsetY;
+	int iTop, iBottom;
+	int *iRowNext;
+
+	/*** Used for looping. ***/
+	int iLoop;
+	int iRowLoop, iColumnLoop;
+
+	stShot->iWidth = (int)ulWidth;
+	stShot->iHeight = (int)ulHeight;
+	iMax = 5;
+	for (iKind = 1; iKind <= MAX_KINDS; iKind++) { iMax+=ent[iKind].ulNr; }
+	stShot->sBack = malloc (stShot->iWidth * stShot->iHeight);
+	stShot->op = malloc (iMax * sizeof (struct shotop));
+	stShot->iRowFirst = calloc (stShot->iHeight + 1, sizeof (int));
+	iRowNext = malloc ((stShot->iHeight + 1) * sizeof (int));
+	if ((stShot->sBack == NULL) || (stShot->op == NULL) ||
+		(stShot->iRowFirst == NULL) || (iRowNext == NULL))
+	{
+		snprintf (sError, MAX_ERROR, "Could not allocate level %i!",
+			stShot->iLevel);
+		ErrorAndExit();
+	}
+
+	for (iRowLoop = 1; iRowLoop <= stShot->iHeight; iRowLoop++)
+	{
+		for (iColumnLoop = 1; iColumnLoop <= stShot->iWidth; iColumnLoop++)
+		{
+			stShot->sBack[((iRowLoop - 1) * stShot->iWidth) + iColumnLoop - 1] =
+				(unsigned char)ulBack[iRowLoop][iColumnLoop];
+		}
+	}
+
+	stShot->iOps = 0;
+	ShotAdd (stShot, "imgentrance", (int)ulEntranceImageX - 19,
+		(int)ulEntranceImageY - 33);
+	ShotAdd (stShot, "imgexit", (int)ulExitImageX - 19,
+		(int)ulExitImageY - 33);
+	ShotAdd (stShot, "imgprincer", (int)ulPrinceX - 3, (int)ulPrinceY - 26);
+	ShotAdd (stShot, "imgexittrigger", (int)ulExitTriggerX - 9,
+		(int)ulExitTriggerY - 9);
+	ShotAdd (stShot, "imgsavetrigger", (int)ulSaveTriggerX - 9,
+		(int)ulSaveTriggerY - 9);
+	for (iLoop = 0; iLoop < MAX_KINDS; iLoop++)
+	{
+		iKind = iDrawOrder[iLoop];
+		for (iSlot = ent[iKind].iFirst; iSlot != -1; iSlot = stEnt->iNext)
+		{
+			stEnt = &ent[iKind].arEnt[iSlot];
+			EntityImage (iKind, stEnt, sImageInfo, &iOffsetX, &iOffsetY);
+			if (strcmp (sImageInfo, "") == 0) { continue; }
+			ShotAdd (stShot, sImageInfo, (int)stEnt->ulX - iOffsetX,
+				(int)stEnt->ulY - iOffsetY);
+		}
+	}
+
+	/*** Count the images per tile row, then list them. ***/
+	for (iLoop = 0; iLoop < stShot->iOps; iLoop++)
+	{
+		iTop = stShot->op[iLoop].iY;
+		iBottom = iTop +
+			shotimage[stShot->op[iLoop].iImage].surface->h - 1;
+		if ((iBottom < 0) || (iTop >= stShot->iHeight * 24)) { continue; }
+		if (iTop < 0) { iTop = 0; }
+		if (iBottom >= stShot->iHeight * 24)
+			{ iBottom = (stShot->iHeight * 24) - 1; }
+		for (iRowLoop = iTop / 24; iRowLoop <= iBottom / 24; iRowLoop++)
+			{ stShot->iRowFirst[iRowLoop + 1]++; }
+	}
+	for (iRowLoop = 0; iRowLoop < stShot->iHeight; iRowLoop++)
+	{
+		stShot->iRowFirst[iRowLoop + 1]+=stShot->iRowFirst[iRowLoop];
+		iRowNext[iRowLoop] = stShot->iRowFirst[iRowLoop];
+	}
+	stShot->iRowOp = malloc ((stShot->iRowFirst[stShot->iHeight] + 1) *
+		sizeof (int));
+	if (stShot->iRowOp == NULL)
+	{
+		snprintf (sError, MAX_ERROR, "Could not allocate level %i!",
+			stShot->iLevel);
+		ErrorAndExit();
+	}
+	for (iLoop = 0; iLoop < stShot->iOps; iLoop++)
+	{
+		iTop = stShot->op[iLoop].iY;
+		iBottom = iTop +
+			shotimage[stShot->op[iLoop].iImage].surface->h - 1;
+		if ((iBottom < 0) || (iTop >= stShot->iHeight * 24)) { continue; }
+		if (iTop < 0) { iTop = 0; }
+		if (iBottom >= stShot->iHeight * 24)
+			{ iBottom = (stShot->iHeight * 24) - 1; }
+		for (iRowLoop = iTop / 24; iRowLoop <= iBottom / 24; iRowLoop++)
+		{
+			stShot->iRowOp[iRowNext[iRowLoop]] = iLoop;
+			iRowNext[iRowLoop]++;
+		}
+	}
+	free (iRowNext);
+}
+/*****************************************************************************/
+void ShotAdd (struct shot *stShot, char *sInfo, int iX, int iY)
+/*****************************************************************************/
+{
+	struct shotop *stOp;
+	int iImage;
+
+	for (iImage = 0; shotimage[iImage].sInfo != NULL; iImage++)
+		{ if (strcmp (shotimage[iImage].sInfo, sInfo) == 0) { break; } }
+	if (shotimage[iImage].sInfo == NULL) { return; }
+
+	stOp = &stShot->op[stShot->iOps];
+	stOp->iImage = iImage;
+	stOp->iX = iX;
+	stOp->iY = iY;
+	stOp->iWidth = shotimage[iImage].surface->w;
+	/*** Only the first frame; see ShowImage(). ***/
+	if (strcmp (sInfo, "imgtorchsprite") == 0) { stOp->iWidth/=5; }
+	stShot->iOps++;
+}
+/*****************************************************************************/
+int ShotThread (void *data)
+/*****************************************************************************/
+{
+	/* Draws and writes one level picture. This runs next to other threads,
+	 * so it must not touch the globals or exit; problems go in sError.
+	 */
+
+	struct shot *stShot;
+	FILE *fOut;
+	int iError;
+
+	stShot = (struct shot *)data;
+	snprintf (stShot->sError, MAX_ERROR, "%s", "");
+	snprintf (stShot->sFile, MAX_PATHFILE, "%s%s%i.png",
+		DIR_EXPORT, SLASH, stShot->iLevel);
+	fOut = fopen (stShot->sFile, "wb");
+	if (fOut == NULL)
+	{
+		snprintf (stShot->sError, MAX_ERROR, "Could not open \"%s\": %s!",
+			stShot->sFile, strerror (errno));
+		return (0);
+	}
+	iError = ShotWrite (stShot, fOut);
+	if (ferror (fOut) != 0) { iError = 1; }
+	if (fclose (fOut) != 0) { iError = 1; }
+	if ((iError != 0) && (strcmp (stShot->sError, "") == 0))
+	{
+		snprintf (stShot->sError, MAX_ERROR, "Could not write \"%s\"!",
+			stShot->sFile);
+	}
+
+	return (0);
+}
+/*****************************************************************************/
+int ShotWrite (struct shot *stShot, FILE *fOut)
+/*****************************************************************************/
+{
+	/* Writes the PNG one tile row at a time, so that even the largest
+	 * levels only need a strip of 24 pixel rows in memory. Returns 0 if
+	 * fine.
+	 */
+
+	unsigned char sHeader[13 + 2];
+	unsigned char *sRGB;
+	unsigned char *sLine;
+	unsigned char *sOut;
+	unsigned char *sFrom, *sTo;
+	z_stream stream;
+	int iPixels, iLineBytes;
+	int iResult;
+	int iError;
+
+	/*** Used for looping. ***/
+	int iRowLoop, iYLoop, iXLoop, iZoomLoop;
+
+	iPixels = stShot->iWidth * 16;
+	iLineBytes = 1 + (iPixels * iShotZoom * 3);
+	sRGB = malloc (iPixels * 24 * 3);
+	sLine = malloc (iLineBytes);
+	sOut = malloc (SHOT_CHUNK);
+	memset (&stream, 0, sizeof (stream));
+	if ((sRGB == NULL) || (sLine == NULL) || (sOut == NULL) ||
+		(deflateInit (&stream, Z_DEFAULT_COMPRESSION) != Z_OK))
+	{
+		snprintf (stShot->sError, MAX_ERROR, "Could not allocate \"%s\"!",
+			stShot->sFile);
+		free (sRGB); free (sLine); free (sOut);
+		return (1);
+	}
+
+	/*** signature and header ***/
+	iError = 0;
+	if (fwrite ("\x89PNG\r\n\x1a\n", 1, 8, fOut) != 8) { iError = 1; }
+	sHeader[0] = (iPixels * iShotZoom) >> 24;
+	sHeader[1] = (iPixels * iShotZoom) >> 16;
+	sHeader[2] = (iPixels * iShotZoom) >> 8;
+	sHeader[3] = (iPixels * iShotZoom) & 0xFF;
+	sHeader[4] = (stShot->iHeight * 24 * iShotZoom) >> 24;
+	sHeader[5] = (stShot->iHeight * 24 * iShotZoom) >> 16;
+	sHeader[6] = (stShot->iHeight * 24 * iShotZoom) >> 8;
+	sHeader[7] = (stShot->iHeight * 24 * iShotZoom) & 0xFF;
+	sHeader[8] = 8; /*** bit depth ***/
+	sHeader[9] = 2; /*** RGB ***/
+	sHeader[10] = 0; sHeader[11] = 0; sHeader[12] = 0;
+	iError|=ShotChunk (fOut, "IHDR", sHeader, 13);
+
+	/*** image data; each line starts with filter type 0 ***/
+	stream.next_out = sOut;
+	stream.avail_out = SHOT_CHUNK;
+	sLine[0] = 0;
+	for (iRowLoop = 0; iRowLoop < stShot->iHeight; iRowLoop++)
+	{
+		ShotRow (stShot, iRowLoop, sRGB);
+		for (iYLoop = 0; iYLoop < 24; iYLoop++)
+		{
+			sFrom = sRGB + (iYLoop * iPixels * 3);
+			sTo = sLine + 1;
+			for (iXLoop = 0; iXLoop < iPixels; iXLoop++)
+			{
+				for (iZoomLoop = 0; iZoomLoop < iShotZoom; iZoomLoop++)
+				{
+					sTo[0] = sFrom[0]; sTo[1] = sFrom[1]; sTo[2] = sFrom[2];
+					sTo+=3;
+				}
+				sFrom+=3;
+			}
+			for (iZoomLoop = 0; iZoomLoop < iShotZoom; iZoomLoop++)
+			{
+				stream.next_in = sLine;
+				stream.avail_in = iLineBytes;
+				while (stream.avail_in != 0)
+				{
+					deflate (&stream, Z_NO_FLUSH);
+					if (stream.avail_out == 0)
+					{
+						iError|=ShotChunk (fOut, "IDAT", sOut, SHOT_CHUNK);
+						stream.next_out = sOut;
+						stream.avail_out = SHOT_CHUNK;
+					}
+				}
+			}
+		}
+	}
+	do {
+		iResult = deflate (&stream, Z_FINISH);
+		if (stream.avail_out != SHOT_CHUNK)
+		{
+			iError|=ShotChunk (fOut, "IDAT", sOut,
+				SHOT_CHUNK - stream.avail_out);
+			stream.next_out = sOut;
+			stream.avail_out = SHOT_CHUNK;
+		}
+	} while (iResult == Z_OK);
+	if (iResult != Z_STREAM_END) { iError = 1; }
+	deflateEnd (&stream);
+	iError|=ShotChunk (fOut, "IEND", NULL, 0);
+
+	free (sRGB);
+	free (sLine);
+	free (sOut);
+
+	return (iError);
+}
+/*****************************************************************************/
+void ShotRow (struct shot *stShot, int iRow, unsigned char *sRGB)
+/*****************************************************************************/
+{
+	/*** Draws the 24 pixel rows of tile row iRow (from 0) to sRGB. ***/
+
+	struct shotop *stOp;
+	int iBack;
+
+	/*** Used for looping. ***/
+	int iLoop;
+	int iColumnLoop;
+
+	memset (sRGB, 0, stShot->iWidth * 16 * 24 * 3);
+	for (iColumnLoop = 0; iColumnLoop < stShot->iWidth; iColumnLoop++)
+	{
+		iBack = stShot->sBack[(iRow * stShot->iWidth) + iColumnLoop];
+		if (iBack > 55) { continue; }
+		ShotDraw (sRGB, iRow * 24, stShot->iWidth * 16, shotback[iBack],
+			iColumnLoop * 16, iRow * 24, 16);
+	}
+	for (iLoop = stShot->iRowFirst[iRow];
+		iLoop < stShot->iRowFirst[iRow + 1]; iLoop++)
+	{
+		stOp = &stShot->op[stShot->iRowOp[iLoop]];
+		ShotDraw (sRGB, iRow * 24, stShot->iWidth * 16,
+			shotimage[stOp->iImage].surface, stOp->iX, stOp->iY, stOp->iWidth);
+	}
+}
+/*****************************************************************************/
+void ShotDraw (unsigned char *sRGB, int iBandY, int iBandWidth,
+	SDL_Surface *surface, int iX, int iY, int iWidth)
+/*****************************************************************************/
+{
+	/* Blends the first iWidth columns of surface, placed at iX, iY in the
+	 * level, onto the 24 pixel rows from iBandY that are in sRGB.
+	 */
+
+	int iTop, iBottom, iLeft, iRight;
+	Uint8 *sFrom;
+	unsigned char *sTo;
+	int iAlpha;
+
+	/*** Used for looping. ***/
+	int iYLoop, iXLoop;
+
+	iTop = iY; if (iTop < iBandY) { iTop = iBandY; }
+	iBottom = iY + surface->h; if (iBottom > iBandY + 24) { iBottom = iBandY + 24; }
+	iLeft = iX; if (iLeft < 0) { iLeft = 0; }
+	iRight = iX + iWidth; if (iRight > iBandWidth) { iRight = iBandWidth; }
+
+	for (iYLoop = iTop; iYLoop < iBottom; iYLoop++)
+	{
+		sFrom = (Uint8 *)surface->pixels + ((iYLoop - iY) * surface->pitch) +
+			((iLeft - iX) * 4);
+		sTo = sRGB + ((((iYLoop - iBandY) * iBandWidth) + iLeft) * 3);
+		for (iXLoop = iLeft; iXLoop < iRight; iXLoop++)
+		{
+			iAlpha = sFrom[3];
+			if (iAlpha == 0xFF)
+			{
+				sTo[0] = sFrom[0]; sTo[1] = sFrom[1]; sTo[2] = sFrom[2];
+			} else if (iAlpha != 0) {
+				sTo[0] = ((sFrom[0] * iAlpha) + (sTo[0] * (0xFF - iAlpha))) / 0xFF;
+				sTo[1] = ((sFrom[1] * iAlpha) + (sTo[1] * (0xFF - iAlpha))) / 0xFF;
+				sTo[2] = ((sFrom[2] * iAlpha) + (sTo[2] * (0xFF - iAlpha))) / 0xFF;
+			}
+			sFrom+=4;
+			sTo+=3;
+		}
+	}
+}
+/*****************************************************************************/
+int ShotChunk (FILE *fOut, char *sType, unsigned char *sData, int iLength)
+/*****************************************************************************/
+{
+	/*** Writes one PNG chunk. Returns 0 if fine. ***/
+
+	unsigned char sLength[4 + 2];
+	unsigned char sCRC[4 + 2];
+	uLong ulCRC;
+
+	sLength[0] = iLength >> 24; sLength[1] = iLength >> 16;
+	sLength[2] = iLength >> 8; sLength[3] = iLength & 0xFF;
+	ulCRC = crc32 (0, (unsigned char *)sType, 4);
+	if (iLength != 0) { ulCRC = crc32 (ulCRC, sData, iLength); }
+	sCRC[0] = ulCRC >> 24; sCRC[1] = ulCRC >> 16;
+	sCRC[2] = ulCRC >> 8; sCRC[3] = ulCRC & 0xFF;
+
+	if (fwrite (sLength, 1, 4, fOut) != 4) { return (1); }
+	if (fwrite (sType, 1, 4, fOut) != 4) { return (1); }
+	if ((iLength != 0) && (fwrite (sData, 1, iLength, fOut) != (size_t)iLength))
+		{ return (1); }
+	if (fwrite (sCRC, 1, 4, fOut) != 4) { return (1); }
+
+	return (0);
+}
+/*****************************************************************************/
+void MiniTile (int iRow, int iColumn, unsigned long ulOld,
+	unsigned long ulNew)
+/*****************************************************************************/
+{
+	/*** Call this when a back tile changes. ***/
+
+	if (MiniColor (ulOld) == MiniColor (ulNew)) { return; }
+	if (iMiniFull == 1) { return; }
+	if (iMiniQueued == MAX_MINI_QUEUE) { iMiniFull = 1; return; }
+	iMiniQueue[iMiniQueued] = (iRow * (MAX_WIDTH + 2)) + iColumn;
+	iMiniQueued++;
+}
+/*****************************************************************************/
+void MiniUpdate (void)
+/*****************************************************************************/
+{
+	/* Writes the tiles that changed to imgmini. After loading a level, or
+	 * after very many changes, all tiles are written.
+	 */
+
+	void *pixels;
+	int iPitch;
+	Uint32 *ulPixel;
+	Uint32 ulColor;
+	SDL_Rect tile;
+	int iRow, iColumn;
+
+	/*** Used for looping. ***/
+	int iLoop;
+	int iRowLoop, iColumnLoop;
+
+	if ((imgmini == NULL) || (iMiniWidth != (int)ulWidth) ||
+		(iMiniHeight != (int)ulHeight))
+	{
+		if (imgmini != NULL) { SDL_DestroyTexture (imgmini); }
+		imgmini = SDL_CreateTexture (ascreen, SDL_PIXELFORMAT_ARGB8888,
+			SDL_TEXTUREACCESS_STREAMING, (int)ulWidth, (int)ulHeight);
+		if (imgmini == NULL)
+		{
+			printf ("[ WARN ] SDL_CreateTexture: %s\n", SDL_GetError());
+			iMiniShow = 0;
+			return;
+		}
+		iMiniWidth = (int)ulWidth;
+		iMiniHeight = (int)ulHeight;
+		iMiniFull = 1;
+	}
+
+	if (iMiniFull == 1)
+	{
+		if (SDL_LockTexture (imgmini, NULL, &pixels, &iPitch) != 0)
+		{
+			printf ("[ WARN ] SDL_LockTexture: %s\n", SDL_GetError());
+			return;
+		}
+		for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
+		{
+			ulPixel = (Uint32 *)((Uint8 *)pixels + ((iRowLoop - 1) * iPitch));
+			for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
+				{ ulPixel[iColumnLoop - 1] = MiniColor (ulBack[iRowLoop][iColumnLoop]); }
+		}
+		SDL_UnlockTexture (imgmini);
+		iMiniFull = 0;
+		iMiniQueued = 0;
+		return;
+	}
+
+	for (iLoop = 0; iLoop < iMiniQueued; iLoop++)
+	{
+		iRow = iMiniQueue[iLoop] / (MAX_WIDTH + 2);
+		iColumn = iMiniQueue[iLoop] % (MAX_WIDTH + 2);
+		tile.x = iColumn - 1;
+		tile.y = iRow - 1;
+		tile.w = 1;
+		tile.h = 1;
+		ulColor = MiniColor (ulBack[iRow][iColumn]);
+		SDL_UpdateTexture (imgmini, &tile, &ulColor, 4);
+	}
+	iMiniQueued = 0;
+}
+/*****************************************************************************/
+Uint32 MiniColor (unsigned long ulTile)
+/*****************************************************************************/
+{
+	switch (TileClass (ulTile))
+	{
+		case TILE_FLOOR: return (0xffc08830);
+		case TILE_WALL: return (0xff705018);
+		case TILE_CLIMB: return (0xffe0c060);
+		default: return (0xff181818);
+	}
+}
+/*****************************************************************************/
+void ShowMini (void)
+/*****************************************************************************/
+{
+	/* Shows the level in the lower right corner of the map, with a frame
+	 * around the part that the map shows. If the level does not fit, the
+	 * minimap shows the part around that frame.
+	 */
+
+	int iShowWidth, iShowHeight;
+	int iLeft, iTop, iRight, iBottom;
+	SDL_Rect src;
+	SDL_Rect viewbox;
+
+	MiniUpdate();
+	if (imgmini == NULL) { return; }
+
+	if (((int)ulWidth * 2 <= MINI_WIDTH) && ((int)ulHeight * 2 <= MINI_HEIGHT))
+		{ iMiniScale = 2; } else { iMiniScale = 1; }
+	iShowWidth = (int)ulWidth;
+	if (iShowWidth > MINI_WIDTH / iMiniScale)
+		{ iShowWidth = MINI_WIDTH / iMiniScale; }
+	iShowHeight = (int)ulHeight;
+	if (iShowHeight > MINI_HEIGHT / iMiniScale)
+		{ iShowHeight = MINI_HEIGHT / iMiniScale; }
+
+	/*** The tiles that the map shows. ***/
+	iLeft = (MAP_LEFT - iMapStartX) / (16 * iZoom);
+	iRight = (MAP_LEFT + MAP_WIDTH - iMapStartX + (16 * iZoom) - 1) /
+		(16 * iZoom);
+	if (iRight > (int)ulWidth) { iRight = (int)ulWidth; }
+	iTop = (MAP_TOP - iMapStartY) / (24 * iZoom);
+	iBottom = (MAP_TOP + MAP_HEIGHT - iMapStartY + (24 * iZoom) - 1) /
+		(24 * iZoom);
+	if (iBottom > (int)ulHeight) { iBottom = (int)ulHeight; }
+
+	/*** Keep those in the middle, if the level does not fit. ***/
+	iMiniLeft = ((iLeft + iRight) / 2) - (iShowWidth / 2);
+	if (iMiniLeft > (int)ulWidth - iShowWidth)
+		{ iMiniLeft = (int)ulWidth - iShowWidth; }
+	if (iMiniLeft < 0) { iMiniLeft = 0; }
+	iMiniTop = ((iTop + iBottom) / 2) - (iShowHeight / 2);
+	if (iMiniTop > (int)ulHeight - iShowHeight)
+		{ iMiniTop = (int)ulHeight - iShowHeight; }
+	if (iMiniTop < 0) { iMiniTop = 0; }
+
+	src.x = iMiniLeft;
+	src.y = iMiniTop;
+	src.w = iShowWidth;
+	src.h = iShowHeight;
+	minibox.w = iShowWidth * iMiniScale;
+	minibox.h = iShowHeight * iMiniScale;
+	minibox.x = MAP_LEFT + MAP_WIDTH - minibox.w - 4;
+	minibox.y = MAP_TOP + MAP_HEIGHT - minibox.h - 4;
+	if (SDL_RenderCopy (ascreen, imgmini, &src, &minibox) != 0)
+		{ printf ("[ WARN ] SDL_RenderCopy (imgmini): %s\n", SDL_GetError()); }
+
+	/*** The frame, cut off at the edges of the minimap. ***/
+	if (iLeft < iMiniLeft) { iLeft = iMiniLeft; }
+	if (iRight > iMiniLeft + iShowWidth) { iRight = iMiniLeft + iShowWidth; }
+	if (iTop < iMiniTop) { iTop = iMiniTop; }
+	if (iBottom > iMiniTop + iShowHeight) { iBottom = iMiniTop + iShowHeight; }
+	if ((iRight <= iLeft) || (iBottom <= iTop)) { return; }
+	viewbox.x = minibox.x + ((iLeft - iMiniLeft) * iMiniScale);
+	viewbox.y = minibox.y + ((iTop - iMiniTop) * iMiniScale);
+	viewbox.w = (iRight - iLeft) * iMiniScale;
+	viewbox.h = (iBottom - iTop) * iMiniScale;
+	SDL_SetRenderDrawColor (ascreen, 0xff, 0xff, 0xff, SDL_ALPHA_OPAQUE);
+	SDL_RenderDrawRect (ascreen, &viewbox);
+}
+/*****************************************************************************/
+int MiniAt (void)
+/*****************************************************************************/
+{
+	/*** Returns 1 if the mouse is on the minimap. ***/
+
+	if ((iMiniShow == 0) || (imgmini == NULL)) { return (0); }
+	if ((iXPos >= minibox.x) && (iXPos < minibox.x + minibox.w) &&
+		(iYPos >= minibox.y) && (iYPos < minibox.y + minibox.h))
+		{ return (1); }
+
+	return (0);
+}
+/*****************************************************************************/
+void MiniJump (void)
+/*****************************************************************************/
+{
+	/*** Moves the map to the tile under the mouse on the minimap. ***/
+
+	int iRow, iColumn;
+
+	iColumn = iMiniLeft + ((iXPos - minibox.x) / iMiniScale);
+	iRow = iMiniTop + ((iYPos - minibox.y) / iMiniScale);
+
+	/*** Its middle goes to the middle of the map; see MapStartX(). ***/
+	iXPosDragOffset = ((int)ulPrinceX - ((iColumn * 16) + 8)) * iZoom;
+	iYPosDragOffset = ((int)ulPrinceY - 2 - ((iRow * 24) + 12)) * iZoom;
+}
+/*****************************************************************************/
+void Gallery (void)
+/*****************************************************************************/
+{
+	/* Shows all levels side by side. The thumbnails that are not ready yet
+	 * appear as they are made. Click one to open that level.
+	 */
+
+	int iGallery;
+	int iOpen;
+	SDL_Event event;
+
+	iGallery = 1;
+	iOpen = -1;
+	iGalleryHover = -1;
+
+	PlaySound ("wav/popup.wav");
+	ThumbStart();
+	ShowGallery();
+	while (iGallery == 1)
+	{
+		while (SDL_PollEvent (&event))
+		{
+			switch (event.type)
+			{
+				case SDL_CONTROLLERBUTTONDOWN:
+					/*** Nothing for now. ***/
+					break;
+				case SDL_CONTROLLERBUTTONUP:
+					switch (event.cbutton.button)
+					{
+						case SDL_CONTROLLER_BUTTON_A:
+							iGallery = 0; break;
+					}
+					break;
+				case SDL_KEYDOWN:
+					switch (event.key.keysym.sym)
+					{
+						case SDLK_ESCAPE:
+						case SDLK_KP_ENTER:
+						case SDLK_RETURN:
+						case SDLK_SPACE:
+						case SDLK_o:
+						case SDLK_g:
+							iGallery = 0; break;
+					}
+					break;
+				case SDL_MOUSEMOTION:
+					iXPos = event.motion.x;
+					iYPos = event.motion.y;
+					if (GalleryAt() != iGalleryHover)
+					{
+						iGalleryHover = GalleryAt();
+						if (iGalleryHover != -1)
+						{
+							SDL_SetCursor (curHand);
+						} else {
+							SDL_SetCursor (curArrow);
+						}
+						ShowGallery();
+					}
+					break;
+				case SDL_MOUSEBUTTONDOWN:
+					if (event.button.button == 1)
+					{
+						if (InArea (610, 633, 610 + 85, 633 + 32) == 1) /*** OK ***/
+							{ iGalleryOK = 1; }
+					}
+					ShowGallery();
+					break;
+				case SDL_MOUSEBUTTONUP:
+					iGalleryOK = 0;
+					if (event.button.button == 1)
+					{
+						if (InArea (610, 633, 610 + 85, 633 + 32) == 1) /*** OK ***/
+							{ iGallery = 0; }
+						if (GalleryAt() != -1)
+						{
+							iOpen = GalleryAt();
+							iGallery = 0;
+						}
+					}
+					ShowGallery();
+					break;
+				case SDL_WINDOWEVENT:
+					if (event.window.event == SDL_WINDOWEVENT_EXPOSED)
+						{ ShowGallery(); } break;
+				case SDL_QUIT:
+					Quit(); break;
+			}
+		}
+
+		if (ThumbCollect (0) != 0) { ShowGallery(); }
+
+		/*** prevent CPU eating ***/
+		gamespeed = REFRESH_PROG;
+		while ((SDL_GetTicks() - looptime) < gamespeed)
+		{
+			SDL_Delay (10);
+		}
+		looptime = SDL_GetTicks();
+	}
+	ThumbCollect (1);
+	PlaySound ("wav/popup_close.wav");
+	SDL_SetCursor (curArrow);
+	if ((iOpen != -1) && (iOpen != iCurLevel)) { OpenLevel (iOpen); }
+	ShowScreen();
+}
+/*****************************************************************************/
+void ShowGallery (void)
+/*****************************************************************************/
+{
+	int iX, iY;
+	SDL_Rect src;
+	SDL_Rect dest;
+	SDL_Rect hoverbox;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	/*** background ***/
+	ShowImage (imgblack, 0, 0, "imgblack", ascreen, iScale, 1);
+
+	for (iLoop = 0; iLoop <= MAX_LEVEL; iLoop++)
+	{
+		GalleryCell (iLoop, &iX, &iY);
+		if (thumb[iLoop].img != NULL)
+		{
+			src.x = 0;
+			src.y = 0;
+			src.w = thumb[iLoop].iImgWidth;
+			src.h = thumb[iLoop].iImgHeight;
+			dest.x = iX + ((THUMB_WIDTH - thumb[iLoop].iImgWidth) / 2);
+			dest.y = iY + ((THUMB_HEIGHT - thumb[iLoop].iImgHeight) / 2);
+			dest.w = thumb[iLoop].iImgWidth;
+			dest.h = thumb[iLoop].iImgHeight;
+			CustomRenderCopy (thumb[iLoop].img, &src, &dest, "thumb", 1);
+		}
+		if (iLoop == iGalleryHover)
+		{
+			hoverbox.x = (iX - 2) * iScale;
+			hoverbox.y = (iY - 2) * iScale;
+			hoverbox.w = (THUMB_WIDTH + 4) * iScale;
+			hoverbox.h = (THUMB_HEIGHT + 4) * iScale;
+			SDL_SetRenderDrawColor (ascreen, 0xff, 0xff, 0x00, SDL_ALPHA_OPAQUE);
+			SDL_RenderDrawRect (ascreen, &hoverbox);
+		}
+		if (iLoop == iCurLevel)
+		{
+			snprintf (arText[0], MAX_TEXT, "Level %i (open)", iLoop);
+		} else if (thumb[iLoop].img == NULL) {
+			snprintf (arText[0], MAX_TEXT, "Level %i ...", iLoop);
+		} else {
+			snprintf (arText[0], MAX_TEXT, "Level %i", iLoop);
+		}
+		DisplayText (iX, iY + THUMB_HEIGHT + 4, 11, 1, color_wh, 1);
+	}
+
+	/*** OK ***/
+	switch (iGalleryOK)
+	{
+		case 0: ShowImage (imgok[1], 610, 633, "imgok[1]",
+			ascreen, iScale, 1); break; /*** up ***/
+		case 1: ShowImage (imgok[2], 610, 633, "imgok[2]",
+			ascreen, iScale, 1); break; /*** down ***/
+	}
+
+	/*** refresh screen ***/
+	SDL_RenderPresent (ascreen);
+}
+/*****************************************************************************/
+void GalleryCell (int iLevel, int *iX, int *iY)
+/*****************************************************************************/
+{
+	/*** Three thumbnails per row. ***/
+
+	*iX = 10 + ((iLevel % 3) * (THUMB_WIDTH + 18));
+	*iY = 10 + ((iLevel / 3) * (THUMB_HEIGHT + 34));
+}
+/*****************************************************************************/
+int GalleryAt (void)
+/*****************************************************************************/
+{
+	/*** Returns the level under the mouse, or -1. ***/
+
+	int iX, iY;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	for (iLoop = 0; iLoop <= MAX_LEVEL; iLoop++)
+	{
+		GalleryCell (iLoop, &iX, &iY);
+		if (InArea (iX, iY, iX + THUMB_WIDTH, iY + THUMB_HEIGHT) == 1)
+			{ return (iLoop); }
+	}
+
+	return (-1);
+}
+/*****************************************************************************/
+void ThumbStart (void)
+/*****************************************************************************/
+{
+	/* Starts a thread for each thumbnail that must be made. The loaded
+	 * level is copied here, since it may differ from its file.
+	 */
+
+	struct thumb *stThumb;
+	int iRowLoop, iColumnLoop;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	if (shotback[0] == NULL) { ShotLoad(); }
+	for (iLoop = 0; iLoop <= MAX_LEVEL; iLoop++)
+	{
+		stThumb = &thumb[iLoop];
+		if ((stThumb->iFresh == 1) || (stThumb->iBusy == 1)) { continue; }
+		stThumb->iFresh = 1;
+		stThumb->iBusy = 1;
+		memset (&stThumb->stShot, 0, sizeof (struct shot));
+		stThumb->stShot.iLevel = iLoop;
+		if (iLoop == iCurLevel)
+		{
+			stThumb->stShot.iWidth = (int)ulWidth;
+			stThumb->stShot.iHeight = (int)ulHeight;
+			stThumb->stShot.sBack = malloc ((int)ulWidth * (int)ulHeight);
+			if (stThumb->stShot.sBack != NULL)
+			{
+				for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
+				{
+					for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
+					{
+						stThumb->stShot.sBack[((iRowLoop - 1) * (int)ulWidth) +
+							iColumnLoop - 1] = (unsigned char)ulBack[iRowLoop][iColumnLoop];
+					}
+				}
+			}
+		}
+		SDL_AtomicSet (&stThumb->iDone, 0);
+		stThumb->thread = SDL_CreateThread (ThumbThread, "Thumb", stThumb);
+		/*** Without threads, just make it now. ***/
+		if (stThumb->thread == NULL) { ThumbThread (stThumb); }
+	}
+}
+/*****************************************************************************/
+int ThumbCollect (int iWait)
+/*****************************************************************************/
+{
+	/* Turns the thumbnails that are ready into textures; with iWait 1,
+	 * waits for the others. Returns how many changed.
+	 */
+
+	struct thumb *stThumb;
+	int iChangedThumbs;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	iChangedThumbs = 0;
+	for (iLoop = 0; iLoop <= MAX_LEVEL; iLoop++)
+	{
+		stThumb = &thumb[iLoop];
+		if (stThumb->iBusy == 0) { continue; }
+		if ((iWait == 0) && (SDL_AtomicGet (&stThumb->iDone) == 0)) { continue; }
+		if (stThumb->thread != NULL)
+			{ SDL_WaitThread (stThumb->thread, NULL); stThumb->thread = NULL; }
+		stThumb->iBusy = 0;
+		if (stThumb->ulPixels != NULL)
+		{
+			if ((stThumb->img == NULL) ||
+				(stThumb->iImgWidth != stThumb->iWidth) ||
+				(stThumb->iImgHeight != stThumb->iHeight))
+			{
+				if (stThumb->img != NULL) { SDL_DestroyTexture (stThumb->img); }
+				stThumb->img = SDL_CreateTexture (ascreen, SDL_PIXELFORMAT_ARGB8888,
+					SDL_TEXTUREACCESS_STATIC, stThumb->iWidth, stThumb->iHeight);
+				stThumb->iImgWidth = stThumb->iWidth;
+				stThumb->iImgHeight = stThumb->iHeight;
+			}
+			if (stThumb->img != NULL)
+			{
+				SDL_UpdateTexture (stThumb->img, NULL, stThumb->ulPixels,
+					stThumb->iWidth * 4);
+			} else {
+				printf ("[ WARN ] SDL_CreateTexture: %s\n", SDL_GetError());
+			}
+		} else {
+			printf ("[ WARN ] Could not make the thumbnail of level %i.\n", iLoop);
+			stThumb->iFresh = 0;
+		}
+		free (stThumb->ulPixels);
+		stThumb->ulPixels = NULL;
+		free (stThumb->stShot.sBack);
+		free (stThumb->stShot.iRowFirst);
+		stThumb->stShot.sBack = NULL;
+		stThumb->stShot.iRowFirst = NULL;
+		iChangedThumbs++;
+	}
+
+	return (iChangedThumbs);
+}
+/*****************************************************************************/
+int ThumbThread (void *data)
+/*****************************************************************************/
+{
+	/* Makes one thumbnail: draws the back tiles with ShotRow(), and
+	 * averages each square of iScaleDown pixels. This runs next to other
+	 * threads, so it must not touch the globals; if anything fails,
+	 * ulPixels stays NULL.
+	 */
+
+	struct thumb *stThumb;
+	struct shot *stShot;
+	char sLocation[MAX_PATHFILE + 2];
+	unsigned char sSize[2 + 2];
+	int iFd;
+	int iScaleDown;
+	int iPixels;
+	unsigned char *sRGB;
+	Uint32 *ulSum;
+	int iX, iY;
+	int iAt;
+
+	/*** Used for looping. ***/
+	int iRowLoop, iYLoop, iXLoop;
+
+	stThumb = (struct thumb *)data;
+	stShot = &stThumb->stShot;
+	stThumb->ulPixels = NULL;
+
+	/*** Other levels come from their files. ***/
+	if (stShot->sBack == NULL)
+	{
+		snprintf (sLocation, MAX_PATHFILE, "%s%s%i.lvl",
+			DIR_UNCOMP, SLASH, stShot->iLevel);
+		iFd = open (sLocation, O_RDONLY|O_BINARY);
+		if (iFd == -1) { SDL_AtomicSet (&stThumb->iDone, 1); return (0); }
+		if (read (iFd, sSize, 2) == 2)
+		{
+			stShot->iWidth = sSize[0];
+			stShot->iHeight = sSize[1];
+			stShot->sBack = malloc (stShot->iWidth * stShot->iHeight + 1);
+			if ((stShot->sBack != NULL) && (read (iFd, stShot->sBack,
+				stShot->iWidth * stShot->iHeight) !=
+				stShot->iWidth * stShot->iHeight))
+			{
+				free (stShot->sBack);
+				stShot->sBack = NULL;
+			}
+		}
+		close (iFd);
+	}
+	if ((stShot->sBack == NULL) || (stShot->iWidth == 0) ||
+		(stShot->iHeight == 0))
+		{ SDL_AtomicSet (&stThumb->iDone, 1); return (0); }
+
+	iPixels = stShot->iWidth * 16;
+	iScaleDown = 1;
+	while ((iPixels / iScaleDown > THUMB_WIDTH) ||
+		((stShot->iHeight * 24) / iScaleDown > THUMB_HEIGHT)) { iScaleDown++; }
+	stThumb->iWidth = iPixels / iScaleDown;
+	stThumb->iHeight = (stShot->iHeight * 24) / iScaleDown;
+
+	stShot->iRowFirst = calloc (stShot->iHeight + 1, sizeof (int));
+	sRGB = malloc (iPixels * 24 * 3);
+	ulSum = calloc (stThumb->iWidth * stThumb->iHeight * 3, sizeof (Uint32));
+	stThumb->ulPixels = malloc (stThumb->iWidth * stThumb->iHeight *
+		sizeof (Uint32));
+	if ((stShot->iRowFirst == NULL) || (sRGB == NULL) || (ulSum == NULL) ||
+		(stThumb->ulPixels == NULL))
+	{
+		free (stThumb->ulPixels);
+		stThumb->ulPixels = NULL;
+		free (sRGB);
+		free (ulSum);
+		SDL_AtomicSet (&stThumb->iDone, 1);
+		return (0);
+	}
+
+	for (iRowLoop = 0; iRowLoop < stShot->iHeight; iRowLoop++)
+	{
+		ShotRow (stShot, iRowLoop, sRGB);
+		for (iYLoop = 0; iYLoop < 24; iYLoop++)
+		{
+			iY = ((iRowLoop * 24) + iYLoop) / iScaleDown;
+			if (iY >= stThumb->iHeight) { break; }
+			for (iXLoop = 0; iXLoop < stThumb->iWidth * iScaleDown; iXLoop++)
+			{
+				iX = iXLoop / iScaleDown;
+				iAt = ((iY * stThumb->iWidth) + iX) * 3;
+				ulSum[iAt]+=sRGB[((iYLoop * iPixels) + iXLoop) * 3];
+				ulSum[iAt + 1]+=sRGB[(((iYLoop * iPixels) + iXLoop) * 3) + 1];
+				ulSum[iAt + 2]+=sRGB[(((iYLoop * iPixels) + iXLoop) * 3) + 2];
+			}
+		}
+	}
+	for (iAt = 0; iAt < stThumb->iWidth * stThumb->iHeight; iAt++)
+	{
+		stThumb->ulPixels[iAt] = 0xff000000 |
+			((ulSum[iAt * 3] / (iScaleDown * iScaleDown)) << 16) |
+			((ulSum[(iAt * 3) + 1] / (iScaleDown * iScaleDown)) << 8) |
+			(ulSum[(iAt * 3) + 2] / (iScaleDown * iScaleDown));
+	}
+
+	free (sRGB);
+	free (ulSum);
+	SDL_AtomicSet (&stThumb->iDone, 1);
+
+	return (0);
+}
+/*****************************************************************************/
+void AssetLoad (int iGroup, int iShowBar)
+/*****************************************************************************/
+{
+	if (iPrefetching != -1) { AssetPrefetchEnd(); }
+	if (assetgroup[iGroup].iLoaded == 1) { return; }
+
+	AssetQueue (iGroup);
+	PreLoadRun (iShowBar);
+	assetgroup[iGroup].iLoaded = 1;
+	if (iDebug == 1)
+		{ printf ("[ INFO ] Loaded the %s images.\n", assetgroup[iGroup].sName); }
+}
+/*****************************************************************************/
+void AssetUse (int iGroup)
+/*****************************************************************************/
+{
+	/* A screen opens; loads its images if needed. Each AssetUse() needs an
+	 * AssetDrop() when the screen closes.
+	 */
+
+	AssetLoad (iGroup, 0);
+	assetgroup[iGroup].iRefs++;
+}
+/*****************************************************************************/
+void AssetDrop (int iGroup)
+/*****************************************************************************/
+{
+	/*** A screen closes; maybe unloads its images. ***/
+
+	/*** Used for looping. ***/
+	int iLoop;
+	int iImage;
+
+	assetgroup[iGroup].iRefs--;
+	if ((assetgroup[iGroup].iRefs != 0) || (assetgroup[iGroup].iUnload == 0))
+		{ return; }
+
+	iLoop = 0;
+	while (asset[iLoop].img != NULL)
+	{
+		if (asset[iLoop].iGroup == iGroup)
+		{
+			for (iImage = 0; iImage < asset[iLoop].iCount; iImage++)
+			{
+				SDL_DestroyTexture (asset[iLoop].img[iImage]);
+				asset[iLoop].img[iImage] = NULL;
+			}
+		}
+		iLoop++;
+	}
+	assetgroup[iGroup].iLoaded = 0;
+	if (iDebug == 1)
+		{ printf ("[ INFO ] Unloaded the %s images.\n", assetgroup[iGroup].sName); }
+}
+/*****************************************************************************/
+void AssetQueue (int iGroup)
+/*****************************************************************************/
+{
+	char sFile[MAX_FILE + 2];
+	char *sPath;
+
+	/*** Used for looping. ***/
+	int iLoop;
+	int iImage;
+
+	iLoop = 0;
+	while (asset[iLoop].img != NULL)
+	{
+		if (asset[iLoop].iGroup == iGroup)
+		{
+			sPath = asset[iLoop].sPath;
+			if (sPath == NULL)
+				{ sPath = (iController != 1) ? PNG_BUTTONS : PNG_GAMEPAD; }
+			for (iImage = 0; iImage < asset[iLoop].iCount; iImage++)
+			{
+				snprintf (sFile, MAX_FILE, asset[iLoop].sFile, iImage);
+				PreLoad (sPath, sFile, &asset[iLoop].img[iImage]);
+			}
+		}
+		iLoop++;
+	}
+}
+/*****************************************************************************/
+void AssetPrefetch (void)
+/*****************************************************************************/
+{
+	/* Called while the map is shown. Loads the images of the screens that
+	 * may open next, one screen at a time, with a single thread in the
+	 * background; makes the textures that are ready.
+	 */
+
+	int iMade;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	if (iPrefetching == -1)
+	{
+		for (iLoop = 0; iLoop < MAX_ASSET_GROUPS; iLoop++)
+		{
+			if ((assetgroup[iLoop].iPrefetch == 1) &&
+				(assetgroup[iLoop].iLoaded == 0))
+			{
+				AssetQueue (iLoop);
+				PreLoadStart (1);
+				iPrefetching = iLoop;
+				break;
+			}
+		}
+		return;
+	}
+
+	do {
+		iMade = PreLoadMake (0, 0);
+	} while (iMade == 0);
+	if (iMade == 1)
+	{
+		assetgroup[iPrefetching].iLoaded = 1;
+		if (iDebug == 1)
+		{
+			printf ("[ INFO ] Prefetched the %s images.\n",
+				assetgroup[iPrefetching].sName);
+		}
+		iPrefetching = -1;
+	}
+}
+/*****************************************************************************/
+void AssetPrefetchEnd (void)
+/*****************************************************************************/
+{
+	/*** Finishes the prefetching right now. ***/
+
+	while (PreLoadMake (1, 0) != 1) { }
+	assetgroup[iPrefetching].iLoaded = 1;
+	iPrefetching = -1;
+}
+/*****************************************************************************/
+SDL_Surface *CacheLoad (char *sImage, unsigned char **sPixels)
+/*****************************************************************************/
+{
+	/* Returns image sImage as decoded earlier, from DIR_CACHE, or NULL if
+	 * it is not there or the PNG changed. The caller frees *sPixels after
+	 * the surface. This runs next to other threads; see PreLoadOne().
+	 */
+
+	char sCache[MAX_PATHFILE + 2];
+	struct stat stSource;
+	unsigned char sHeader[CACHE_HEADER + 2];
+	int iFd;
+	int iWidth, iHeight;
+	SDL_Surface *surface;
+
+	*sPixels = NULL;
+	if (iNoCache == 1) { return (NULL); }
+	if (stat (sImage, &stSource) == -1) { return (NULL); }
+	CacheName (sImage, sCache);
+	iFd = open (sCache, O_RDWR|O_BINARY);
+	if (iFd == -1) { return (NULL); }
+	if ((read (iFd, sHeader, CACHE_HEADER) != CACHE_HEADER) ||
+		(memcmp (sHeader, CACHE_MAGIC, 4) != 0) ||
+		(BytesAsLU (&sHeader[12], 4) != (unsigned long)stSource.st_size))
+		{ close (iFd); return (NULL); }
+	if (BytesAsLU (&sHeader[16], 4) !=
+		((unsigned long)stSource.st_mtime & 0xFFFFFFFFUL))
+	{
+		/*** Touched (e.g. by a checkout), but maybe not changed. ***/
+		if (CacheHash (sImage) != BytesAsLU (&sHeader[20], 4))
+			{ close (iFd); return (NULL); }
+		LUAsBytes ((unsigned long)stSource.st_mtime, &sHeader[16]);
+		if ((lseek (iFd, 0, SEEK_SET) == -1) ||
+			(write (iFd, sHeader, CACHE_HEADER) != CACHE_HEADER))
+			{ close (iFd); return (NULL); }
+		lseek (iFd, CACHE_HEADER, SEEK_SET);
+	}
+
+	iWidth = (int)BytesAsLU (&sHeader[4], 4);
+	iHeight = (int)BytesAsLU (&sHeader[8], 4);
+	if ((iWidth < 1) || (iWidth > MAX_CACHE_SIDE) ||
+		(iHeight < 1) || (iHeight > MAX_CACHE_SIDE))
+		{ close (iFd); return (NULL); }
+	*sPixels = malloc (iWidth * iHeight * 4);
+	if ((*sPixels == NULL) ||
+		(read (iFd, *sPixels, iWidth * iHeight * 4) != iWidth * iHeight * 4))
+	{
+		close (iFd);
+		free (*sPixels);
+		*sPixels = NULL;
+		return (NULL);
+	}
+	close (iFd);
+
+	surface = SDL_CreateRGBSurfaceWithFormatFrom (*sPixels, iWidth, iHeight,
+		32, iWidth * 4, SDL_PIXELFORMAT_RGBA32);
+	if (surface == NULL)
+	{
+		free (*sPixels);
+		*sPixels = NULL;
+	}
+
+	return (surface);
+}
+/*****************************************************************************/
+void CacheSave (char *sImage, SDL_Surface *surface)
+/*****************************************************************************/
+{
+	/* Puts the decoded image sImage in DIR_CACHE, keyed by the size, time
+	 * and hash of the PNG. This runs next to other threads; problems only
+	 * mean the image is decoded again next time.
+	 */
+
+	char sCache[MAX_PATHFILE + 2];
+	char sTemp[MAX_PATHFILE + 2];
+	struct stat stSource;
+	unsigned char sHeader[CACHE_HEADER + 2];
+	SDL_Surface *converted;
+	int iFd;
+	int iFailed;
+
+	/*** Used for looping. ***/
+	int iRowLoop;
+
+	if (iNoCache == 1) { return; }
+	if (stat (sImage, &stSource) == -1) { return; }
+	converted = SDL_ConvertSurfaceFormat (surface, SDL_PIXELFORMAT_RGBA32, 0);
+	if (converted == NULL) { return; }
+
+	memcpy (sHeader, CACHE_MAGIC, 4);
+	LUAsBytes (converted->w, &sHeader[4]);
+	LUAsBytes (converted->h, &sHeader[8]);
+	LUAsBytes ((unsigned long)stSource.st_size, &sHeader[12]);
+	LUAsBytes ((unsigned long)stSource.st_mtime, &sHeader[16]);
+	LUAsBytes (CacheHash (sImage), &sHeader[20]);
+
+	/*** Written under another name first, so no half files are read. ***/
+	CacheName (sImage, sCache);
+	snprintf (sTemp, MAX_PATHFILE, "%s.tmp", sCache);
+	iFd = open (sTemp, O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, 0600);
+	if (iFd == -1) { SDL_FreeSurface (converted); return; }
+	iFailed = 0;
+	if (write (iFd, sHeader, CACHE_HEADER) != CACHE_HEADER) { iFailed = 1; }
+	for (iRowLoop = 0; (iRowLoop < converted->h) && (iFailed == 0); iRowLoop++)
+	{
+		if (write (iFd, (unsigned char *)converted->pixels +
+			(iRowLoop * converted->pitch), converted->w * 4) != converted->w * 4)
+			{ iFailed = 1; }
+	}
+	close (iFd);
+	SDL_FreeSurface (converted);
+
+	if (iFailed == 0)
+	{
+		remove (sCache);
+		if (rename (sTemp, sCache) == 0) { return; }
+	}
+	remove (sTemp);
+}
+/*****************************************************************************/
+void CacheName (char *sImage, char *sCache)
+/*****************************************************************************/
+{
+	/*** For example, png/back/00.png becomes cache/png_back_00.png.rgba ***/
+
+	int iLen;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	snprintf (sCache, MAX_PATHFILE, "%s%s%s.rgba", DIR_CACHE, SLASH, sImage);
+	iLen = strlen (DIR_CACHE) + strlen (SLASH);
+	for (iLoop = iLen; sCache[iLoop] != '\0'; iLoop++)
+	{
+		if ((sCache[iLoop] == '/') || (sCache[iLoop] == '\\'))
+			{ sCache[iLoop] = '_'; }
+	}
+}
+/*****************************************************************************/
+unsigned long CacheHash (char *sImage)
+/*****************************************************************************/
+{
+	/*** FNV-1a of a file, as in LevelHash(). ***/
+
+	int iFd;
+	unsigned char sData[MAX_DATA + 2];
+	int iRead;
+	unsigned long ulHash;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	ulHash = 2166136261UL;
+	iFd = open (sImage, O_RDONLY|O_BINARY);
+	if (iFd == -1) { return (0); }
+	while ((iRead = read (iFd, sData, MAX_DATA)) > 0)
+	{
+		for (iLoop = 0; iLoop < iRead; iLoop++)
+		{
+			ulHash ^= sData[iLoop];
+			ulHash = (ulHash * 16777619UL) & 0xFFFFFFFFUL;
+		}
+	}
+	close (iFd);
+
+	return (ulHash);
+}
+/*****************************************************************************/
+void LUAsBytes (unsigned long ulValue, unsigned char *sData)
+/*****************************************************************************/
+{
+	/*** The reverse of BytesAsLU (sData, 4). ***/
+
+	sData[0] = (ulValue >> 0) & 0xFF;
+	sData[1] = (ulValue >> 8) & 0xFF;
+	sData[2] = (ulValue >> 16) & 0xFF;
+	sData[3] = (ulValue >> 24) & 0xFF;
+}
+/*****************************************************************************/
+SDL_RWops *AssetOpen (char *sFile)
+/*****************************************************************************/
+{
+	/* Opens a file of png/, wav/ or ttf/ for IMG_Load_RW() and the like.
+	 * With EMBED this is the compiled-in copy, so nothing is looked up on
+	 * disk. Returns NULL if there is no such file.
+	 */
+
+#ifdef EMBED
+	/*** Used for looping. ***/
+	int iLoop;
+	int iChar;
+
+	for (iLoop = 0; embedded[iLoop].sFile != NULL; iLoop++)
+	{
+		for (iChar = 0; sFile[iChar] != '\0'; iChar++)
+		{
+			if ((sFile[iChar] != embedded[iLoop].sFile[iChar]) &&
+				((sFile[iChar] != '\\') || (embedded[iLoop].sFile[iChar] != '/')))
+				{ break; }
+		}
+		if ((sFile[iChar] == '\0') && (embedded[iLoop].sFile[iChar] == '\0'))
+		{
+			return (SDL_RWFromConstMem (embedded[iLoop].sData,
+				embedded[iLoop].iSize));
+		}
+	}
+	SDL_SetError ("\"%s\" is not embedded", sFile);
+	return (NULL);
+#else
+	return (SDL_RWFromFile (sFile, "rb"));
+#endif
+}
+#ifdef BENCH
+/*****************************************************************************/
+void HoverBench (void)
+/*****************************************************************************/
+{
+	/* Times UpdateHover() against the scan of every tile it replaced, see
+	 * HoverScan(), on a MAX_WIDTH x MAX_HEIGHT level. First checks that
+	 * both find the same tile, at every zoom.
+	 */
+
+	int iScanRow, iScanColumn;
+	int iPositions;
+	Uint64 ulStart;
+	double dScan, dCalc;
+
+	/*** Used for looping. ***/
+	int iLoop;
+
+	ulWidth = MAX_WIDTH;
+	ulHeight = MAX_HEIGHT;
+	ulPrinceX = (MAX_WIDTH * 16) / 2;
+	ulPrinceY = (MAX_HEIGHT * 24) / 2;
+	iXPosDragOffset = 0;
+	iYPosDragOffset = 0;
+
+	/*** Same tile; also for positions next to the map. ***/
+	iPositions = 0;
+	for (iZoom = 1; iZoom <= MAX_ZOOM; iZoom++)
+	{
+		for (iLoop = 0; iLoop < 20; iLoop++)
+		{
+			iXPos = (iLoop * 97) % (MAP_LEFT + MAP_WIDTH + 40);
+			iYPos = (iLoop * 131) % (MAP_TOP + MAP_HEIGHT + 40);
+			iHoverRow = 0; iHoverColumn = 0;
+			HoverScan();
+			iScanRow = iHoverRow; iScanColumn = iHoverColumn;
+			iHoverRow = 0; iHoverColumn = 0;
+			UpdateHover();
+			if ((iHoverRow != iScanRow) || (iHoverColumn != iScanColumn))
+			{
+				printf ("[FAILED] Zoom %i, x:%i, y:%i: row %i col %i, not"
+					" row %i col %i!\n", iZoom, iXPos, iYPos, iHoverRow,
+					iHoverColumn, iScanRow, iScanColumn);
+				exit (EXIT_ERROR);
+			}
+			iPositions++;
+		}
+	}
+	printf ("[  OK  ] Same tile for all %i positions.\n", iPositions);
+
+	iZoom = DEFAULT_ZOOM;
+	ulStart = SDL_GetPerformanceCounter();
+	for (iLoop = 0; iLoop < 100; iLoop++)
+	{
+		iXPos = MAP_LEFT + ((iLoop * 97) % MAP_WIDTH);
+		iYPos = MAP_TOP + ((iLoop * 131) % MAP_HEIGHT);
+		HoverScan();
+	}
+	dScan = (double)(SDL_GetPerformanceCounter() - ulStart) /
+		SDL_GetPerformanceFrequency() / 100;
+	ulStart = SDL_GetPerformanceCounter();
+	for (iLoop = 0; iLoop < 1000000; iLoop++)
+	{
+		iXPos = MAP_LEFT + ((iLoop * 97) % MAP_WIDTH);
+		iYPos = MAP_TOP + ((iLoop * 131) % MAP_HEIGHT);
+		UpdateHover();
+	}
+	dCalc = (double)(SDL_GetPerformanceCounter() - ulStart) /
+		SDL_GetPerformanceFrequency() / 1000000;
+	printf ("[ INFO ] %ix%i tiles, zoom %i, per mouse move:\n",
+		MAX_WIDTH, MAX_HEIGHT, DEFAULT_ZOOM);
+	printf ("[ INFO ] scan of every tile: %.3f ms\n", dScan * 1000);
+	printf ("[ INFO ] UpdateHover(): %.1f ns\n", dCalc * 1000000000);
+}
+/*****************************************************************************/
+void HoverScan (void)
+/*****************************************************************************/
+{
+	/*** What UpdateHover() did before; only for HoverBench(). ***/
+
+	int iX, iY;
+	int iXFull, iYFull;
+
+	/*** Used for looping. ***/
+	int iRowLoop, iColumnLoop;
+
+	iY = 0;
+	for (iRowLoop = 1; iRowLoop <= (int)ulHeight; iRowLoop++)
+	{
+		iX = 0;
+		for (iColumnLoop = 1; iColumnLoop <= (int)ulWidth; iColumnLoop++)
+		{
+			iXFull = MapStartX() + (iX * iZoom);
+			iYFull = MapStartY() + (iY * iZoom);
+			if ((iXPos >= iXFull) && (iXPos < (iXFull + (16 * iZoom))) &&
+				(iYPos >= iYFull) && (iYPos < (iYFull + (24 * iZoom))))
+			{
+				iHoverRow = iRowLoop;
+				iHoverColumn = iColumnLoop;
+			}
+			iX+=16;
+		}
+		iY+=24;
+	}
+}
+#endif